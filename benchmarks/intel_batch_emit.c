@@ -0,0 +1,215 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+/**
+ * Measures how fast commands get into a batch, one dword at a time with
+ * OUT_BATCH() versus a whole packet at a time with the intel_emit_*()
+ * packet emitters. Runs on the mock bufmgr, so only the emission is timed,
+ * not the kernel or the GPU.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/time.h>
+#include "i915_drm.h"
+#include "intel_bufmgr.h"
+#include "intel_batchbuffer.h"
+#include "intel_chipset.h"
+#include "intel_reg.h"
+#include "intel_mock_bufmgr.h"
+
+#define BATCH_SIZE	(64 * 1024)
+#define PACKETS		(4 * 1024 * 1024)
+
+static drm_intel_bufmgr *bufmgr;
+static struct intel_batchbuffer *batch;
+static drm_intel_bo *dst, *src;
+
+static double
+get_time_in_secs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return (double)tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void
+copy_blt_dwords(int i)
+{
+	BEGIN_BATCH(8);
+	OUT_BATCH(XY_SRC_COPY_BLT_CMD |
+		  XY_SRC_COPY_BLT_WRITE_ALPHA |
+		  XY_SRC_COPY_BLT_WRITE_RGB);
+	OUT_BATCH((3 << 24) | (0xcc << 16) | 4096);
+	OUT_BATCH((i & 255) << 16);
+	OUT_BATCH(((i & 255) + 1) << 16 | 1024);
+	OUT_RELOC(dst, I915_GEM_DOMAIN_RENDER, I915_GEM_DOMAIN_RENDER, 0);
+	OUT_BATCH((i & 255) << 16);
+	OUT_BATCH(4096);
+	OUT_RELOC(src, I915_GEM_DOMAIN_RENDER, 0, 0);
+	ADVANCE_BATCH();
+}
+
+static void
+copy_blt_packet(int i)
+{
+	intel_emit_xy_src_copy_blt(batch,
+				   XY_SRC_COPY_BLT_WRITE_ALPHA |
+				   XY_SRC_COPY_BLT_WRITE_RGB,
+				   (3 << 24) | (0xcc << 16) | 4096,
+				   dst, 0, i & 255, 1024, 1,
+				   src, 4096, 0, i & 255);
+}
+
+static void
+color_blt_dwords(int i)
+{
+	BEGIN_BATCH(6);
+	OUT_BATCH(XY_COLOR_BLT_CMD |
+		  XY_COLOR_BLT_WRITE_ALPHA |
+		  XY_COLOR_BLT_WRITE_RGB);
+	OUT_BATCH((3 << 24) | (0xf0 << 16) | 4096);
+	OUT_BATCH((i & 255) << 16);
+	OUT_BATCH(((i & 255) + 1) << 16 | 1024);
+	OUT_RELOC(dst, I915_GEM_DOMAIN_RENDER, I915_GEM_DOMAIN_RENDER, 0);
+	OUT_BATCH(i);
+	ADVANCE_BATCH();
+}
+
+static void
+color_blt_packet(int i)
+{
+	intel_emit_xy_color_blt(batch,
+				XY_COLOR_BLT_WRITE_ALPHA |
+				XY_COLOR_BLT_WRITE_RGB,
+				(3 << 24) | (0xf0 << 16) | 4096,
+				dst, 0, i & 255, 1024, 1, i);
+}
+
+static void
+store_dwords(int i)
+{
+	BEGIN_BATCH(4);
+	OUT_BATCH(MI_STORE_DWORD_IMM);
+	OUT_BATCH(0);
+	OUT_RELOC(dst, I915_GEM_DOMAIN_INSTRUCTION,
+		  I915_GEM_DOMAIN_INSTRUCTION, (i & 1023) * 4);
+	OUT_BATCH(i);
+	ADVANCE_BATCH();
+}
+
+static void
+store_packet(int i)
+{
+	intel_emit_store_dword_imm(batch, dst, (i & 1023) * 4, i);
+}
+
+static void
+pipe_control_dwords(int i)
+{
+	BEGIN_BATCH(4);
+	OUT_BATCH(PIPE_CONTROL);
+	OUT_BATCH(PIPE_CONTROL_CS_STALL);
+	OUT_BATCH(0);
+	OUT_BATCH(0);
+	ADVANCE_BATCH();
+}
+
+static void
+pipe_control_packet(int i)
+{
+	intel_emit_pipe_control(batch, PIPE_CONTROL_CS_STALL, NULL, 0, 0);
+}
+
+static const struct {
+	const char *name;
+	unsigned int size;
+	void (*dwords)(int i);
+	void (*packet)(int i);
+} packets[] = {
+	{ "XY_SRC_COPY_BLT", 32, copy_blt_dwords, copy_blt_packet },
+	{ "XY_COLOR_BLT", 24, color_blt_dwords, color_blt_packet },
+	{ "MI_STORE_DWORD_IMM", 16, store_dwords, store_packet },
+	{ "PIPE_CONTROL", 16, pipe_control_dwords, pipe_control_packet },
+};
+
+/* Returns the packets per second, only counting the time spent emitting. */
+static double
+run(void (*emit)(int i), unsigned int size)
+{
+	double elapsed = 0;
+	int i = 0;
+
+	while (i < PACKETS) {
+		double start_time = get_time_in_secs();
+
+		/* fill the batch, but never chain */
+		while (i < PACKETS && intel_batchbuffer_space(batch) >= size)
+			emit(i++);
+
+		elapsed += get_time_in_secs() - start_time;
+		intel_batchbuffer_flush(batch);
+	}
+
+	return PACKETS / elapsed;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int n;
+
+	bufmgr = intel_mock_bufmgr_init();
+	intel_mock_bufmgr_set_recording(bufmgr, false);
+
+	dst = drm_intel_bo_alloc(bufmgr, "dst", 1024 * 1024, 4096);
+	src = drm_intel_bo_alloc(bufmgr, "src", 1024 * 1024, 4096);
+	batch = intel_batchbuffer_alloc_size(bufmgr, PCI_CHIP_IVYBRIDGE_GT2,
+					     BATCH_SIZE);
+
+	for (n = 0; n < sizeof(packets) / sizeof(packets[0]); n++) {
+		double dwords, packet;
+
+		/* warm up */
+		run(packets[n].dwords, packets[n].size);
+
+		dwords = run(packets[n].dwords, packets[n].size);
+		packet = run(packets[n].packet, packets[n].size);
+
+		printf("%-18s dwords: %.01f Mpackets/sec, "
+		       "packets: %.01f Mpackets/sec (%.02fx)\n",
+		       packets[n].name, dwords / 1e6, packet / 1e6,
+		       packet / dwords);
+	}
+
+	intel_batchbuffer_free(batch);
+	drm_intel_bo_unreference(src);
+	drm_intel_bo_unreference(dst);
+	drm_intel_bufmgr_destroy(bufmgr);
+
+	return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+/**
+ * Measures how fast intel_batchbuffer gets batches to the kernel, emitting
+ * into a staging copy that is pwritten at flush versus straight into the
+ * mapped batch bo. The batches are nothing but MI_NOOPs, so that the time
+ * goes into emission and submission rather than into the GPU.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "drm.h"
+#include "i915_drm.h"
+#include "drmtest.h"
+#include "intel_bufmgr.h"
+#include "intel_batchbuffer.h"
+#include "intel_gpu_tools.h"
+
+#define ITERATIONS	10000
+
+static double
+get_time_in_secs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return (double)tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* Emit and flush @size bytes of batch, returning a reference to its bo. */
+static drm_intel_bo *
+submit(struct intel_batchbuffer *batch, unsigned int size)
+{
+	drm_intel_bo *bo;
+	unsigned int i;
+
+	/* leave room for the end of the batch */
+	for (i = 0; i < size / 4 - 2; i++)
+		OUT_BATCH(MI_NOOP);
+
+	bo = batch->bo;
+	drm_intel_bo_reference(bo);
+	intel_batchbuffer_flush(batch);
+
+	return bo;
+}
+
+static void
+run(drm_intel_bufmgr *bufmgr, uint32_t devid, unsigned int size, bool direct)
+{
+	struct intel_batchbuffer *batch;
+	double start_time, end_time;
+	drm_intel_bo *bo;
+	int i;
+
+	batch = intel_batchbuffer_alloc_size(bufmgr, devid, size + BATCH_SZ);
+	intel_batchbuffer_set_direct(batch, direct);
+
+	/* Prep loop to get us warmed up. */
+	for (i = 0; i < 20; i++)
+		drm_intel_bo_unreference(submit(batch, size));
+
+	start_time = get_time_in_secs();
+	for (i = 0; i < ITERATIONS - 1; i++)
+		drm_intel_bo_unreference(submit(batch, size));
+	bo = submit(batch, size);
+	drm_intel_bo_wait_rendering(bo);
+	end_time = get_time_in_secs();
+	drm_intel_bo_unreference(bo);
+
+	printf("%6u bytes, %s: %.01f batches/sec, %.01f MB/sec, "
+	       "%lu bos allocated, %lu stalls\n",
+	       size, direct ? "direct" : "staged",
+	       ITERATIONS / (end_time - start_time),
+	       (double)ITERATIONS * size / 1024.0 / 1024.0 /
+	       (end_time - start_time),
+	       batch->allocs, batch->stalls);
+
+	intel_batchbuffer_free(batch);
+}
+
+int main(int argc, char **argv)
+{
+	drm_intel_bufmgr *bufmgr;
+	unsigned int size;
+	uint32_t devid;
+	int fd;
+
+	fd = drm_open_any();
+	devid = intel_get_drm_devid(fd);
+
+	bufmgr = drm_intel_bufmgr_gem_init(fd, 4096);
+	drm_intel_bufmgr_gem_enable_reuse(bufmgr);
+
+	for (size = 64; size <= 64 * 1024; size *= 4) {
+		run(bufmgr, devid, size, false);
+		run(bufmgr, devid, size, true);
+	}
+
+	drm_intel_bufmgr_destroy(bufmgr);
+
+	close(fd);
+
+	return 0;
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+/**
+ * Measures render copies in rectangles per second, copying a buffer in
+ * small tiles one rectangle per call, then all the tiles in one call, with
+ * the default batch size and with one big enough to take them all. On gen7
+ * also one rectangle per call, with the copies queued in the batch.
+ */
+
+#include "rendercopy.h"
+
+#define WIDTH 1024
+#define HEIGHT 1024
+#define TILE 16
+#define NUM_RECTS (WIDTH / TILE * HEIGHT / TILE)
+#define ITERATIONS 20
+
+static struct render_rect rects[NUM_RECTS];
+
+static double
+get_time_in_secs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return (double)tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void
+init_buf(drm_intel_bufmgr *bufmgr, struct scratch_buf *buf)
+{
+	memset(buf, 0, sizeof(*buf));
+	buf->bo = drm_intel_bo_alloc(bufmgr, "", WIDTH * HEIGHT * 4, 4096);
+	buf->stride = WIDTH * 4;
+	buf->tiling = I915_TILING_NONE;
+	buf->size = WIDTH * HEIGHT * 4;
+}
+
+static void
+copy_each(struct intel_batchbuffer *batch, render_copyfunc_t copy,
+	  struct scratch_buf *src, struct scratch_buf *dst)
+{
+	int i;
+
+	for (i = 0; i < NUM_RECTS; i++)
+		copy(batch, src, rects[i].src_x, rects[i].src_y,
+		     rects[i].width, rects[i].height,
+		     dst, rects[i].dst_x, rects[i].dst_y);
+}
+
+static void
+queue_each(struct intel_batchbuffer *batch,
+	   struct scratch_buf *src, struct scratch_buf *dst)
+{
+	int i;
+
+	for (i = 0; i < NUM_RECTS; i++)
+		gen7_render_queue_copy(batch, src, rects[i].src_x, rects[i].src_y,
+				       rects[i].width, rects[i].height,
+				       dst, rects[i].dst_x, rects[i].dst_y);
+	gen7_render_submit(batch);
+}
+
+static void
+report(const char *name, double start_time, double end_time)
+{
+	printf("%s: %.01f rects/sec\n", name,
+	       (double)ITERATIONS * NUM_RECTS / (end_time - start_time));
+}
+
+int main(int argc, char **argv)
+{
+	struct scratch_buf src, dst;
+	drm_intel_bufmgr *bufmgr;
+	struct intel_batchbuffer *batch;
+	render_copyfunc_t copy;
+	render_copyrects_t copyrects;
+	double start_time;
+	uint32_t devid;
+	int fd, i;
+
+	fd = drm_open_any();
+	devid = intel_get_drm_devid(fd);
+
+	copy = get_render_copyfunc(devid);
+	copyrects = get_render_copyrects(devid);
+	if (copy == NULL || copyrects == NULL) {
+		fprintf(stderr, "no multi-rectangle render copy\n");
+		return 77;
+	}
+
+	bufmgr = drm_intel_bufmgr_gem_init(fd, 4096);
+	drm_intel_bufmgr_gem_enable_reuse(bufmgr);
+
+	init_buf(bufmgr, &src);
+	init_buf(bufmgr, &dst);
+
+	for (i = 0; i < NUM_RECTS; i++) {
+		rects[i].src_x = rects[i].dst_x = i % (WIDTH / TILE) * TILE;
+		rects[i].src_y = rects[i].dst_y = i / (WIDTH / TILE) * TILE;
+		rects[i].width = rects[i].height = TILE;
+	}
+
+	batch = intel_batchbuffer_alloc(bufmgr, devid);
+
+	/* Prep loop to get us warmed up. */
+	copy_each(batch, copy, &src, &dst);
+	drm_intel_bo_wait_rendering(dst.bo);
+
+	start_time = get_time_in_secs();
+	for (i = 0; i < ITERATIONS; i++)
+		copy_each(batch, copy, &src, &dst);
+	drm_intel_bo_wait_rendering(dst.bo);
+	report("one per call", start_time, get_time_in_secs());
+
+	start_time = get_time_in_secs();
+	for (i = 0; i < ITERATIONS; i++)
+		copyrects(batch, &src, &dst, rects, NUM_RECTS);
+	drm_intel_bo_wait_rendering(dst.bo);
+	report("all in one call", start_time, get_time_in_secs());
+
+	if (IS_GEN7(devid)) {
+		start_time = get_time_in_secs();
+		for (i = 0; i < ITERATIONS; i++)
+			queue_each(batch, &src, &dst);
+		drm_intel_bo_wait_rendering(dst.bo);
+		report("one per call, queued", start_time, get_time_in_secs());
+	}
+
+	intel_batchbuffer_free(batch);
+
+	/* a batch with room for every rectangle */
+	batch = intel_batchbuffer_alloc_size(bufmgr, devid,
+					     NUM_RECTS * 64 + 4 * BATCH_SZ);
+
+	start_time = get_time_in_secs();
+	for (i = 0; i < ITERATIONS; i++)
+		copyrects(batch, &src, &dst, rects, NUM_RECTS);
+	drm_intel_bo_wait_rendering(dst.bo);
+	report("all in one call, one batch", start_time, get_time_in_secs());
+
+	intel_batchbuffer_free(batch);
+	drm_intel_bo_unreference(src.bo);
+	drm_intel_bo_unreference(dst.bo);
+	drm_intel_bufmgr_destroy(bufmgr);
+
+	close(fd);
+
+	return 0;
+}
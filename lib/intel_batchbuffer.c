@@ -38,41 +38,566 @@
 #include "intel_chipset.h"
 #include "intel_reg.h"
 #include <i915_drm.h>
+#include <xf86drm.h>
+
+#define LOCAL_I915_EXEC_NO_RELOC (1<<11)
+#define LOCAL_I915_EXEC_HANDLE_LUT (1<<12)
+#define LOCAL_I915_PARAM_HAS_EXEC_HANDLE_LUT 26
+#define LOCAL_EXEC_OBJECT_WRITE (1<<2)
+
+#define LUT_HASH_SIZE 256
+
+/*
+ * A batch that submits itself with execbuffer2 keeps its own list of bos,
+ * and its relocations point at them by index in that list.
+ */
+struct intel_batch_lut {
+	int fd;
+
+	int num_bos, max_bos;
+	struct lut_bo {
+		drm_intel_bo *bo;
+		bool fenced;
+		bool written;			/* NO_RELOC execs must say so */
+		int first_reloc, num_relocs;	/* for the chained batch bos */
+		int next;			/* in the hash chain, or -1 */
+	} *bos;
+	int hash[LUT_HASH_SIZE];		/* by handle, -1 when empty */
+
+	int num_relocs, max_relocs;
+	struct drm_i915_gem_relocation_entry *relocs;
+
+	/* The first batch bo goes last in the list, so only gets there at
+	 * exec. Later ones in a chain are listed as the jumps' targets. */
+	int batch_index;			/* -1 for the first */
+	int batch_reloc;			/* its first relocation */
+	int head_relocs;
+
+	int max_objects;
+	struct drm_i915_gem_exec_object2 *objects;
+};
+
+static void *
+batch_grow(void *ptr, int *max, int count, size_t size)
+{
+	if (count < *max)
+		return ptr;
+
+	/* the exec list goes from empty to every bo at once */
+	if (*max == 0)
+		*max = 64;
+	while (*max <= count)
+		*max *= 2;
+	ptr = realloc(ptr, *max * size);
+	assert(ptr != NULL);
+	return ptr;
+}
+
+static void
+lut_reset(struct intel_batch_lut *lut)
+{
+	int i;
+
+	for (i = 0; i < lut->num_bos; i++)
+		drm_intel_bo_unreference(lut->bos[i].bo);
+	lut->num_bos = 0;
+	lut->num_relocs = 0;
+	memset(lut->hash, -1, sizeof(lut->hash));
+
+	lut->batch_index = -1;
+	lut->batch_reloc = 0;
+	lut->head_relocs = 0;
+}
+
+/* The index of @bo in the list, adding it if it isn't there yet. */
+static int
+lut_index(struct intel_batch_lut *lut, drm_intel_bo *bo)
+{
+	int *hash = &lut->hash[bo->handle % LUT_HASH_SIZE];
+	int i;
+
+	for (i = *hash; i >= 0; i = lut->bos[i].next) {
+		if (lut->bos[i].bo == bo)
+			return i;
+	}
+
+	lut->bos = batch_grow(lut->bos, &lut->max_bos, lut->num_bos,
+			    sizeof(*lut->bos));
+	i = lut->num_bos++;
+	lut->bos[i].bo = bo;
+	lut->bos[i].fenced = false;
+	lut->bos[i].written = false;
+	lut->bos[i].first_reloc = 0;
+	lut->bos[i].num_relocs = 0;
+	lut->bos[i].next = *hash;
+	*hash = i;
+
+	drm_intel_bo_reference(bo);
+	return i;
+}
+
+static int
+lut_reloc(struct intel_batch_lut *lut, uint32_t offset, drm_intel_bo *target,
+	  uint32_t delta, uint32_t read_domains, uint32_t write_domain,
+	  int fenced)
+{
+	struct drm_i915_gem_relocation_entry *reloc;
+	int i = lut_index(lut, target);
+
+	if (fenced)
+		lut->bos[i].fenced = true;
+	if (write_domain)
+		lut->bos[i].written = true;
+
+	lut->relocs = batch_grow(lut->relocs, &lut->max_relocs,
+			       lut->num_relocs, sizeof(*lut->relocs));
+	reloc = &lut->relocs[lut->num_relocs++];
+	reloc->target_handle = i;
+	reloc->delta = delta;
+	reloc->offset = offset;
+	reloc->presumed_offset = target->offset;
+	reloc->read_domains = read_domains;
+	reloc->write_domain = write_domain;
+
+	return i;
+}
+
+/* Done with the current batch bo, the relocations so far are its own. */
+static void
+lut_end_batch_bo(struct intel_batch_lut *lut)
+{
+	int count = lut->num_relocs - lut->batch_reloc;
+
+	if (lut->batch_index < 0) {
+		lut->head_relocs = count;
+	} else {
+		lut->bos[lut->batch_index].first_reloc = lut->batch_reloc;
+		lut->bos[lut->batch_index].num_relocs = count;
+	}
+	lut->batch_reloc = lut->num_relocs;
+}
+
+/*
+ * Run @batch_bo with everything it points at. When every bo is still where
+ * the batch assumed, the kernel is told it can skip the relocations.
+ */
+static void
+lut_exec(struct intel_batch_lut *lut, drm_intel_bo *batch_bo,
+	 unsigned int used, int ring)
+{
+	struct drm_i915_gem_execbuffer2 execbuf;
+	struct drm_i915_gem_exec_object2 *obj;
+	bool no_reloc = true;
+	int i;
+
+	lut_end_batch_bo(lut);
+
+	for (i = 0; i < lut->num_relocs; i++) {
+		struct drm_i915_gem_relocation_entry *reloc = &lut->relocs[i];
+
+		if (reloc->presumed_offset !=
+		    lut->bos[reloc->target_handle].bo->offset)
+			no_reloc = false;
+	}
+
+	lut->objects = batch_grow(lut->objects, &lut->max_objects,
+				lut->num_bos, sizeof(*lut->objects));
+	for (i = 0; i <= lut->num_bos; i++) {
+		drm_intel_bo *bo;
+		int first, count;
+
+		if (i < lut->num_bos) {
+			bo = lut->bos[i].bo;
+			first = lut->bos[i].first_reloc;
+			count = lut->bos[i].num_relocs;
+		} else {
+			bo = batch_bo;
+			first = 0;
+			count = lut->head_relocs;
+		}
+
+		obj = &lut->objects[i];
+		obj->handle = bo->handle;
+		obj->relocation_count = count;
+		obj->relocs_ptr = (uintptr_t)(lut->relocs + first);
+		obj->alignment = 0;
+		obj->offset = bo->offset;
+		obj->flags = 0;
+		if (i < lut->num_bos && lut->bos[i].fenced)
+			obj->flags |= EXEC_OBJECT_NEEDS_FENCE;
+		if (i < lut->num_bos && lut->bos[i].written)
+			obj->flags |= LOCAL_EXEC_OBJECT_WRITE;
+		obj->rsvd1 = 0;
+		obj->rsvd2 = 0;
+	}
+
+	execbuf.buffers_ptr = (uintptr_t)lut->objects;
+	execbuf.buffer_count = lut->num_bos + 1;
+	execbuf.batch_start_offset = 0;
+	execbuf.batch_len = used;
+	execbuf.cliprects_ptr = 0;
+	execbuf.num_cliprects = 0;
+	execbuf.DR1 = 0;
+	execbuf.DR4 = 0;
+	execbuf.flags = ring | LOCAL_I915_EXEC_HANDLE_LUT;
+	if (no_reloc)
+		execbuf.flags |= LOCAL_I915_EXEC_NO_RELOC;
+	i915_execbuffer2_set_context_id(execbuf, 0);
+	execbuf.rsvd2 = 0;
+
+	do_or_die(drmIoctl(lut->fd, DRM_IOCTL_I915_GEM_EXECBUFFER2, &execbuf));
+
+	/* where the kernel put them is what the next batch presumes */
+	for (i = 0; i < lut->num_bos; i++)
+		lut->bos[i].bo->offset = lut->objects[i].offset;
+	batch_bo->offset = lut->objects[i].offset;
+}
+
+static bool
+lut_busy(struct intel_batch_lut *lut, drm_intel_bo *bo)
+{
+	struct drm_i915_gem_busy busy;
+
+	busy.handle = bo->handle;
+	busy.busy = 0;
+	do_ioctl(lut->fd, DRM_IOCTL_I915_GEM_BUSY, &busy);
+
+	return busy.busy;
+}
+
+/* Start emitting into @bo, which becomes the current batch bo. */
+static void
+batch_start_bo(struct intel_batchbuffer *batch, drm_intel_bo *bo)
+{
+	batch->bo = bo;
+	batch->buffer = batch->staging;
+	if (batch->direct) {
+		/* batch_pool_get() only hands out a bo that isn't busy or
+		 * that it waited on, and a chained bo comes straight from
+		 * drm_intel_bo_alloc(), which only reuses idle bos, so there
+		 * is nothing to wait for */
+		do_or_die(drm_intel_gem_bo_map_unsynchronized(bo));
+		batch->buffer = bo->virtual;
+	}
+	batch->ptr = batch->buffer;
+}
+
+/* Get the first @used bytes of the current bo ready for execution. */
+static void
+batch_upload(struct intel_batchbuffer *batch, unsigned int used)
+{
+	if (batch->direct) {
+		do_or_die(drm_intel_gem_bo_unmap_gtt(batch->bo));
+		batch->buffer = batch->staging;
+	} else
+		do_or_die(drm_intel_bo_subdata(batch->bo, 0, used,
+					       batch->buffer));
+}
+
+/* Drop the current batch bo, unmapping it first if it's still mapped. */
+static void
+batch_put_bo(struct intel_batchbuffer *batch)
+{
+	if (batch->bo == NULL)
+		return;
+
+	if (batch->direct && batch->buffer != batch->staging)
+		do_or_die(drm_intel_gem_bo_unmap_gtt(batch->bo));
+	batch->buffer = batch->staging;
+
+	drm_intel_bo_unreference(batch->bo);
+	batch->bo = NULL;
+}
+
+static drm_intel_bo *
+batch_alloc_bo(struct intel_batchbuffer *batch)
+{
+	batch->allocs++;
+	return drm_intel_bo_alloc(batch->bufmgr, "batchbuffer",
+				  batch->size, 4096);
+}
+
+/*
+ * The batch bos are recycled round-robin, so the one after the last taken
+ * is the oldest and the likeliest to be idle. Only when it isn't does the
+ * pool grow, by a bo slotted in as the newest, and once it can't grow any
+ * more we wait for the oldest.
+ */
+static drm_intel_bo *
+batch_pool_get(struct intel_batchbuffer *batch)
+{
+	drm_intel_bo *bo = NULL;
+	int next = batch->pool_next;
+
+	if (batch->pool_count)
+		bo = batch->pool[next];
+
+	/* libdrm can't know about our own execbuffers, so ask the kernel */
+	if (bo == NULL ||
+	    (batch->lut ? lut_busy(batch->lut, bo) : drm_intel_bo_busy(bo))) {
+		if (batch->pool_count < BATCH_POOL_MAX) {
+			memmove(&batch->pool[next + 1], &batch->pool[next],
+				(batch->pool_count - next) * sizeof(bo));
+			bo = batch_alloc_bo(batch);
+			batch->pool[next] = bo;
+			batch->pool_count++;
+		} else {
+			batch->stalls++;
+			drm_intel_bo_wait_rendering(bo);
+		}
+	}
+
+	/* whatever was emitted into it last time is gone */
+	drm_intel_gem_bo_clear_relocs(bo, 0);
+
+	batch->pool_next = (next + 1) % batch->pool_count;
+	drm_intel_bo_reference(bo);
+	return bo;
+}
 
 void
 intel_batchbuffer_reset(struct intel_batchbuffer *batch)
 {
-	if (batch->bo != NULL) {
-		drm_intel_bo_unreference(batch->bo);
-		batch->bo = NULL;
+	batch_put_bo(batch);
+
+	if (batch->chain != NULL) {
+		drm_intel_bo_unreference(batch->chain);
+		batch->chain = NULL;
 	}
+	batch->num_jumps = 0;
 
-	batch->bo = drm_intel_bo_alloc(batch->bufmgr, "batchbuffer",
-				       BATCH_SZ, 4096);
+	if (batch->lut != NULL)
+		lut_reset(batch->lut);
 
-	batch->ptr = batch->buffer;
+	memset(&batch->render, 0, sizeof(batch->render));
+
+	batch_start_bo(batch, batch_pool_get(batch));
+}
+
+/*
+ * Emit straight into a write-combined GTT mapping of each batch bo rather
+ * than into memory that is copied over with a pwrite at flush, which saves
+ * a copy and an ioctl per batch. Reading back from the batch is slow in
+ * this mode. Only allowed while the batch is empty.
+ */
+void
+intel_batchbuffer_set_direct(struct intel_batchbuffer *batch, bool direct)
+{
+	assert(batch->ptr == batch->buffer && batch->chain == NULL);
+
+	batch_put_bo(batch);
+	batch->direct = direct;
+	intel_batchbuffer_reset(batch);
+}
+
+/*
+ * Submit the batch with execbuffer2 on @fd rather than through libdrm,
+ * with the bos looked up by index (handle LUT) and relocations the kernel
+ * may skip when none of the bos moved since the last exec. Not for
+ * rendercopy, which adds relocations behind the batch's back, nor for
+ * flushes with a context. Returns false if the kernel can't do it, leaving
+ * the batch as it was. Only allowed while the batch is empty.
+ */
+bool
+intel_batchbuffer_set_lut(struct intel_batchbuffer *batch, int fd)
+{
+	struct drm_i915_getparam gp;
+	int val = 0;
+
+	assert(batch->ptr == batch->buffer && batch->chain == NULL);
+
+	gp.param = LOCAL_I915_PARAM_HAS_EXEC_HANDLE_LUT;
+	gp.value = &val;
+	if (drmIoctl(fd, DRM_IOCTL_I915_GETPARAM, &gp) || !val)
+		return false;
+
+	if (batch->lut == NULL) {
+		batch->lut = calloc(1, sizeof(*batch->lut));
+		assert(batch->lut != NULL);
+	}
+	batch->lut->fd = fd;
+	intel_batchbuffer_reset(batch);
+
+	return true;
 }
 
+/*
+ * Allocate a batch of @size bytes, rounded up to whole pages. Once that
+ * much is emitted without a flush the batch chains to another bo of the
+ * same size, so @size is about how often that happens, not a limit.
+ */
 struct intel_batchbuffer *
-intel_batchbuffer_alloc(drm_intel_bufmgr *bufmgr, uint32_t devid)
+intel_batchbuffer_alloc_size(drm_intel_bufmgr *bufmgr, uint32_t devid,
+			     unsigned int size)
 {
 	struct intel_batchbuffer *batch = calloc(sizeof(*batch), 1);
 
 	batch->bufmgr = bufmgr;
 	batch->devid = devid;
+	batch->size = size < BATCH_SZ ? BATCH_SZ : (size + 4095) & ~4095;
+	batch->staging = malloc(batch->size);
+	assert(batch->staging != NULL);
 	intel_batchbuffer_reset(batch);
 
 	return batch;
 }
 
+struct intel_batchbuffer *
+intel_batchbuffer_alloc(drm_intel_bufmgr *bufmgr, uint32_t devid)
+{
+	return intel_batchbuffer_alloc_size(bufmgr, devid, BATCH_SZ);
+}
+
 void
 intel_batchbuffer_free(struct intel_batchbuffer *batch)
 {
-	drm_intel_bo_unreference(batch->bo);
-	batch->bo = NULL;
+	int i;
+
+	batch_put_bo(batch);
+	if (batch->chain != NULL)
+		drm_intel_bo_unreference(batch->chain);
+	for (i = 0; i < batch->pool_count; i++)
+		drm_intel_bo_unreference(batch->pool[i]);
+	if (batch->lut != NULL) {
+		lut_reset(batch->lut);
+		free(batch->lut->bos);
+		free(batch->lut->relocs);
+		free(batch->lut->objects);
+		free(batch->lut);
+	}
+	free(batch->jumps);
+	free(batch->staging);
 	free(batch);
 }
 
+/*
+ * The MI_BATCH_BUFFER_START the kernel would use to run a user batch on
+ * @ring. Only Haswell's render ring differs from the others. Gen3 has its
+ * non-secure bit in the address dword instead, see
+ * batch_buffer_start_delta().
+ */
+static uint32_t
+batch_buffer_start(uint32_t devid, int ring)
+{
+	ring &= I915_EXEC_RING_MASK;
+
+	if (IS_HASWELL(devid) &&
+	    (ring == I915_EXEC_DEFAULT || ring == I915_EXEC_RENDER))
+		return MI_BATCH_BUFFER_START |
+			MI_BATCH_PPGTT_HSW | MI_BATCH_NON_SECURE_HSW;
+	if (IS_GEN6(devid) || IS_GEN7(devid))
+		return MI_BATCH_BUFFER_START | MI_BATCH_NON_SECURE_I965;
+	if (IS_965(devid))
+		return MI_BATCH_BUFFER_START | MI_BATCH_GTT |
+			MI_BATCH_NON_SECURE_I965;
+	return MI_BATCH_BUFFER_START | MI_BATCH_GTT;
+}
+
+/* The low bits of the address dword of batch_buffer_start(). */
+static uint32_t
+batch_buffer_start_delta(uint32_t devid)
+{
+	if (IS_965(devid))
+		return 0;
+	return MI_BATCH_NON_SECURE;
+}
+
+/* The ring intel_batchbuffer_flush() uses. */
+static int
+batch_default_ring(struct intel_batchbuffer *batch)
+{
+	if (HAS_BLT_RING(batch->devid))
+		return I915_EXEC_BLT;
+	return 0;
+}
+
+/*
+ * The jumps are written for the default ring, as the ring is only known
+ * at flush. Rewrite them if the batch goes elsewhere and that matters.
+ */
+static void
+batch_set_jumps_ring(struct intel_batchbuffer *batch, int ring)
+{
+	uint32_t cmd = batch_buffer_start(batch->devid, ring);
+	int i;
+
+	if (cmd == batch_buffer_start(batch->devid, batch_default_ring(batch)))
+		return;
+
+	for (i = 0; i < batch->num_jumps; i++)
+		do_or_die(drm_intel_bo_subdata(batch->jumps[i].bo,
+					       batch->jumps[i].offset,
+					       sizeof(cmd), &cmd));
+}
+
+/*
+ * Continue the batch in a fresh bo, jumping to it from the end of the
+ * current one, so that everything emitted since the last flush still goes
+ * out in a single execbuffer. The jump fits in the space kept for the
+ * end of the batch. Gen2 can't run a batch from an arbitrary bo, so there
+ * the batch is flushed instead.
+ */
+void
+intel_batchbuffer_chain(struct intel_batchbuffer *batch)
+{
+	drm_intel_bo *next;
+	unsigned int used;
+	uint32_t delta = batch_buffer_start_delta(batch->devid);
+
+	if (IS_GEN2(batch->devid)) {
+		intel_batchbuffer_flush(batch);
+		return;
+	}
+
+	next = batch_alloc_bo(batch);
+
+	batch->jumps = batch_grow(batch->jumps, &batch->max_jumps,
+				  batch->num_jumps, sizeof(*batch->jumps));
+	batch->jumps[batch->num_jumps].bo = batch->bo;
+	batch->jumps[batch->num_jumps].offset = batch->ptr - batch->buffer;
+	batch->num_jumps++;
+
+	*(uint32_t *)(batch->ptr) =
+		batch_buffer_start(batch->devid, batch_default_ring(batch));
+	batch->ptr += 4;
+	if (batch->lut != NULL) {
+		int i = lut_reloc(batch->lut, batch->ptr - batch->buffer,
+				  next, delta, I915_GEM_DOMAIN_COMMAND, 0, 0);
+
+		lut_end_batch_bo(batch->lut);
+		batch->lut->batch_index = i;
+	} else
+		do_or_die(drm_intel_bo_emit_reloc(batch->bo,
+						  batch->ptr - batch->buffer,
+						  next, delta,
+						  I915_GEM_DOMAIN_COMMAND, 0));
+	*(uint32_t *)(batch->ptr) = next->offset + delta;
+	batch->ptr += 4;
+
+	used = batch->ptr - batch->buffer;
+	batch_upload(batch, used);
+
+	/* past the first bo, the relocation keeps each one alive */
+	if (batch->chain == NULL) {
+		batch->chain = batch->bo;
+		batch->chain_used = used;
+	} else
+		drm_intel_bo_unreference(batch->bo);
+
+	batch_start_bo(batch, next);
+}
+
+/* The bo to execute and, in @used, its length. */
+static drm_intel_bo *
+exec_bo(struct intel_batchbuffer *batch, unsigned int *used)
+{
+	if (batch->chain == NULL)
+		return batch->bo;
+
+	*used = batch->chain_used;
+	return batch->chain;
+}
+
 #define CMD_POLY_STIPPLE_OFFSET       0x7906
 
 static unsigned int
@@ -80,7 +605,8 @@ flush_on_ring_common(struct intel_batchbuffer *batch, int ring)
 {
 	unsigned int used = batch->ptr - batch->buffer;
 
-	if (used == 0)
+	/* a chained batch still needs its last bo ended, even if empty */
+	if (used == 0 && batch->chain == NULL)
 		return 0;
 
 	if (IS_GEN5(batch->devid)) {
@@ -106,16 +632,29 @@ flush_on_ring_common(struct intel_batchbuffer *batch, int ring)
 void
 intel_batchbuffer_flush_on_ring(struct intel_batchbuffer *batch, int ring)
 {
-	unsigned int used = flush_on_ring_common(batch, ring);
+	unsigned int used;
+	drm_intel_bo *bo;
+
+	/* queued copies keep state past the commands, and know their ring */
+	if (batch->render.valid) {
+		batch->render.submit(batch);
+		return;
+	}
 
+	used = flush_on_ring_common(batch, ring);
 	if (used == 0)
 		return;
 
-	do_or_die(drm_intel_bo_subdata(batch->bo, 0, used, batch->buffer));
+	batch_upload(batch, used);
+	batch_set_jumps_ring(batch, ring);
 
 	batch->ptr = NULL;
 
-	do_or_die(drm_intel_bo_mrb_exec(batch->bo, used, NULL, 0, 0, ring));
+	bo = exec_bo(batch, &used);
+	if (batch->lut != NULL)
+		lut_exec(batch->lut, bo, used, ring);
+	else
+		do_or_die(drm_intel_bo_mrb_exec(bo, used, NULL, 0, 0, ring));
 
 	intel_batchbuffer_reset(batch);
 }
@@ -125,17 +664,24 @@ intel_batchbuffer_flush_with_context(struct intel_batchbuffer *batch,
 				     drm_intel_context *context)
 {
 	int ret;
-	unsigned int used = flush_on_ring_common(batch, I915_EXEC_RENDER);
+	unsigned int used;
+	drm_intel_bo *bo;
+
+	/* libdrm keeps the context id to itself */
+	assert(batch->lut == NULL);
+	assert(!batch->render.valid);
 
+	used = flush_on_ring_common(batch, I915_EXEC_RENDER);
 	if (used == 0)
 		return;
 
-	ret = drm_intel_bo_subdata(batch->bo, 0, used, batch->buffer);
-	assert(ret == 0);
+	batch_upload(batch, used);
+	batch_set_jumps_ring(batch, I915_EXEC_RENDER);
 
 	batch->ptr = NULL;
 
-	ret = drm_intel_gem_bo_context_exec(batch->bo, context, used,
+	bo = exec_bo(batch, &used);
+	ret = drm_intel_gem_bo_context_exec(bo, context, used,
 					    I915_EXEC_RENDER);
 	assert(ret == 0);
 
@@ -145,39 +691,57 @@ intel_batchbuffer_flush_with_context(struct intel_batchbuffer *batch,
 void
 intel_batchbuffer_flush(struct intel_batchbuffer *batch)
 {
-	int ring = 0;
-	if (HAS_BLT_RING(batch->devid))
-		ring = I915_EXEC_BLT;
-	intel_batchbuffer_flush_on_ring(batch, ring);
+	intel_batchbuffer_flush_on_ring(batch, batch_default_ring(batch));
 }
 
 
-/*  This is the only way buffers get added to the validate list.
+/*
+ * Record a relocation for the dword at @location in the batch, returns the
+ * presumed address to write there. This is the only way buffers get added
+ * to the validate list.
  */
-void
-intel_batchbuffer_emit_reloc(struct intel_batchbuffer *batch,
-                             drm_intel_bo *buffer, uint32_t delta,
-			     uint32_t read_domains, uint32_t write_domain,
-			     int fenced)
+uint32_t
+intel_batchbuffer_reloc(struct intel_batchbuffer *batch, const void *location,
+			drm_intel_bo *buffer, uint32_t delta,
+			uint32_t read_domains, uint32_t write_domain,
+			int fenced)
 {
+	uint32_t offset = (const uint8_t *)location - batch->buffer;
 	int ret;
 
-	if (batch->ptr - batch->buffer > BATCH_SZ)
+	if (offset + 4 > batch->size)
 		printf("bad relocation ptr %p map %p offset %d size %d\n",
-		       batch->ptr, batch->buffer,
-		       (int)(batch->ptr - batch->buffer),
-		       BATCH_SZ);
-
-	if (fenced)
-		ret = drm_intel_bo_emit_reloc_fence(batch->bo, batch->ptr - batch->buffer,
+		       location, batch->buffer, (int)offset, batch->size);
+
+	if (batch->lut != NULL) {
+		lut_reloc(batch->lut, offset, buffer,
+			  delta, read_domains, write_domain, fenced);
+		ret = 0;
+	} else if (fenced)
+		ret = drm_intel_bo_emit_reloc_fence(batch->bo, offset,
 						    buffer, delta,
 						    read_domains, write_domain);
 	else
-		ret = drm_intel_bo_emit_reloc(batch->bo, batch->ptr - batch->buffer,
+		ret = drm_intel_bo_emit_reloc(batch->bo, offset,
 					      buffer, delta,
 					      read_domains, write_domain);
-	intel_batchbuffer_emit_dword(batch, buffer->offset + delta);
 	assert(ret == 0);
+
+	return buffer->offset + delta;
+}
+
+void
+intel_batchbuffer_emit_reloc(struct intel_batchbuffer *batch,
+                             drm_intel_bo *buffer, uint32_t delta,
+			     uint32_t read_domains, uint32_t write_domain,
+			     int fenced)
+{
+	intel_batchbuffer_emit_dword(batch,
+				     intel_batchbuffer_reloc(batch, batch->ptr,
+							     buffer, delta,
+							     read_domains,
+							     write_domain,
+							     fenced));
 }
 
 void
@@ -214,21 +778,15 @@ intel_copy_bo(struct intel_batchbuffer *batch,
 		cmd_bits |= XY_SRC_COPY_BLT_DST_TILED;
 	}
 
-	BEGIN_BATCH(8);
-	OUT_BATCH(XY_SRC_COPY_BLT_CMD |
-		  XY_SRC_COPY_BLT_WRITE_ALPHA |
-		  XY_SRC_COPY_BLT_WRITE_RGB |
-		  cmd_bits);
-	OUT_BATCH((3 << 24) | /* 32 bits */
-		  (0xcc << 16) | /* copy ROP */
-		  dst_pitch);
-	OUT_BATCH(0); /* dst x1,y1 */
-	OUT_BATCH((height << 16) | width); /* dst x2,y2 */
-	OUT_RELOC(dst_bo, I915_GEM_DOMAIN_RENDER, I915_GEM_DOMAIN_RENDER, 0);
-	OUT_BATCH(0); /* src x1,y1 */
-	OUT_BATCH(src_pitch);
-	OUT_RELOC(src_bo, I915_GEM_DOMAIN_RENDER, 0, 0);
-	ADVANCE_BATCH();
+	intel_emit_xy_src_copy_blt(batch,
+				   XY_SRC_COPY_BLT_WRITE_ALPHA |
+				   XY_SRC_COPY_BLT_WRITE_RGB |
+				   cmd_bits,
+				   (3 << 24) | /* 32 bits */
+				   (0xcc << 16) | /* copy ROP */
+				   dst_pitch,
+				   dst_bo, 0, 0, width, height,
+				   src_bo, src_pitch, 0, 0);
 
 	intel_batchbuffer_flush(batch);
 }
@@ -2,10 +2,32 @@
 #define INTEL_BATCHBUFFER_H
 
 #include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include "i915_drm.h"
 #include "intel_bufmgr.h"
+#include "intel_reg.h"
 
 #define BATCH_SZ 4096
 #define BATCH_RESERVED 16
+#define BATCH_POOL_MAX 8
+
+struct intel_render_surface {
+	drm_intel_bo *bo;
+	uint32_t stride;
+	uint32_t tiling;
+	uint32_t size;
+};
+
+struct intel_batchbuffer;
+
+/* What rendercopy already has in a batch, for the copies that follow. */
+struct intel_render_state {
+	bool valid;		/* the pipeline is set up */
+	struct intel_render_surface src, dst;	/* the bound surfaces */
+	/* what a flush of the batch does instead while valid */
+	void (*submit)(struct intel_batchbuffer *batch);
+};
 
 struct intel_batchbuffer {
 	drm_intel_bufmgr *bufmgr;
@@ -13,13 +35,45 @@ struct intel_batchbuffer {
 
 	drm_intel_bo *bo;
 
-	uint8_t buffer[BATCH_SZ];
+	uint8_t *buffer;	/* the staging copy, or the mapped bo */
+	uint8_t *staging;
+	bool direct;
+	unsigned int size;	/* of the buffer and of every batch bo */
 	uint8_t *ptr;
 	uint8_t *state;
+
+	/* When the buffer fills up the batch continues in a fresh bo, and
+	 * the bo (and length) to execute is the first one of the chain. */
+	drm_intel_bo *chain;
+	unsigned int chain_used;
+
+	/* where the jumps from one bo to the next are, to rewrite them
+	 * for the ring the batch goes to */
+	struct intel_batch_jump {
+		drm_intel_bo *bo;
+		unsigned int offset;
+	} *jumps;
+	int num_jumps, max_jumps;
+
+	/* Batch bos are reused once idle rather than allocated per flush;
+	 * allocs counts the bos allocated, stalls the waits for one. */
+	drm_intel_bo *pool[BATCH_POOL_MAX];
+	int pool_count, pool_next;
+	unsigned long allocs;
+	unsigned long stalls;
+
+	/* set when the batch does its own execbuffer2 */
+	struct intel_batch_lut *lut;
+
+	/* forgotten when the batch is reset */
+	struct intel_render_state render;
 };
 
 struct intel_batchbuffer *intel_batchbuffer_alloc(drm_intel_bufmgr *bufmgr,
 						  uint32_t devid);
+struct intel_batchbuffer *intel_batchbuffer_alloc_size(drm_intel_bufmgr *bufmgr,
+						       uint32_t devid,
+						       unsigned int size);
 
 void intel_batchbuffer_free(struct intel_batchbuffer *batch);
 
@@ -30,6 +84,10 @@ void intel_batchbuffer_flush_with_context(struct intel_batchbuffer *batch,
 					  drm_intel_context *context);
 
 void intel_batchbuffer_reset(struct intel_batchbuffer *batch);
+void intel_batchbuffer_set_direct(struct intel_batchbuffer *batch, bool direct);
+bool intel_batchbuffer_set_lut(struct intel_batchbuffer *batch, int fd);
+
+void intel_batchbuffer_chain(struct intel_batchbuffer *batch);
 
 void intel_batchbuffer_data(struct intel_batchbuffer *batch,
                             const void *data, unsigned int bytes);
@@ -40,6 +98,13 @@ void intel_batchbuffer_emit_reloc(struct intel_batchbuffer *batch,
 				  uint32_t read_domains,
 				  uint32_t write_domain,
 				  int fenced);
+uint32_t intel_batchbuffer_reloc(struct intel_batchbuffer *batch,
+				 const void *location,
+				 drm_intel_bo *buffer,
+				 uint32_t delta,
+				 uint32_t read_domains,
+				 uint32_t write_domain,
+				 int fenced);
 
 /* Inline functions - might actually be better off with these
  * non-inlined.  Certainly better off switching all command packets to
@@ -50,7 +115,7 @@ void intel_batchbuffer_emit_reloc(struct intel_batchbuffer *batch,
 static inline int
 intel_batchbuffer_space(struct intel_batchbuffer *batch)
 {
-	return (BATCH_SZ - BATCH_RESERVED) - (batch->ptr - batch->buffer);
+	return (batch->size - BATCH_RESERVED) - (batch->ptr - batch->buffer);
 }
 
 
@@ -66,9 +131,25 @@ static inline void
 intel_batchbuffer_require_space(struct intel_batchbuffer *batch,
                                 unsigned int sz)
 {
-	assert(sz < BATCH_SZ - BATCH_RESERVED);
+	assert(sz < batch->size - BATCH_RESERVED);
 	if (intel_batchbuffer_space(batch) < sz)
-		intel_batchbuffer_flush(batch);
+		intel_batchbuffer_chain(batch);
+}
+
+/*
+ * Make room for a whole packet of @bytes and return where it goes. The
+ * caller fills all of it, relocations first (with intel_batchbuffer_reloc()
+ * on their place in the packet), then the packet in one store.
+ */
+static inline void *
+intel_batchbuffer_reserve(struct intel_batchbuffer *batch, unsigned int bytes)
+{
+	void *packet;
+
+	intel_batchbuffer_require_space(batch, bytes);
+	packet = batch->ptr;
+	batch->ptr += bytes;
+	return packet;
 }
 
 /* Here are the crusty old macros, to be removed:
@@ -96,6 +177,13 @@ intel_batchbuffer_require_space(struct intel_batchbuffer *batch,
 #define ADVANCE_BATCH() do {						\
 } while(0)
 
+/* A whole packet without relocations: one space check, one copy. */
+#define OUT_PACKET(...) do {						\
+	const uint32_t __packet[] = { __VA_ARGS__ };			\
+	memcpy(intel_batchbuffer_reserve(batch, sizeof(__packet)),	\
+	       __packet, sizeof(__packet));				\
+} while (0)
+
 void
 intel_batchbuffer_emit_mi_flush(struct intel_batchbuffer *batch);
 
@@ -103,6 +191,142 @@ void intel_copy_bo(struct intel_batchbuffer *batch,
 		   drm_intel_bo *dst_bo, drm_intel_bo *src_bo,
 		   int width, int height);
 
+/*
+ * Packets of the common commands, each reserved and stored in one go.
+ * @br13 holds the colour depth, raster op and destination pitch.
+ */
+struct intel_xy_src_copy_blt {
+	uint32_t cmd;
+	uint32_t br13;
+	uint32_t dst_x1y1, dst_x2y2;
+	uint32_t dst;
+	uint32_t src_x1y1;
+	uint32_t src_pitch;
+	uint32_t src;
+};
+
+static inline void
+intel_emit_xy_src_copy_blt(struct intel_batchbuffer *batch,
+			   uint32_t cmd_bits, uint32_t br13,
+			   drm_intel_bo *dst_bo, int dst_x, int dst_y,
+			   int width, int height,
+			   drm_intel_bo *src_bo, uint32_t src_pitch,
+			   int src_x, int src_y)
+{
+	struct intel_xy_src_copy_blt *blt;
+	uint32_t dst, src;
+
+	blt = intel_batchbuffer_reserve(batch, sizeof(*blt));
+	dst = intel_batchbuffer_reloc(batch, &blt->dst, dst_bo, 0,
+				      I915_GEM_DOMAIN_RENDER,
+				      I915_GEM_DOMAIN_RENDER, 0);
+	src = intel_batchbuffer_reloc(batch, &blt->src, src_bo, 0,
+				      I915_GEM_DOMAIN_RENDER, 0, 0);
+
+	*blt = (struct intel_xy_src_copy_blt) {
+		.cmd = XY_SRC_COPY_BLT_CMD | cmd_bits,
+		.br13 = br13,
+		.dst_x1y1 = dst_y << 16 | dst_x,
+		.dst_x2y2 = (dst_y + height) << 16 | (dst_x + width),
+		.dst = dst,
+		.src_x1y1 = src_y << 16 | src_x,
+		.src_pitch = src_pitch,
+		.src = src,
+	};
+}
+
+struct intel_xy_color_blt {
+	uint32_t cmd;
+	uint32_t br13;
+	uint32_t x1y1, x2y2;
+	uint32_t dst;
+	uint32_t color;
+};
+
+static inline void
+intel_emit_xy_color_blt(struct intel_batchbuffer *batch,
+			uint32_t cmd_bits, uint32_t br13,
+			drm_intel_bo *dst_bo, int x, int y,
+			int width, int height, uint32_t color)
+{
+	struct intel_xy_color_blt *blt;
+	uint32_t dst;
+
+	blt = intel_batchbuffer_reserve(batch, sizeof(*blt));
+	dst = intel_batchbuffer_reloc(batch, &blt->dst, dst_bo, 0,
+				      I915_GEM_DOMAIN_RENDER,
+				      I915_GEM_DOMAIN_RENDER, 0);
+
+	*blt = (struct intel_xy_color_blt) {
+		.cmd = XY_COLOR_BLT_CMD | cmd_bits,
+		.br13 = br13,
+		.x1y1 = y << 16 | x,
+		.x2y2 = (y + height) << 16 | (x + width),
+		.dst = dst,
+		.color = color,
+	};
+}
+
+struct intel_store_dword_imm {
+	uint32_t cmd;
+	uint32_t reserved;
+	uint32_t address;
+	uint32_t value;
+};
+
+static inline void
+intel_emit_store_dword_imm(struct intel_batchbuffer *batch,
+			   drm_intel_bo *bo, uint32_t offset, uint32_t value)
+{
+	struct intel_store_dword_imm *store;
+	uint32_t address;
+
+	store = intel_batchbuffer_reserve(batch, sizeof(*store));
+	address = intel_batchbuffer_reloc(batch, &store->address, bo, offset,
+					  I915_GEM_DOMAIN_INSTRUCTION,
+					  I915_GEM_DOMAIN_INSTRUCTION, 0);
+
+	*store = (struct intel_store_dword_imm) {
+		.cmd = MI_STORE_DWORD_IMM,
+		.address = address,
+		.value = value,
+	};
+}
+
+struct intel_pipe_control {
+	uint32_t cmd;
+	uint32_t flags;
+	uint32_t address;
+	uint32_t value;
+};
+
+/*
+ * PIPE_CONTROL in its gen6+ form. With a @bo, @value is written at @offset
+ * in it; address bits like PIPE_CONTROL_GLOBAL_GTT go into @offset.
+ */
+static inline void
+intel_emit_pipe_control(struct intel_batchbuffer *batch, uint32_t flags,
+			drm_intel_bo *bo, uint32_t offset, uint32_t value)
+{
+	struct intel_pipe_control *pc;
+	uint32_t address = 0;
+
+	pc = intel_batchbuffer_reserve(batch, sizeof(*pc));
+	if (bo)
+		address = intel_batchbuffer_reloc(batch, &pc->address, bo,
+						  offset,
+						  I915_GEM_DOMAIN_INSTRUCTION,
+						  I915_GEM_DOMAIN_INSTRUCTION,
+						  0);
+
+	*pc = (struct intel_pipe_control) {
+		.cmd = PIPE_CONTROL,
+		.flags = flags,
+		.address = address,
+		.value = value,
+	};
+}
+
 #define I915_EXEC_CONTEXT_ID_MASK      (0xffffffff)
 #define i915_execbuffer2_set_context_id(eb2, context) \
 	(eb2).rsvd1 = context & I915_EXEC_CONTEXT_ID_MASK
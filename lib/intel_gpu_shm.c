@@ -0,0 +1,211 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "intel_gpu_shm.h"
+
+/* a reader gives up on a writer that died in the middle of an update */
+#define READ_TRIES	1000
+
+/*
+ * Whether the existing segment @name belongs to a writer that is still
+ * running. Segments that aren't ours, or whose writer is gone, are stale.
+ */
+static bool
+shm_in_use(const char *name, pid_t *pid)
+{
+	const struct intel_gpu_shm *shm;
+	struct stat st;
+	bool live = false;
+	int fd;
+
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return false;
+
+	if (fstat(fd, &st) || st.st_size < (off_t)sizeof(*shm)) {
+		close(fd);
+		return false;
+	}
+
+	shm = mmap(NULL, sizeof(*shm), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED)
+		return false;
+
+	if (shm->magic == INTEL_GPU_SHM_MAGIC && shm->pid > 0 &&
+	    (kill(shm->pid, 0) == 0 || errno == EPERM)) {
+		*pid = shm->pid;
+		live = true;
+	}
+
+	munmap((void *)shm, sizeof(*shm));
+	return live;
+}
+
+/*
+ * Create the segment @name, with everything but the header cleared. A
+ * stale segment left behind by a writer that died is replaced, one that
+ * another intel_gpu_top still publishes to is not. The caller fills in
+ * devid and the rates.
+ */
+struct intel_gpu_shm *
+intel_gpu_shm_create(const char *name)
+{
+	struct intel_gpu_shm *shm;
+	pid_t pid;
+	int fd;
+
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0 && errno == EEXIST) {
+		if (shm_in_use(name, &pid)) {
+			fprintf(stderr, "%s is already published by pid %d\n",
+				name, (int)pid);
+			exit(1);
+		}
+
+		shm_unlink(name);
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	}
+	if (fd < 0) {
+		fprintf(stderr, "Couldn't create %s: %s\n",
+			name, strerror(errno));
+		exit(1);
+	}
+
+	if (ftruncate(fd, sizeof(*shm))) {
+		fprintf(stderr, "Couldn't size %s: %s\n",
+			name, strerror(errno));
+		exit(1);
+	}
+
+	shm = mmap(NULL, sizeof(*shm), PROT_READ | PROT_WRITE, MAP_SHARED,
+		   fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED) {
+		fprintf(stderr, "Couldn't map %s: %s\n",
+			name, strerror(errno));
+		exit(1);
+	}
+
+	shm->magic = INTEL_GPU_SHM_MAGIC;
+	shm->version = INTEL_GPU_SHM_VERSION;
+	shm->size = sizeof(*shm);
+	shm->pid = getpid();
+
+	return shm;
+}
+
+void
+intel_gpu_shm_destroy(struct intel_gpu_shm *shm, const char *name)
+{
+	munmap(shm, sizeof(*shm));
+	shm_unlink(name);
+}
+
+const struct intel_gpu_shm *
+intel_gpu_shm_attach(const char *name)
+{
+	const struct intel_gpu_shm *shm;
+	int fd;
+
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) {
+		fprintf(stderr, "Couldn't open %s: %s "
+			"(is intel_gpu_top -P %s running?)\n",
+			name, strerror(errno), name);
+		exit(1);
+	}
+
+	shm = mmap(NULL, sizeof(*shm), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED) {
+		fprintf(stderr, "Couldn't map %s: %s\n",
+			name, strerror(errno));
+		exit(1);
+	}
+
+	if (shm->magic != INTEL_GPU_SHM_MAGIC ||
+	    shm->version != INTEL_GPU_SHM_VERSION ||
+	    shm->size != sizeof(*shm)) {
+		fprintf(stderr, "%s isn't a version %d intel_gpu_top segment\n",
+			name, INTEL_GPU_SHM_VERSION);
+		exit(1);
+	}
+
+	return shm;
+}
+
+void
+intel_gpu_shm_write_begin(uint32_t *seq)
+{
+	__atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+	/* the odd count is seen before any of the data changes */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void
+intel_gpu_shm_write_end(uint32_t *seq)
+{
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Copy @len bytes from @src, protected by @seq, to @dst. Returns false if
+ * the writer never finished an update while we tried.
+ */
+bool
+intel_gpu_shm_read(const uint32_t *seq, void *dst, const void *src,
+		   size_t len)
+{
+	int tries;
+
+	for (tries = 0; tries < READ_TRIES; tries++) {
+		uint32_t start = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+
+		if (start & 1) {
+			sched_yield();
+			continue;
+		}
+
+		memcpy(dst, src, len);
+
+		/* the copy is done before the count is read again */
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(seq, __ATOMIC_RELAXED) == start)
+			return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef INTEL_GPU_SHM_H
+#define INTEL_GPU_SHM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "intel_sampler.h"
+
+/*
+ * Shared memory segment in which intel_gpu_top -P publishes what it
+ * samples, so that any number of local readers can follow the GPU without
+ * touching the hardware. It holds the latest sample, updated every time
+ * the samples are drained, and the aggregates of the last complete
+ * interval, each under its own sequence lock: the writer makes the count
+ * odd while it updates the data that follows it, and a reader retries its
+ * copy until it sees the same even count before and after.
+ *
+ * Times are CLOCK_MONOTONIC, counts are in sampling periods (the rate times
+ * the length of the interval, whatever the number of samples taken), and
+ * the percentiles are p50, p90, p99 and the maximum.
+ */
+#define INTEL_GPU_SHM_NAME		"/intel_gpu_top"
+#define INTEL_GPU_SHM_MAGIC		0x53504749	/* "IGPS" */
+#define INTEL_GPU_SHM_VERSION		1
+
+#define INTEL_GPU_SHM_PERCENTILES	4
+#define INTEL_GPU_SHM_MAX_UNITS		100
+#define INTEL_GPU_SHM_MAX_STATS		16
+
+struct intel_gpu_shm_ring {
+	char name[16];
+	uint32_t size;		/* bytes, 0 if the device doesn't have it */
+	uint32_t wait_mask;	/* 0 if waits aren't sampled */
+	uint32_t idle;		/* periods with nothing queued */
+	uint32_t wait;		/* periods waiting on an event or semaphore */
+	uint64_t full;		/* bytes queued, summed over the periods */
+	uint32_t busy_period[INTEL_GPU_SHM_PERCENTILES];	/* us */
+	uint32_t fill[INTEL_GPU_SHM_PERCENTILES];		/* bytes */
+};
+
+struct intel_gpu_shm_unit {
+	char name[32];
+	uint32_t busy;		/* periods INSTDONE showed the unit busy */
+};
+
+struct intel_gpu_shm_interval {
+	uint64_t end;		/* ns, 0 until the first interval is over */
+	double seconds;
+	uint32_t samples;
+	uint32_t periods;
+	uint32_t busy;		/* periods with work queued on any ring */
+	uint32_t dropped;
+	uint32_t jitter[INTEL_GPU_SHM_PERCENTILES];	/* ns */
+
+	struct intel_gpu_shm_ring ring[INTEL_MAX_RINGS];
+
+	/* in the order of init_instdone_definitions() for the devid */
+	uint32_t num_units;
+	struct intel_gpu_shm_unit unit[INTEL_GPU_SHM_MAX_UNITS];
+
+	/* pipeline statistics at the end and at the start of the interval */
+	uint32_t num_stats;
+	char stat_name[INTEL_GPU_SHM_MAX_STATS][16];
+	uint64_t stats[INTEL_GPU_SHM_MAX_STATS];
+	uint64_t last_stats[INTEL_GPU_SHM_MAX_STATS];
+
+	/* frequency in MHz and rc6, rc6p, rc6pp residency in ms, from sysfs */
+	uint32_t have_freq, have_rc6;
+	uint32_t cur_mhz, min_mhz, max_mhz, rp0_mhz;
+	uint64_t busy_mhz;	/* busy periods times the frequency */
+	uint64_t rc6[3], last_rc6[3];
+};
+
+struct intel_gpu_shm {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;		/* of the whole segment */
+	pid_t pid;		/* of the writer */
+	uint32_t devid;
+	uint32_t rate, idle_rate;
+
+	uint32_t sample_seq;
+	struct intel_sample sample;
+
+	uint32_t interval_seq;
+	struct intel_gpu_shm_interval interval;
+};
+
+struct intel_gpu_shm *intel_gpu_shm_create(const char *name);
+void intel_gpu_shm_destroy(struct intel_gpu_shm *shm, const char *name);
+const struct intel_gpu_shm *intel_gpu_shm_attach(const char *name);
+
+void intel_gpu_shm_write_begin(uint32_t *seq);
+void intel_gpu_shm_write_end(uint32_t *seq);
+bool intel_gpu_shm_read(const uint32_t *seq, void *dst, const void *src,
+			size_t len);
+
+#endif /* INTEL_GPU_SHM_H */
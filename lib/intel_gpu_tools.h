@@ -44,6 +44,7 @@ void intel_get_mmio(struct pci_device *pci_dev);
 int intel_register_access_init(struct pci_device *pci_dev, int safe);
 void intel_register_access_fini(void);
 uint32_t intel_register_read(uint32_t reg);
+void intel_register_read_batch(const uint32_t *regs, uint32_t *vals, int count);
 void intel_register_write(uint32_t reg, uint32_t val);
 /* Following functions are relevant only for SoCs like Valleyview */
 uint32_t intel_dpio_reg_read(uint32_t reg);
@@ -90,6 +91,7 @@ uint64_t intel_get_total_ram_mb(void);
 uint64_t intel_get_total_swap_mb(void);
 
 void intel_map_file(char *);
+void *intel_mmap_file(char *file, size_t *size);
 
 enum pch_type {
 	PCH_IBX,
@@ -55,11 +55,16 @@ static struct _mmio_data {
 	int key;
 } mmio_data;
 
-void
-intel_map_file(char *file)
+/*
+ * Map a register snapshot (as written by intel_reg_snapshot) privately and
+ * return it. If @size is non-NULL it is set to the length of the mapping.
+ */
+void *
+intel_mmap_file(char *file, size_t *size)
 {
 	int fd;
 	struct stat st;
+	void *map;
 
 	fd = open(file, O_RDWR);
 	if (fd == -1) {
@@ -68,13 +73,24 @@ intel_map_file(char *file)
 		    exit(1);
 	}
 	fstat(fd, &st);
-	mmio = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
-	if (mmio == MAP_FAILED) {
+	map = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
 		    fprintf(stderr, "Couldn't mmap %s: %s\n", file,
 			    strerror(errno));
 		    exit(1);
 	}
 	close(fd);
+
+	if (size)
+		*size = st.st_size;
+
+	return map;
+}
+
+void
+intel_map_file(char *file)
+{
+	mmio = intel_mmap_file(file, NULL);
 }
 
 void
@@ -237,6 +253,31 @@ out:
 	return ret;
 }
 
+/*
+ * Read @count registers into @vals in one go. The access checks are done once
+ * for the whole batch rather than per register, which matters for tools that
+ * sample the same set of registers at a high rate.
+ */
+void
+intel_register_read_batch(const uint32_t *regs, uint32_t *vals, int count)
+{
+	int i;
+
+	assert(mmio_data.inited);
+
+	if (intel_gen(mmio_data.i915_devid) >= 6)
+		assert(mmio_data.key != -1);
+
+	if (!mmio_data.safe) {
+		for (i = 0; i < count; i++)
+			vals[i] = *(volatile uint32_t *)((volatile char *)mmio + regs[i]);
+		return;
+	}
+
+	for (i = 0; i < count; i++)
+		vals[i] = intel_register_read(regs[i]);
+}
+
 void
 intel_register_write(uint32_t reg, uint32_t val)
 {
@@ -0,0 +1,831 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The drm_intel_bo entry points used by the batch building code, on top of
+ * plain memory. See intel_mock_bufmgr.h.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "i915_drm.h"
+#include "xf86drm.h"
+#include "intel_mock_bufmgr.h"
+
+#define MOCK_GTT_START	(1 << 20)
+#define MOCK_FD		0x1915
+
+#define LOCAL_I915_EXEC_NO_RELOC (1<<11)
+#define LOCAL_I915_EXEC_HANDLE_LUT (1<<12)
+#define LOCAL_I915_PARAM_HAS_EXEC_HANDLE_LUT 26
+#define ALIGN(v, a)	(((v) + (a) - 1) & ~((uint64_t)(a) - 1))
+
+struct mock_reloc {
+	uint32_t offset;
+	struct mock_bo *target;
+	uint32_t delta;
+	uint32_t read_domains;
+	uint32_t write_domain;
+	bool fenced;
+};
+
+struct mock_bo {
+	drm_intel_bo base;
+	uint64_t gtt_offset;		/* base.offset is what the user knows */
+	int refcount;
+	uint32_t tiling, stride;
+
+	int num_relocs, max_relocs;
+	struct mock_reloc *relocs;
+
+	unsigned int exec_stamp;	/* last exec that listed the bo */
+	bool busy;
+	int map_count;
+};
+
+struct _drm_intel_bufmgr {
+	uint32_t next_handle;
+	uint64_t next_offset;
+	uint32_t next_context;
+	unsigned long live_bos;
+	unsigned long live_maps;
+	struct mock_bo **bos;		/* by handle */
+	int max_bos;
+
+	bool record;
+	bool keep_busy;
+	unsigned int exec_stamp;
+	int num_execs, max_execs;
+	struct intel_mock_exec *execs;
+
+	/* lists of the exec being recorded */
+	int num_buffers, max_buffers;
+	struct intel_mock_buffer *buffers;
+	int num_relocs, max_relocs;
+	struct intel_mock_reloc *relocs;
+	int num_relocated;
+};
+
+struct _drm_intel_context {
+	drm_intel_bufmgr *bufmgr;
+	uint32_t id;
+};
+
+/* the bufmgr behind MOCK_FD */
+static drm_intel_bufmgr *mock_device;
+
+static struct mock_bo *
+to_mock(drm_intel_bo *bo)
+{
+	return (struct mock_bo *)bo;
+}
+
+static void *
+mock_grow(void *array, int *max, int count, size_t elem)
+{
+	if (count < *max)
+		return array;
+
+	*max = *max * 2 + 16;
+	array = realloc(array, *max * elem);
+	if (array == NULL) {
+		fprintf(stderr, "mock bufmgr: out of memory\n");
+		exit(1);
+	}
+	return array;
+}
+
+drm_intel_bufmgr *
+intel_mock_bufmgr_init(void)
+{
+	drm_intel_bufmgr *bufmgr = calloc(1, sizeof(*bufmgr));
+
+	if (bufmgr == NULL)
+		return NULL;
+
+	bufmgr->next_handle = 1;
+	bufmgr->next_offset = MOCK_GTT_START;
+	bufmgr->next_context = 1;
+	bufmgr->record = true;
+
+	return bufmgr;
+}
+
+void
+intel_mock_bufmgr_set_recording(drm_intel_bufmgr *bufmgr, bool record)
+{
+	bufmgr->record = record;
+}
+
+/*
+ * With @keep_busy, executed bos stay busy until waited for instead of
+ * completing right away.
+ */
+void
+intel_mock_bufmgr_set_keep_busy(drm_intel_bufmgr *bufmgr, bool keep_busy)
+{
+	bufmgr->keep_busy = keep_busy;
+}
+
+void
+intel_mock_bufmgr_clear(drm_intel_bufmgr *bufmgr)
+{
+	int i, j;
+
+	for (i = 0; i < bufmgr->num_execs; i++) {
+		struct intel_mock_exec *exec = &bufmgr->execs[i];
+
+		for (j = 0; j < exec->num_buffers; j++)
+			free(exec->buffers[j].data);
+		free(exec->buffers);
+		free(exec->relocs);
+	}
+	bufmgr->num_execs = 0;
+}
+
+int
+intel_mock_bufmgr_num_execs(drm_intel_bufmgr *bufmgr)
+{
+	return bufmgr->num_execs;
+}
+
+const struct intel_mock_exec *
+intel_mock_bufmgr_exec(drm_intel_bufmgr *bufmgr, int i)
+{
+	if (i < 0 || i >= bufmgr->num_execs)
+		return NULL;
+
+	return &bufmgr->execs[i];
+}
+
+const struct intel_mock_buffer *
+intel_mock_exec_buffer(const struct intel_mock_exec *exec, uint32_t handle)
+{
+	int i;
+
+	for (i = 0; i < exec->num_buffers; i++) {
+		if (exec->buffers[i].handle == handle)
+			return &exec->buffers[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * A made up device fd for code that does its own ioctls, like a batch
+ * after intel_batchbuffer_set_lut(). The execbuffers it sees are recorded
+ * like any other. Only the last bufmgr asked for one has it.
+ */
+int
+intel_mock_bufmgr_fd(drm_intel_bufmgr *bufmgr)
+{
+	mock_device = bufmgr;
+	return MOCK_FD;
+}
+
+unsigned long
+intel_mock_bufmgr_live_bos(drm_intel_bufmgr *bufmgr)
+{
+	return bufmgr->live_bos;
+}
+
+/* Maps not undone yet, including those of bos freed while mapped. */
+unsigned long
+intel_mock_bufmgr_live_maps(drm_intel_bufmgr *bufmgr)
+{
+	return bufmgr->live_maps;
+}
+
+void
+drm_intel_bufmgr_destroy(drm_intel_bufmgr *bufmgr)
+{
+	intel_mock_bufmgr_clear(bufmgr);
+	free(bufmgr->execs);
+	free(bufmgr->buffers);
+	free(bufmgr->relocs);
+	free(bufmgr->bos);
+	if (mock_device == bufmgr)
+		mock_device = NULL;
+	free(bufmgr);
+}
+
+drm_intel_bo *
+drm_intel_bo_alloc(drm_intel_bufmgr *bufmgr, const char *name,
+		   unsigned long size, unsigned int alignment)
+{
+	struct mock_bo *bo = calloc(1, sizeof(*bo));
+
+	if (bo == NULL)
+		return NULL;
+
+	size = ALIGN(size, 4096);
+	bo->base.virtual = calloc(1, size);
+	if (bo->base.virtual == NULL) {
+		free(bo);
+		return NULL;
+	}
+
+	if (alignment < 4096)
+		alignment = 4096;
+	bufmgr->next_offset = ALIGN(bufmgr->next_offset, alignment);
+
+	bo->base.size = size;
+	bo->base.align = alignment;
+	bo->base.offset = bufmgr->next_offset;
+	bo->gtt_offset = bufmgr->next_offset;
+	bo->base.bufmgr = bufmgr;
+	bo->base.handle = bufmgr->next_handle++;
+	bo->refcount = 1;
+
+	bufmgr->bos = mock_grow(bufmgr->bos, &bufmgr->max_bos,
+				bo->base.handle, sizeof(*bufmgr->bos));
+	bufmgr->bos[bo->base.handle] = bo;
+
+	bufmgr->next_offset += size;
+	bufmgr->live_bos++;
+
+	return &bo->base;
+}
+
+drm_intel_bo *
+drm_intel_bo_alloc_for_render(drm_intel_bufmgr *bufmgr, const char *name,
+			      unsigned long size, unsigned int alignment)
+{
+	return drm_intel_bo_alloc(bufmgr, name, size, alignment);
+}
+
+void
+drm_intel_bo_reference(drm_intel_bo *bo)
+{
+	to_mock(bo)->refcount++;
+}
+
+static void
+mock_unreference_targets(struct mock_bo *bo, int start)
+{
+	int i;
+
+	for (i = start; i < bo->num_relocs; i++) {
+		if (bo->relocs[i].target != bo)
+			drm_intel_bo_unreference(&bo->relocs[i].target->base);
+	}
+}
+
+void
+drm_intel_bo_unreference(drm_intel_bo *bo)
+{
+	struct mock_bo *mock = to_mock(bo);
+
+	if (bo == NULL || --mock->refcount > 0)
+		return;
+
+	mock_unreference_targets(mock, 0);
+	free(mock->relocs);
+
+	bo->bufmgr->live_bos--;
+	bo->bufmgr->bos[bo->handle] = NULL;
+	free(bo->virtual);
+	free(mock);
+}
+
+/* Maps are counted like libdrm does, which refuses to unmap too often. */
+static int
+mock_map(drm_intel_bo *bo)
+{
+	to_mock(bo)->map_count++;
+	bo->bufmgr->live_maps++;
+	return 0;
+}
+
+static int
+mock_unmap(drm_intel_bo *bo)
+{
+	struct mock_bo *mock = to_mock(bo);
+
+	if (mock->map_count <= 0)
+		return -EINVAL;
+
+	mock->map_count--;
+	bo->bufmgr->live_maps--;
+	return 0;
+}
+
+int
+drm_intel_bo_map(drm_intel_bo *bo, int write_enable)
+{
+	return mock_map(bo);
+}
+
+int
+drm_intel_bo_unmap(drm_intel_bo *bo)
+{
+	return mock_unmap(bo);
+}
+
+int
+drm_intel_gem_bo_map_gtt(drm_intel_bo *bo)
+{
+	return mock_map(bo);
+}
+
+int
+drm_intel_gem_bo_unmap_gtt(drm_intel_bo *bo)
+{
+	return mock_unmap(bo);
+}
+
+int
+drm_intel_gem_bo_map_unsynchronized(drm_intel_bo *bo)
+{
+	return mock_map(bo);
+}
+
+int
+drm_intel_bo_subdata(drm_intel_bo *bo, unsigned long offset,
+		     unsigned long size, const void *data)
+{
+	if (offset > bo->size || size > bo->size - offset)
+		return -EINVAL;
+
+	memcpy((char *)bo->virtual + offset, data, size);
+	return 0;
+}
+
+int
+drm_intel_bo_get_subdata(drm_intel_bo *bo, unsigned long offset,
+			 unsigned long size, void *data)
+{
+	if (offset > bo->size || size > bo->size - offset)
+		return -EINVAL;
+
+	memcpy(data, (char *)bo->virtual + offset, size);
+	return 0;
+}
+
+void
+drm_intel_bo_wait_rendering(drm_intel_bo *bo)
+{
+	to_mock(bo)->busy = false;
+}
+
+int
+drm_intel_bo_busy(drm_intel_bo *bo)
+{
+	return to_mock(bo)->busy;
+}
+
+int
+drm_intel_bo_get_tiling(drm_intel_bo *bo, uint32_t *tiling_mode,
+			uint32_t *swizzle_mode)
+{
+	*tiling_mode = to_mock(bo)->tiling;
+	*swizzle_mode = 0;
+	return 0;
+}
+
+int
+drm_intel_bo_set_tiling(drm_intel_bo *bo, uint32_t *tiling_mode,
+			uint32_t stride)
+{
+	to_mock(bo)->tiling = *tiling_mode;
+	to_mock(bo)->stride = stride;
+	return 0;
+}
+
+static int
+mock_emit_reloc(drm_intel_bo *bo, uint32_t offset, drm_intel_bo *target_bo,
+		uint32_t target_offset, uint32_t read_domains,
+		uint32_t write_domain, bool fenced)
+{
+	struct mock_bo *mock = to_mock(bo);
+	struct mock_reloc *reloc;
+
+	if ((uint64_t)offset + 4 > bo->size)
+		return -EINVAL;
+
+	mock->relocs = mock_grow(mock->relocs, &mock->max_relocs,
+				 mock->num_relocs, sizeof(*mock->relocs));
+	reloc = &mock->relocs[mock->num_relocs++];
+	reloc->offset = offset;
+	reloc->target = to_mock(target_bo);
+	reloc->delta = target_offset;
+	reloc->read_domains = read_domains;
+	reloc->write_domain = write_domain;
+	reloc->fenced = fenced;
+
+	/* like libdrm, a bo doesn't hold a reference on itself */
+	if (target_bo != bo)
+		drm_intel_bo_reference(target_bo);
+	return 0;
+}
+
+int
+drm_intel_bo_emit_reloc(drm_intel_bo *bo, uint32_t offset,
+			drm_intel_bo *target_bo, uint32_t target_offset,
+			uint32_t read_domains, uint32_t write_domain)
+{
+	return mock_emit_reloc(bo, offset, target_bo, target_offset,
+			       read_domains, write_domain, false);
+}
+
+int
+drm_intel_bo_emit_reloc_fence(drm_intel_bo *bo, uint32_t offset,
+			      drm_intel_bo *target_bo, uint32_t target_offset,
+			      uint32_t read_domains, uint32_t write_domain)
+{
+	return mock_emit_reloc(bo, offset, target_bo, target_offset,
+			       read_domains, write_domain, true);
+}
+
+void
+drm_intel_gem_bo_clear_relocs(drm_intel_bo *bo, int start)
+{
+	struct mock_bo *mock = to_mock(bo);
+
+	mock_unreference_targets(mock, start);
+	if (start < mock->num_relocs)
+		mock->num_relocs = start;
+}
+
+drm_intel_context *
+drm_intel_gem_context_create(drm_intel_bufmgr *bufmgr)
+{
+	drm_intel_context *ctx = calloc(1, sizeof(*ctx));
+
+	if (ctx == NULL)
+		return NULL;
+
+	ctx->bufmgr = bufmgr;
+	ctx->id = bufmgr->next_context++;
+	return ctx;
+}
+
+void
+drm_intel_gem_context_destroy(drm_intel_context *ctx)
+{
+	free(ctx);
+}
+
+static void *
+mock_dup(const void *data, size_t size)
+{
+	void *copy = malloc(size);
+
+	if (copy == NULL) {
+		fprintf(stderr, "mock bufmgr: out of memory\n");
+		exit(1);
+	}
+	return memcpy(copy, data, size);
+}
+
+static void
+mock_record_buffer(drm_intel_bufmgr *bufmgr, struct mock_bo *bo, bool copy)
+{
+	struct intel_mock_buffer *buffer;
+
+	bufmgr->buffers = mock_grow(bufmgr->buffers, &bufmgr->max_buffers,
+				    bufmgr->num_buffers,
+				    sizeof(*bufmgr->buffers));
+	buffer = &bufmgr->buffers[bufmgr->num_buffers++];
+	buffer->handle = bo->base.handle;
+	buffer->offset = bo->gtt_offset;
+	buffer->size = bo->base.size;
+	buffer->data = NULL;
+	buffer->flags = 0;
+	if (copy)
+		buffer->data = mock_dup(bo->base.virtual, bo->base.size);
+}
+
+static struct intel_mock_reloc *
+mock_record_reloc(drm_intel_bufmgr *bufmgr)
+{
+	bufmgr->relocs = mock_grow(bufmgr->relocs, &bufmgr->max_relocs,
+				   bufmgr->num_relocs, sizeof(*bufmgr->relocs));
+	return &bufmgr->relocs[bufmgr->num_relocs++];
+}
+
+static void
+mock_record_exec(drm_intel_bufmgr *bufmgr, uint32_t handle, int used,
+		 unsigned int flags, uint32_t context)
+{
+	struct intel_mock_exec *exec;
+
+	bufmgr->execs = mock_grow(bufmgr->execs, &bufmgr->max_execs,
+				  bufmgr->num_execs, sizeof(*bufmgr->execs));
+	exec = &bufmgr->execs[bufmgr->num_execs++];
+	exec->handle = handle;
+	exec->used = used;
+	exec->flags = flags;
+	exec->context = context;
+	exec->num_buffers = bufmgr->num_buffers;
+	exec->buffers = mock_dup(bufmgr->buffers,
+				 bufmgr->num_buffers * sizeof(*exec->buffers));
+	exec->num_relocs = bufmgr->num_relocs;
+	exec->num_relocated = bufmgr->num_relocated;
+	exec->relocs = NULL;
+	if (bufmgr->num_relocs)
+		exec->relocs = mock_dup(bufmgr->relocs,
+					bufmgr->num_relocs *
+					sizeof(*exec->relocs));
+}
+
+/*
+ * Add @bo to the buffer list after the bos it points at, the way libdrm
+ * builds the validation list, and apply its relocations.
+ */
+static void
+mock_add_buffer(drm_intel_bufmgr *bufmgr, struct mock_bo *bo, bool batch)
+{
+	int i;
+
+	if (bo->exec_stamp == bufmgr->exec_stamp)
+		return;
+	bo->exec_stamp = bufmgr->exec_stamp;
+	bo->busy = bufmgr->keep_busy;
+
+	for (i = 0; i < bo->num_relocs; i++) {
+		struct mock_reloc *reloc = &bo->relocs[i];
+		uint32_t *dst = (uint32_t *)((char *)bo->base.virtual +
+					     reloc->offset);
+
+		mock_add_buffer(bufmgr, reloc->target, false);
+		if (*dst != reloc->target->gtt_offset + reloc->delta) {
+			*dst = reloc->target->gtt_offset + reloc->delta;
+			bufmgr->num_relocated++;
+		}
+	}
+	bo->base.offset = bo->gtt_offset;
+
+	if (!bufmgr->record)
+		return;
+
+	mock_record_buffer(bufmgr, bo, batch || bo->num_relocs);
+	for (i = 0; i < bo->num_relocs; i++) {
+		struct intel_mock_reloc *reloc = mock_record_reloc(bufmgr);
+
+		reloc->handle = bo->base.handle;
+		reloc->offset = bo->relocs[i].offset;
+		reloc->target_handle = bo->relocs[i].target->base.handle;
+		reloc->delta = bo->relocs[i].delta;
+		reloc->read_domains = bo->relocs[i].read_domains;
+		reloc->write_domain = bo->relocs[i].write_domain;
+		reloc->fenced = bo->relocs[i].fenced;
+	}
+}
+
+static int
+mock_exec(drm_intel_bo *bo, int used, unsigned int flags, uint32_t context)
+{
+	drm_intel_bufmgr *bufmgr = bo->bufmgr;
+
+	/* what the kernel refuses */
+	if (used <= 0 || used & 7 || used > bo->size)
+		return -EINVAL;
+
+	bufmgr->exec_stamp++;
+	bufmgr->num_buffers = 0;
+	bufmgr->num_relocs = 0;
+	bufmgr->num_relocated = 0;
+	mock_add_buffer(bufmgr, to_mock(bo), true);
+
+	if (bufmgr->record)
+		mock_record_exec(bufmgr, bo->handle, used, flags, context);
+
+	return 0;
+}
+
+int
+drm_intel_bo_mrb_exec(drm_intel_bo *bo, int used, struct drm_clip_rect *cliprects,
+		      int num_cliprects, int DR4, unsigned int flags)
+{
+	return mock_exec(bo, used, flags, 0);
+}
+
+int
+drm_intel_bo_exec(drm_intel_bo *bo, int used, struct drm_clip_rect *cliprects,
+		  int num_cliprects, int DR4)
+{
+	return mock_exec(bo, used, I915_EXEC_RENDER, 0);
+}
+
+int
+drm_intel_gem_bo_context_exec(drm_intel_bo *bo, drm_intel_context *ctx,
+			      int used, unsigned int flags)
+{
+	return mock_exec(bo, used, flags, ctx ? ctx->id : 0);
+}
+
+static struct mock_bo *
+mock_lookup(drm_intel_bufmgr *bufmgr, uint32_t handle)
+{
+	if (handle == 0 || handle >= bufmgr->next_handle)
+		return NULL;
+
+	return bufmgr->bos[handle];
+}
+
+/* The index in @objects of the target of @reloc, or -1. */
+static int
+mock_find_target(const struct drm_i915_gem_execbuffer2 *execbuf,
+		 const struct drm_i915_gem_exec_object2 *objects,
+		 const struct drm_i915_gem_relocation_entry *reloc)
+{
+	unsigned int i;
+
+	if (execbuf->flags & LOCAL_I915_EXEC_HANDLE_LUT)
+		return reloc->target_handle < execbuf->buffer_count ?
+			(int)reloc->target_handle : -1;
+
+	for (i = 0; i < execbuf->buffer_count; i++) {
+		if (objects[i].handle == reloc->target_handle)
+			return i;
+	}
+	return -1;
+}
+
+/*
+ * An execbuffer2 put together by the caller, with the batch last. Like the
+ * kernel, only relocations with a stale presumed offset are written, and
+ * with I915_EXEC_NO_RELOC none are while every bo is where the list says.
+ */
+static int
+mock_execbuffer2(drm_intel_bufmgr *bufmgr,
+		 struct drm_i915_gem_execbuffer2 *execbuf)
+{
+	struct drm_i915_gem_exec_object2 *objects =
+		(void *)(uintptr_t)execbuf->buffers_ptr;
+	struct mock_bo *batch_bo;
+	bool relocate = !(execbuf->flags & LOCAL_I915_EXEC_NO_RELOC);
+	unsigned int i, j;
+
+	/* what the kernel refuses */
+	if (execbuf->buffer_count == 0)
+		return -EINVAL;
+
+	for (i = 0; i < execbuf->buffer_count; i++) {
+		struct drm_i915_gem_relocation_entry *relocs =
+			(void *)(uintptr_t)objects[i].relocs_ptr;
+		struct mock_bo *bo = mock_lookup(bufmgr, objects[i].handle);
+
+		if (bo == NULL)
+			return -ENOENT;
+		if (objects[i].offset != bo->gtt_offset)
+			relocate = true;
+
+		for (j = 0; j < objects[i].relocation_count; j++) {
+			if (mock_find_target(execbuf, objects, &relocs[j]) < 0)
+				return -ENOENT;
+			if (relocs[j].offset + 4 > bo->base.size)
+				return -EINVAL;
+		}
+	}
+
+	batch_bo = mock_lookup(bufmgr, objects[i - 1].handle);
+	if (execbuf->batch_len == 0 || execbuf->batch_len & 7 ||
+	    execbuf->batch_len > batch_bo->base.size)
+		return -EINVAL;
+
+	bufmgr->exec_stamp++;
+	bufmgr->num_buffers = 0;
+	bufmgr->num_relocs = 0;
+	bufmgr->num_relocated = 0;
+	for (i = 0; i < execbuf->buffer_count; i++) {
+		struct drm_i915_gem_relocation_entry *relocs =
+			(void *)(uintptr_t)objects[i].relocs_ptr;
+		struct mock_bo *bo = mock_lookup(bufmgr, objects[i].handle);
+
+		bo->exec_stamp = bufmgr->exec_stamp;
+		bo->busy = bufmgr->keep_busy;
+
+		for (j = 0; j < objects[i].relocation_count; j++) {
+			struct drm_i915_gem_relocation_entry *reloc = &relocs[j];
+			int t = mock_find_target(execbuf, objects, reloc);
+			struct mock_bo *target = mock_lookup(bufmgr,
+							     objects[t].handle);
+
+			if (!relocate ||
+			    reloc->presumed_offset == target->gtt_offset)
+				continue;
+
+			*(uint32_t *)((char *)bo->base.virtual + reloc->offset) =
+				target->gtt_offset + reloc->delta;
+			reloc->presumed_offset = target->gtt_offset;
+			bufmgr->num_relocated++;
+		}
+
+		if (!bufmgr->record)
+			continue;
+
+		mock_record_buffer(bufmgr, bo,
+				   bo == batch_bo || objects[i].relocation_count);
+		bufmgr->buffers[bufmgr->num_buffers - 1].flags =
+			objects[i].flags;
+		for (j = 0; j < objects[i].relocation_count; j++) {
+			int t = mock_find_target(execbuf, objects, &relocs[j]);
+			struct intel_mock_reloc *reloc = mock_record_reloc(bufmgr);
+
+			reloc->handle = bo->base.handle;
+			reloc->offset = relocs[j].offset;
+			reloc->target_handle = objects[t].handle;
+			reloc->delta = relocs[j].delta;
+			reloc->read_domains = relocs[j].read_domains;
+			reloc->write_domain = relocs[j].write_domain;
+			reloc->fenced = objects[t].flags & EXEC_OBJECT_NEEDS_FENCE;
+		}
+	}
+
+	/* where the bos are, for the next execbuffer to presume */
+	for (i = 0; i < execbuf->buffer_count; i++) {
+		struct mock_bo *bo = mock_lookup(bufmgr, objects[i].handle);
+
+		objects[i].offset = bo->gtt_offset;
+	}
+
+	if (bufmgr->record)
+		mock_record_exec(bufmgr, batch_bo->base.handle,
+				 execbuf->batch_len, execbuf->flags,
+				 execbuf->rsvd1 & 0xffffffff);
+
+	return 0;
+}
+
+static int
+mock_getparam(drm_i915_getparam_t *gp)
+{
+	if (gp->param != LOCAL_I915_PARAM_HAS_EXEC_HANDLE_LUT)
+		return -EINVAL;
+
+	*gp->value = 1;
+	return 0;
+}
+
+static int
+mock_busy(drm_intel_bufmgr *bufmgr, struct drm_i915_gem_busy *busy)
+{
+	struct mock_bo *bo = mock_lookup(bufmgr, busy->handle);
+
+	if (bo == NULL)
+		return -ENOENT;
+
+	busy->busy = bo->busy;
+	return 0;
+}
+
+/*
+ * No kernel behind the mock, so only the ioctls a batch doing its own
+ * execbuffer needs work, and only on the fd from intel_mock_bufmgr_fd().
+ */
+int
+drmIoctl(int fd, unsigned long request, void *arg)
+{
+	int ret;
+
+	if (fd != MOCK_FD || mock_device == NULL) {
+		errno = ENODEV;
+		return -1;
+	}
+
+	switch (request) {
+	case DRM_IOCTL_I915_GETPARAM:
+		ret = mock_getparam(arg);
+		break;
+	case DRM_IOCTL_I915_GEM_BUSY:
+		ret = mock_busy(mock_device, arg);
+		break;
+	case DRM_IOCTL_I915_GEM_EXECBUFFER2:
+		ret = mock_execbuffer2(mock_device, arg);
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	if (ret) {
+		errno = -ret;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef INTEL_MOCK_BUFMGR_H
+#define INTEL_MOCK_BUFMGR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "intel_bufmgr.h"
+
+/*
+ * In-memory stand-in for the GEM buffer manager of libdrm, so that batches
+ * can be built, checked and timed without an i915 device. Programs link
+ * against libintel_mock.la instead of libintel_tools.la and libdrm_intel,
+ * and create their bufmgr with intel_mock_bufmgr_init().
+ *
+ * Bos are plain memory at fixed, made up GTT offsets, so relocations are
+ * applied at exec time just like the kernel would, and never move. Setting
+ * bo->offset to 0 makes the bo look fresh, placed by its next exec. Every
+ * exec is recorded along with its relocations and buffer list, and
+ * completes immediately unless the bufmgr is told to keep bos busy. So are
+ * the execbuffers done with ioctls on intel_mock_bufmgr_fd().
+ */
+
+struct intel_mock_reloc {
+	uint32_t handle;	/* of the bo the relocation is in */
+	uint32_t offset;	/* in that bo */
+	uint32_t target_handle;
+	uint32_t delta;
+	uint32_t read_domains;
+	uint32_t write_domain;
+	bool fenced;
+};
+
+struct intel_mock_buffer {
+	uint32_t handle;
+	uint64_t offset;	/* in the GTT */
+	unsigned long size;
+	uint32_t *data;		/* copy of the contents at exec time, only
+				 * for the bos that have relocations */
+	uint64_t flags;		/* of the exec object, only for
+				 * execbuffers done with ioctls */
+};
+
+struct intel_mock_exec {
+	uint32_t handle;	/* of the batch */
+	unsigned int used;	/* batch length */
+	unsigned int flags;	/* ring and other exec flags */
+	uint32_t context;	/* 0 for the default context */
+
+	int num_buffers;	/* in validation order, the batch last */
+	struct intel_mock_buffer *buffers;
+
+	int num_relocs;		/* of all the buffers */
+	struct intel_mock_reloc *relocs;
+	int num_relocated;	/* that had to be written, the others
+				 * were right already */
+};
+
+drm_intel_bufmgr *intel_mock_bufmgr_init(void);
+
+int intel_mock_bufmgr_num_execs(drm_intel_bufmgr *bufmgr);
+const struct intel_mock_exec *intel_mock_bufmgr_exec(drm_intel_bufmgr *bufmgr,
+						     int i);
+const struct intel_mock_buffer *intel_mock_exec_buffer(const struct intel_mock_exec *exec,
+						       uint32_t handle);
+void intel_mock_bufmgr_clear(drm_intel_bufmgr *bufmgr);
+void intel_mock_bufmgr_set_recording(drm_intel_bufmgr *bufmgr, bool record);
+void intel_mock_bufmgr_set_keep_busy(drm_intel_bufmgr *bufmgr, bool keep_busy);
+int intel_mock_bufmgr_fd(drm_intel_bufmgr *bufmgr);
+
+unsigned long intel_mock_bufmgr_live_bos(drm_intel_bufmgr *bufmgr);
+unsigned long intel_mock_bufmgr_live_maps(drm_intel_bufmgr *bufmgr);
+
+#endif /* INTEL_MOCK_BUFMGR_H */
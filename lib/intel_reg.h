@@ -905,6 +905,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define RING_REPORT_64K     0x00000002
 #define RING_REPORT_128K    0x00000004
 #define RING_NO_REPORT      0x00000000
+#define RING_WAIT_SEMAPHORE 0x00000400 /* gen6+ */
+#define RING_WAIT           0x00000800 /* gen3+ */
 #define RING_VALID_MASK     0x00000001
 #define RING_VALID          0x00000001
 #define RING_INVALID        0x00000000
@@ -2727,6 +2729,12 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define MI_STORE_DWORD_IMM		((0x20<<23)|2)
 #define   MI_MEM_VIRTUAL	(1 << 22) /* 965+ only */
 
+/* the 4 dword gen6+ form */
+#define PIPE_CONTROL			((0x3<<29)|(0x3<<27)|(0x2<<24)|2)
+#define   PIPE_CONTROL_CS_STALL		(1<<20)
+#define   PIPE_CONTROL_WRITE_IMMEDIATE	(1<<14)
+#define   PIPE_CONTROL_GLOBAL_GTT	(1<<2) /* in the address */
+
 #define MI_SET_CONTEXT			(0x18<<23)
 #define CTXT_NO_RESTORE			(1)
 #define CTXT_PALETTE_SAVE_DISABLE	(1<<3)
@@ -2782,6 +2790,9 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define MI_BATCH_BUFFER_END	(0xA << 23)
 #define MI_BATCH_NON_SECURE		(1)
 #define MI_BATCH_NON_SECURE_I965	(1 << 8)
+#define MI_BATCH_NON_SECURE_HSW		(1 << 13)
+#define MI_BATCH_PPGTT_HSW		(1 << 8)
+#define MI_BATCH_GTT			(2 << 6)
 
 #define MAX_DISPLAY_PIPES	2
 
@@ -0,0 +1,279 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "intel_reg_desc.h"
+
+/*
+ * Everything below is generated from intel_reg_desc.def by the
+ * preprocessor, so adding a register or field only means editing that file.
+ */
+
+/* values are numbered like fields, with a marker at the start of each field */
+enum intel_reg_value_id {
+#define LAYOUT(layout)
+#define FIELD(layout, field, high, low, bias) \
+	VALUES_##layout##_##field, \
+	VALUES_##layout##_##field##_ = VALUES_##layout##_##field - 1,
+#define VALUE(layout, field, value, name) VALUE_##layout##_##field##_##value,
+#define REG(reg, offset, gens, layout, desc)
+#include "intel_reg_desc.def"
+#undef LAYOUT
+#undef FIELD
+#undef VALUE
+#undef REG
+	INTEL_VALUE_COUNT
+};
+
+/*
+ * All the names and descriptions live in a single string pool. Each string
+ * is a member of this struct so that offsetof() gives its position.
+ */
+struct intel_reg_desc_pool {
+#define LAYOUT(layout)
+#define FIELD(layout, field, high, low, bias) char field_##layout##_##field[sizeof(#field)];
+#define VALUE(layout, field, value, name) char value_##layout##_##field##_##value[sizeof(name)];
+#define REG(reg, offset, gens, layout, desc) \
+	char reg_##reg[sizeof(#reg)]; \
+	char desc_##reg[sizeof(desc)];
+#include "intel_reg_desc.def"
+#undef LAYOUT
+#undef FIELD
+#undef VALUE
+#undef REG
+};
+
+/* offsets into the pool are stored as uint16_t */
+typedef char intel_reg_desc_pool_fits[sizeof(struct intel_reg_desc_pool) <= 0xffff ? 1 : -1];
+
+static const struct intel_reg_desc_pool pool = {
+#define LAYOUT(layout)
+#define FIELD(layout, field, high, low, bias) #field,
+#define VALUE(layout, field, value, name) name,
+#define REG(reg, offset, gens, layout, desc) #reg, desc,
+#include "intel_reg_desc.def"
+#undef LAYOUT
+#undef FIELD
+#undef VALUE
+#undef REG
+};
+
+const char *const intel_reg_desc_strings = (const char *)&pool;
+
+#define POOL(member) offsetof(struct intel_reg_desc_pool, member)
+
+const struct intel_reg_desc intel_reg_descs[INTEL_REG_COUNT] = {
+#define LAYOUT(layout)
+#define FIELD(layout, field, high, low, bias)
+#define VALUE(layout, field, value, name)
+#define REG(reg, _offset, _gens, _layout, desc) \
+	[INTEL_REG_##reg] = { \
+		.offset = _offset, \
+		.gens = _gens, \
+		.layout = INTEL_LAYOUT_##_layout, \
+		.name = POOL(reg_##reg), \
+		.description = POOL(desc_##reg), \
+	},
+#include "intel_reg_desc.def"
+#undef LAYOUT
+#undef FIELD
+#undef VALUE
+#undef REG
+};
+
+const uint16_t intel_reg_layouts[INTEL_LAYOUT_COUNT + 1] = {
+#define LAYOUT(layout) [INTEL_LAYOUT_##layout] = INTEL_LAYOUT_FIELDS_##layout,
+#define FIELD(layout, field, high, low, bias)
+#define VALUE(layout, field, value, name)
+#define REG(reg, offset, gens, layout, desc)
+#include "intel_reg_desc.def"
+#undef LAYOUT
+#undef FIELD
+#undef VALUE
+#undef REG
+	[INTEL_LAYOUT_COUNT] = INTEL_FIELD_COUNT,
+};
+
+const struct intel_reg_field intel_reg_fields[INTEL_FIELD_COUNT + 1] = {
+#define LAYOUT(layout)
+#define FIELD(layout, field, _high, _low, _bias) \
+	[INTEL_FIELD_##layout##_##field] = { \
+		.high = _high, \
+		.low = _low, \
+		.bias = _bias, \
+		.name = POOL(field_##layout##_##field), \
+		.first_value = VALUES_##layout##_##field, \
+	},
+#define VALUE(layout, field, value, name)
+#define REG(reg, offset, gens, layout, desc)
+#include "intel_reg_desc.def"
+#undef LAYOUT
+#undef FIELD
+#undef VALUE
+#undef REG
+	[INTEL_FIELD_COUNT] = { .first_value = INTEL_VALUE_COUNT },
+};
+
+const struct intel_reg_value intel_reg_values[INTEL_VALUE_COUNT + 1] = {
+#define LAYOUT(layout)
+#define FIELD(layout, field, high, low, bias)
+#define VALUE(layout, field, _value, _name) \
+	[VALUE_##layout##_##field##_##_value] = { \
+		.value = _value, \
+		.name = POOL(value_##layout##_##field##_##_value), \
+	},
+#define REG(reg, offset, gens, layout, desc)
+#include "intel_reg_desc.def"
+#undef LAYOUT
+#undef FIELD
+#undef VALUE
+#undef REG
+};
+
+#undef POOL
+
+/* register ids sorted by offset, built on first lookup */
+static uint16_t *by_offset;
+
+static int
+by_offset_cmp(const void *a, const void *b)
+{
+	uint32_t offset_a = intel_reg_descs[*(const uint16_t *)a].offset;
+	uint32_t offset_b = intel_reg_descs[*(const uint16_t *)b].offset;
+
+	if (offset_a != offset_b)
+		return offset_a < offset_b ? -1 : 1;
+
+	return *(const uint16_t *)a - *(const uint16_t *)b;
+}
+
+/*
+ * Find the register at @offset that exists on @gen. Returns its
+ * enum intel_reg_id or -1 if the database doesn't describe it.
+ */
+int
+intel_reg_lookup(uint32_t offset, int gen)
+{
+	int lo, hi;
+
+	if (by_offset == NULL) {
+		uint16_t *sorted;
+		int i;
+
+		sorted = malloc(INTEL_REG_COUNT * sizeof(*sorted));
+		if (sorted == NULL)
+			return -1;
+
+		for (i = 0; i < INTEL_REG_COUNT; i++)
+			sorted[i] = i;
+		qsort(sorted, INTEL_REG_COUNT, sizeof(*sorted), by_offset_cmp);
+
+		/* several threads may decode at once, first one wins */
+		if (!__sync_bool_compare_and_swap(&by_offset, NULL, sorted))
+			free(sorted);
+	}
+
+	lo = 0;
+	hi = INTEL_REG_COUNT;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (intel_reg_descs[by_offset[mid]].offset < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (; lo < INTEL_REG_COUNT; lo++) {
+		if (intel_reg_descs[by_offset[lo]].offset != offset)
+			break;
+		if (intel_reg_valid(by_offset[lo], gen))
+			return by_offset[lo];
+	}
+
+	return -1;
+}
+
+/*
+ * Generic decode of @val into "field value, ..." from the register's layout.
+ * Single bit fields without named values are only listed when set, numbers
+ * are printed with the field's bias added. Returns the number of fields
+ * decoded.
+ */
+int
+intel_reg_decode(enum intel_reg_id reg, uint32_t val, char *result, int len)
+{
+	int layout = intel_reg_descs[reg].layout;
+	int field, n = 0, pos = 0;
+
+	result[0] = '\0';
+
+	for (field = intel_reg_layouts[layout];
+	     field < intel_reg_layouts[layout + 1]; field++) {
+		const struct intel_reg_field *f = &intel_reg_fields[field];
+		uint32_t v = intel_reg_field_get(field, val);
+		const char *value_name = NULL;
+		char name[64];
+		int i;
+
+		for (i = f->first_value; i < intel_reg_fields[field + 1].first_value; i++) {
+			if (intel_reg_values[i].value == v) {
+				value_name = &intel_reg_desc_strings[intel_reg_values[i].name];
+				break;
+			}
+		}
+
+		if (f->high == f->low && f->first_value == intel_reg_fields[field + 1].first_value &&
+		    !v)
+			continue;
+
+		/* FIELD_NAME -> "field name" */
+		for (i = 0; intel_reg_desc_strings[f->name + i] && i < sizeof(name) - 1; i++) {
+			char c = intel_reg_desc_strings[f->name + i];
+
+			name[i] = c == '_' ? ' ' : tolower(c);
+		}
+		name[i] = '\0';
+
+		if (pos >= len)
+			break;
+
+		if (value_name)
+			pos += snprintf(result + pos, len - pos, "%s%s %s",
+					n ? ", " : "", name, value_name);
+		else if (f->high == f->low)
+			pos += snprintf(result + pos, len - pos, "%s%s",
+					n ? ", " : "", name);
+		else
+			pos += snprintf(result + pos, len - pos, "%s%s %u",
+					n ? ", " : "", name, v + f->bias);
+		n++;
+	}
+
+	return n;
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef INTEL_REG_DESC_H
+#define INTEL_REG_DESC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Mask of the hardware generations [lo, hi] a register exists on. */
+#define INTEL_GENS(lo, hi)	((uint16_t)(((1 << ((hi) + 1)) - 1) & ~((1 << (lo)) - 1)))
+
+enum intel_reg_id {
+#define LAYOUT(layout)
+#define FIELD(layout, field, high, low, bias)
+#define VALUE(layout, field, value, name)
+#define REG(reg, offset, gens, layout, desc) INTEL_REG_##reg,
+#include "intel_reg_desc.def"
+#undef LAYOUT
+#undef FIELD
+#undef VALUE
+#undef REG
+	INTEL_REG_COUNT
+};
+
+/* The offsets as constants, for static tables of registers. */
+enum intel_reg_offset {
+#define LAYOUT(layout)
+#define FIELD(layout, field, high, low, bias)
+#define VALUE(layout, field, value, name)
+#define REG(reg, offset, gens, layout, desc) INTEL_REG_OFFSET_##reg = offset,
+#include "intel_reg_desc.def"
+#undef LAYOUT
+#undef FIELD
+#undef VALUE
+#undef REG
+};
+
+enum intel_reg_layout_id {
+#define LAYOUT(layout) INTEL_LAYOUT_##layout,
+#define FIELD(layout, field, high, low, bias)
+#define VALUE(layout, field, value, name)
+#define REG(reg, offset, gens, layout, desc)
+#include "intel_reg_desc.def"
+#undef LAYOUT
+#undef FIELD
+#undef VALUE
+#undef REG
+	INTEL_LAYOUT_COUNT
+};
+
+/*
+ * Fields are numbered in file order. Every layout also gets an
+ * INTEL_LAYOUT_FIELDS_<layout> marker equal to the index of its first field,
+ * which is how the tables know where each layout's fields start.
+ */
+enum intel_reg_field_id {
+#define LAYOUT(layout) \
+	INTEL_LAYOUT_FIELDS_##layout, \
+	INTEL_LAYOUT_FIELDS_##layout##_ = INTEL_LAYOUT_FIELDS_##layout - 1,
+#define FIELD(layout, field, high, low, bias) INTEL_FIELD_##layout##_##field,
+#define VALUE(layout, field, value, name)
+#define REG(reg, offset, gens, layout, desc)
+#include "intel_reg_desc.def"
+#undef LAYOUT
+#undef FIELD
+#undef VALUE
+#undef REG
+	INTEL_FIELD_COUNT
+};
+
+/*
+ * Packed descriptors. Names are offsets into intel_reg_desc_strings. The
+ * fields of a layout run from intel_reg_layouts[layout] up to the next
+ * layout's first field, and likewise for the values of a field.
+ */
+struct intel_reg_desc {
+	uint32_t offset;
+	uint16_t gens;
+	uint16_t layout;
+	uint16_t name;
+	uint16_t description;
+};
+
+struct intel_reg_field {
+	uint8_t high, low;
+	uint8_t bias;
+	uint16_t name;
+	uint16_t first_value;
+};
+
+struct intel_reg_value {
+	uint32_t value;
+	uint16_t name;
+};
+
+extern const struct intel_reg_desc intel_reg_descs[INTEL_REG_COUNT];
+extern const uint16_t intel_reg_layouts[INTEL_LAYOUT_COUNT + 1];
+extern const struct intel_reg_field intel_reg_fields[INTEL_FIELD_COUNT + 1];
+extern const struct intel_reg_value intel_reg_values[];
+extern const char *const intel_reg_desc_strings;
+
+static inline uint32_t
+intel_reg_offset(enum intel_reg_id reg)
+{
+	return intel_reg_descs[reg].offset;
+}
+
+static inline const char *
+intel_reg_name(enum intel_reg_id reg)
+{
+	return &intel_reg_desc_strings[intel_reg_descs[reg].name];
+}
+
+static inline const char *
+intel_reg_description(enum intel_reg_id reg)
+{
+	return &intel_reg_desc_strings[intel_reg_descs[reg].description];
+}
+
+static inline bool
+intel_reg_valid(enum intel_reg_id reg, int gen)
+{
+	return intel_reg_descs[reg].gens & (1 << gen);
+}
+
+static inline uint32_t
+intel_reg_field_mask(enum intel_reg_field_id field)
+{
+	const struct intel_reg_field *f = &intel_reg_fields[field];
+
+	return (uint32_t)(((uint64_t)1 << (f->high + 1)) - 1) & ~((1u << f->low) - 1);
+}
+
+/* Extract @field from the register value @val. */
+static inline uint32_t
+intel_reg_field_get(enum intel_reg_field_id field, uint32_t val)
+{
+	return (val & intel_reg_field_mask(field)) >> intel_reg_fields[field].low;
+}
+
+/* Shift @value into the position of @field. */
+static inline uint32_t
+intel_reg_field_set(enum intel_reg_field_id field, uint32_t value)
+{
+	return (value << intel_reg_fields[field].low) & intel_reg_field_mask(field);
+}
+
+/* MMIO accessors taking an enum intel_reg_id, see intel_gpu_tools.h */
+#define DESC_INREG(reg)		INREG(intel_reg_offset(reg))
+#define DESC_OUTREG(reg, val)	OUTREG(intel_reg_offset(reg), val)
+
+int intel_reg_lookup(uint32_t offset, int gen);
+int intel_reg_decode(enum intel_reg_id reg, uint32_t val, char *result, int len);
+
+#endif /* INTEL_REG_DESC_H */
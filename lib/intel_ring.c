@@ -0,0 +1,82 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "intel_ring.h"
+#include "intel_chipset.h"
+#include "intel_reg.h"
+
+#define ARRAY_SIZE(arr) (sizeof(arr)/sizeof(arr[0]))
+
+static const struct intel_ring_desc gen2_rings[] = {
+	{ "render", LP_RING, 0 },
+};
+
+static const struct intel_ring_desc gen3_rings[] = {
+	{ "render", LP_RING, RING_WAIT },
+};
+
+static const struct intel_ring_desc g4x_rings[] = {
+	{ "render", LP_RING, RING_WAIT },
+	{ "bitstream", 0x4030, RING_WAIT },
+};
+
+static const struct intel_ring_desc gen6_rings[] = {
+	{ "render", LP_RING, RING_WAIT | RING_WAIT_SEMAPHORE },
+	{ "bitstream", 0x12030, RING_WAIT | RING_WAIT_SEMAPHORE },
+	{ "blitter", 0x22030, RING_WAIT | RING_WAIT_SEMAPHORE },
+};
+
+static const struct intel_ring_desc hsw_rings[] = {
+	{ "render", LP_RING, RING_WAIT | RING_WAIT_SEMAPHORE },
+	{ "bitstream", 0x12030, RING_WAIT | RING_WAIT_SEMAPHORE },
+	{ "blitter", 0x22030, RING_WAIT | RING_WAIT_SEMAPHORE },
+	{ "vebox", 0x1a030, RING_WAIT | RING_WAIT_SEMAPHORE },
+};
+
+/*
+ * Point @rings at the table of the rings @devid has, render first, and
+ * return how many there are.
+ */
+int
+intel_get_rings(uint32_t devid, const struct intel_ring_desc **rings)
+{
+	if (IS_HASWELL(devid)) {
+		*rings = hsw_rings;
+		return ARRAY_SIZE(hsw_rings);
+	}
+	if (IS_GEN6(devid) || IS_GEN7(devid)) {
+		*rings = gen6_rings;
+		return ARRAY_SIZE(gen6_rings);
+	}
+	if (IS_G4X(devid) || IS_GEN5(devid)) {
+		*rings = g4x_rings;
+		return ARRAY_SIZE(g4x_rings);
+	}
+	if (IS_GEN3(devid) || IS_GEN4(devid)) {
+		*rings = gen3_rings;
+		return ARRAY_SIZE(gen3_rings);
+	}
+
+	*rings = gen2_rings;
+	return ARRAY_SIZE(gen2_rings);
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef INTEL_RING_H
+#define INTEL_RING_H
+
+#include <stdint.h>
+
+#define INTEL_MAX_RINGS		4
+
+/*
+ * A command streamer, with the registers worth sampling to see what it is
+ * up to. Registers a ring doesn't have are 0.
+ */
+struct intel_ring_desc {
+	const char *name;
+	uint32_t mmio;		/* RING_TAIL, RING_HEAD, RING_START, RING_LEN */
+	uint32_t wait_mask;	/* RING_LEN bits set while the ring waits */
+};
+
+int intel_get_rings(uint32_t devid, const struct intel_ring_desc **rings);
+
+#endif /* INTEL_RING_H */
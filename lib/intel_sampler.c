@@ -0,0 +1,264 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "intel_sampler.h"
+#include "intel_gpu_tools.h"
+
+static uint64_t
+timespec_to_ns(const struct timespec *ts)
+{
+	return (uint64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+static void
+timespec_add_ns(struct timespec *ts, long ns)
+{
+	ts->tv_nsec += ns;
+	while (ts->tv_nsec >= 1000000000) {
+		ts->tv_nsec -= 1000000000;
+		ts->tv_sec++;
+	}
+}
+
+static void
+take_sample(struct intel_sampler *sampler, struct intel_sample *sample)
+{
+	int i;
+
+	if (IS_965(sampler->devid)) {
+		sample->instdone = INREG(INST_DONE_I965);
+		sample->instdone1 = INREG(INST_DONE_1);
+	} else
+		sample->instdone = INREG(INST_DONE);
+
+	for (i = 0; i < sampler->num_rings; i++) {
+		const struct intel_ring_desc *ring = &sampler->rings[i];
+
+		sample->ring[i].head = INREG(ring->mmio + RING_HEAD) & HEAD_ADDR;
+		sample->ring[i].tail = INREG(ring->mmio + RING_TAIL) & TAIL_ADDR;
+		if (ring->wait_mask)
+			sample->ring[i].wait =
+				INREG(ring->mmio + RING_LEN) & ring->wait_mask;
+	}
+}
+
+/*
+ * Whether nothing happened since the @last sample: no ring has anything
+ * queued and INSTDONE didn't change. Units that are stuck busy don't
+ * keep an otherwise idle GPU at the full rate.
+ */
+static bool
+sample_is_idle(const struct intel_sample *sample,
+	       const struct intel_sample *last)
+{
+	int i;
+
+	if (sample->instdone != last->instdone ||
+	    sample->instdone1 != last->instdone1)
+		return false;
+
+	for (i = 0; i < INTEL_MAX_RINGS; i++) {
+		if (sample->ring[i].head != sample->ring[i].tail)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * With an idle rate, once the GPU has been idle for a tenth of a second
+ * the sampler slows down to it, and goes back to the full rate as soon as
+ * one sample sees activity. Every sample carries the number of full rate
+ * periods until the next one, so the accounting stays time weighted.
+ */
+static void *
+sampler_thread(void *arg)
+{
+	struct intel_sampler *sampler = arg;
+	long period = 1000000000L / sampler->rate;
+	int idle_weight = sampler->idle_rate ?
+		sampler->rate / sampler->idle_rate : 1;
+	int idle_samples = 0, weight = 1;
+	struct intel_sample last = { 0 };
+	struct timespec next, now;
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+
+	while (!sampler->stop) {
+		unsigned int head = sampler->head;
+		struct intel_sample *sample;
+		uint64_t late;
+
+		timespec_add_ns(&next, period * weight);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+		if (head - __atomic_load_n(&sampler->tail, __ATOMIC_ACQUIRE) ==
+		    INTEL_SAMPLER_RING_SIZE) {
+			__atomic_add_fetch(&sampler->dropped, 1,
+					   __ATOMIC_RELAXED);
+			continue;
+		}
+
+		sample = &sampler->samples[head % INTEL_SAMPLER_RING_SIZE];
+		take_sample(sampler, sample);
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		sample->time = timespec_to_ns(&now);
+		late = sample->time - timespec_to_ns(&next);
+		sample->lateness = late > UINT32_MAX ? UINT32_MAX : late;
+
+		if (idle_weight > 1 && sample_is_idle(sample, &last))
+			idle_samples++;
+		else
+			idle_samples = 0;
+		weight = idle_samples > sampler->rate / 10 ? idle_weight : 1;
+		sample->weight = weight;
+		last = *sample;
+
+		__atomic_store_n(&sampler->head, head + 1, __ATOMIC_RELEASE);
+
+		/* don't try to catch up after falling behind */
+		if (late > period)
+			next = now;
+	}
+
+	return NULL;
+}
+
+/**
+ * intel_sampler_start:
+ * @sampler: sampler, with the rate and scheduling parameters set
+ * @devid: the device to sample
+ *
+ * Start sampling INSTDONE and every ring of intel_get_rings(@devid) on a
+ * new thread. Falls back to normal priority if not allowed to use realtime
+ * scheduling.
+ */
+void
+intel_sampler_start(struct intel_sampler *sampler, uint32_t devid)
+{
+	pthread_attr_t attr;
+	int ret;
+
+	sampler->devid = devid;
+	sampler->num_rings = intel_get_rings(devid, &sampler->rings);
+	sampler->head = sampler->tail = 0;
+	sampler->dropped = 0;
+	sampler->stop = false;
+
+	sampler->samples = calloc(INTEL_SAMPLER_RING_SIZE,
+				  sizeof(*sampler->samples));
+	if (sampler->samples == NULL) {
+		fprintf(stderr, "Couldn't allocate the sample ring\n");
+		exit(1);
+	}
+
+	pthread_attr_init(&attr);
+
+	if (sampler->cpu >= 0) {
+		cpu_set_t cpus;
+
+		CPU_ZERO(&cpus);
+		CPU_SET(sampler->cpu, &cpus);
+		pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+	}
+
+	if (sampler->realtime) {
+		struct sched_param param = {
+			.sched_priority = sched_get_priority_min(SCHED_FIFO),
+		};
+
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		pthread_attr_setschedparam(&attr, &param);
+	}
+
+	ret = pthread_create(&sampler->thread, &attr, sampler_thread, sampler);
+	if (ret == EPERM && sampler->realtime) {
+		fprintf(stderr, "Not allowed to use SCHED_FIFO, "
+			"sampling with normal priority\n");
+		pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+		ret = pthread_create(&sampler->thread, &attr, sampler_thread,
+				     sampler);
+	}
+	if (ret) {
+		fprintf(stderr, "Couldn't create the sampler thread: %s\n",
+			strerror(ret));
+		exit(1);
+	}
+
+	pthread_attr_destroy(&attr);
+}
+
+void
+intel_sampler_stop(struct intel_sampler *sampler)
+{
+	sampler->stop = true;
+	pthread_join(sampler->thread, NULL);
+	free(sampler->samples);
+	sampler->samples = NULL;
+}
+
+/**
+ * intel_sampler_drain:
+ * @sampler: a started sampler
+ * @fn: called on each sample, oldest first
+ * @data: passed to @fn
+ *
+ * Hand every sample taken since the last call to @fn, and make room for
+ * new ones. Returns the number of samples.
+ */
+int
+intel_sampler_drain(struct intel_sampler *sampler,
+		    void (*fn)(const struct intel_sample *sample, void *data),
+		    void *data)
+{
+	unsigned int head, tail;
+	int count;
+
+	head = __atomic_load_n(&sampler->head, __ATOMIC_ACQUIRE);
+	tail = sampler->tail;
+	count = head - tail;
+
+	for (; tail != head; tail++)
+		fn(&sampler->samples[tail % INTEL_SAMPLER_RING_SIZE], data);
+
+	__atomic_store_n(&sampler->tail, tail, __ATOMIC_RELEASE);
+
+	return count;
+}
+
+/* The number of samples dropped since the last call. */
+unsigned long
+intel_sampler_dropped(struct intel_sampler *sampler)
+{
+	return __atomic_exchange_n(&sampler->dropped, 0, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef INTEL_SAMPLER_H
+#define INTEL_SAMPLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "intel_ring.h"
+
+#define INTEL_SAMPLER_RING_SIZE	(1 << 16)
+
+/* One raw sample, as taken by the sampler thread. */
+struct intel_sample {
+	uint64_t time;		/* CLOCK_MONOTONIC, in ns */
+	uint32_t lateness;	/* ns behind the scheduled sample time */
+	uint32_t weight;	/* sampling periods this sample stands for */
+	uint32_t instdone, instdone1;
+	struct {
+		uint32_t head, tail;
+		uint32_t wait;	/* wait bits of RING_LEN */
+	} ring[INTEL_MAX_RINGS];
+};
+
+/*
+ * Sampling runs on its own thread, woken at absolute times so that neither
+ * the time spent sampling nor the work of the consumer skews the rate.
+ * Samples are handed over in a single producer, single consumer ring that
+ * neither side ever blocks on; when the consumer falls too far behind the
+ * sampler drops samples and counts them.
+ *
+ * Set the parameters, then call intel_sampler_start() with the mmio
+ * mapped, and intel_sampler_drain() often enough to keep up.
+ */
+struct intel_sampler {
+	int rate;		/* samples per second */
+	int idle_rate;		/* 0 unless adaptive */
+	int cpu;		/* -1 if not pinned */
+	bool realtime;
+
+	uint32_t devid;
+	const struct intel_ring_desc *rings;
+	int num_rings;
+
+	struct intel_sample *samples;
+	unsigned int head;	/* only written by the sampler */
+	unsigned int tail;	/* only written by the consumer */
+	unsigned long dropped;
+	volatile bool stop;
+	pthread_t thread;
+};
+
+void intel_sampler_start(struct intel_sampler *sampler, uint32_t devid);
+void intel_sampler_stop(struct intel_sampler *sampler);
+int intel_sampler_drain(struct intel_sampler *sampler,
+			void (*fn)(const struct intel_sample *sample,
+				   void *data),
+			void *data);
+unsigned long intel_sampler_dropped(struct intel_sampler *sampler);
+
+#endif /* INTEL_SAMPLER_H */
@@ -65,6 +65,25 @@ typedef void (*render_copyfunc_t)(struct intel_batchbuffer *batch,
 
 render_copyfunc_t get_render_copyfunc(int devid);
 
+struct render_rect {
+	unsigned src_x, src_y;
+	unsigned dst_x, dst_y;
+	unsigned width, height;
+};
+
+/*
+ * Copy all of @rects from @src to @dst, setting up the pipeline once per
+ * batch rather than once per rectangle. Only on gen6+, get_render_copyrects()
+ * returns NULL elsewhere.
+ */
+typedef void (*render_copyrects_t)(struct intel_batchbuffer *batch,
+				   struct scratch_buf *src,
+				   struct scratch_buf *dst,
+				   const struct render_rect *rects,
+				   int num_rects);
+
+render_copyrects_t get_render_copyrects(int devid);
+
 void gen7_render_copyfunc(struct intel_batchbuffer *batch,
 			  struct scratch_buf *src, unsigned src_x, unsigned src_y,
 			  unsigned width, unsigned height,
@@ -81,3 +100,22 @@ void gen2_render_copyfunc(struct intel_batchbuffer *batch,
 			  struct scratch_buf *src, unsigned src_x, unsigned src_y,
 			  unsigned width, unsigned height,
 			  struct scratch_buf *dst, unsigned dst_x, unsigned dst_y);
+
+/*
+ * Gen7 can also queue copies in the batch: the first one sets up the
+ * pipeline, the others only add their surfaces, when those change, and
+ * their vertices. gen7_render_submit() executes them, as does a queued
+ * copy that no longer fits or a flush of the batch. Until then the batch
+ * is only good for more gen7 copies.
+ */
+void gen7_render_queue_copy(struct intel_batchbuffer *batch,
+			    struct scratch_buf *src, unsigned src_x, unsigned src_y,
+			    unsigned width, unsigned height,
+			    struct scratch_buf *dst, unsigned dst_x, unsigned dst_y);
+void gen7_render_submit(struct intel_batchbuffer *batch);
+void gen7_render_copyrects(struct intel_batchbuffer *batch,
+			   struct scratch_buf *src, struct scratch_buf *dst,
+			   const struct render_rect *rects, int num_rects);
+void gen6_render_copyrects(struct intel_batchbuffer *batch,
+			   struct scratch_buf *src, struct scratch_buf *dst,
+			   const struct render_rect *rects, int num_rects);
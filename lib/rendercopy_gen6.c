@@ -80,9 +80,11 @@ batch_copy(struct intel_batchbuffer *batch, const void *ptr, uint32_t size, uint
 static void
 gen6_render_flush(struct intel_batchbuffer *batch, uint32_t batch_end)
 {
-	int ret;
+	int ret = 0;
 
-	ret = drm_intel_bo_subdata(batch->bo, 0, 4096, batch->buffer);
+	if (!batch->direct)
+		ret = drm_intel_bo_subdata(batch->bo, 0, batch->size,
+					   batch->buffer);
 	if (ret == 0)
 		ret = drm_intel_bo_mrb_exec(batch->bo, batch_end,
 					    NULL, 0, 0, 0);
@@ -528,17 +530,22 @@ static uint32_t gen6_emit_primitive(struct intel_batchbuffer *batch)
 	return offset;
 }
 
-void gen6_render_copyfunc(struct intel_batchbuffer *batch,
-			  struct scratch_buf *src, unsigned src_x, unsigned src_y,
-			  unsigned width, unsigned height,
-			  struct scratch_buf *dst, unsigned dst_x, unsigned dst_y)
+/* Copy as many of @rects as fit in one batch, returns how many. */
+static int
+gen6_render_copyrects_batch(struct intel_batchbuffer *batch,
+			    struct scratch_buf *src, struct scratch_buf *dst,
+			    const struct render_rect *rects, int num_rects)
 {
 	uint32_t wm_state, wm_kernel, wm_table;
 	uint32_t cc_vp, cc_blend, offset;
-	uint32_t batch_end;
+	uint32_t batch_end, state_end, start;
+	int i, n;
 
 	intel_batchbuffer_flush(batch);
 
+	/* the state relocations go through libdrm */
+	assert(batch->lut == NULL);
+
 	batch->ptr = batch->buffer + 1024;
 	batch_alloc(batch, 64, 64);
 	wm_table  = gen6_bind_surfaces(batch, src, dst);
@@ -549,6 +556,7 @@ void gen6_render_copyfunc(struct intel_batchbuffer *batch,
 
 	cc_vp = gen6_create_cc_viewport(batch);
 	cc_blend = gen6_create_cc_blend(batch);
+	state_end = batch_used(batch);
 
 	batch->ptr = batch->buffer;
 
@@ -578,22 +586,64 @@ void gen6_render_copyfunc(struct intel_batchbuffer *batch,
 
 	OUT_BATCH(MI_BATCH_BUFFER_END);
 	batch_end = batch_align(batch, 8);
+	assert(batch_end < 1024);
 
-	*(uint32_t*)(batch->buffer + offset) =
-		batch_round_upto(batch, VERTEX_SIZE)/VERTEX_SIZE;
+	/* the vertices take up whatever is left after the state */
+	batch->ptr = batch->buffer + state_end;
+	start = batch_round_upto(batch, VERTEX_SIZE);
+	n = (batch->size - BATCH_RESERVED - start) / (3 * VERTEX_SIZE);
+	assert(n > 0);
+	if (n > num_rects)
+		n = num_rects;
 
-	emit_vertex_2s(batch, dst_x + width, dst_y + height);
-	emit_vertex_normalized(batch, src_x + width, buf_width(src));
-	emit_vertex_normalized(batch, src_y + height, buf_height(src));
+	*(uint32_t*)(batch->buffer + offset - 4) = 3 * n;
+	*(uint32_t*)(batch->buffer + offset) = start / VERTEX_SIZE;
 
-	emit_vertex_2s(batch, dst_x, dst_y + height);
-	emit_vertex_normalized(batch, src_x, buf_width(src));
-	emit_vertex_normalized(batch, src_y + height, buf_height(src));
+	for (i = 0; i < n; i++) {
+		const struct render_rect *r = &rects[i];
 
-	emit_vertex_2s(batch, dst_x, dst_y);
-	emit_vertex_normalized(batch, src_x, buf_width(src));
-	emit_vertex_normalized(batch, src_y, buf_height(src));
+		emit_vertex_2s(batch, r->dst_x + r->width, r->dst_y + r->height);
+		emit_vertex_normalized(batch, r->src_x + r->width, buf_width(src));
+		emit_vertex_normalized(batch, r->src_y + r->height, buf_height(src));
+
+		emit_vertex_2s(batch, r->dst_x, r->dst_y + r->height);
+		emit_vertex_normalized(batch, r->src_x, buf_width(src));
+		emit_vertex_normalized(batch, r->src_y + r->height, buf_height(src));
+
+		emit_vertex_2s(batch, r->dst_x, r->dst_y);
+		emit_vertex_normalized(batch, r->src_x, buf_width(src));
+		emit_vertex_normalized(batch, r->src_y, buf_height(src));
+	}
 
 	gen6_render_flush(batch, batch_end);
 	intel_batchbuffer_reset(batch);
+
+	return n;
+}
+
+void gen6_render_copyrects(struct intel_batchbuffer *batch,
+			   struct scratch_buf *src, struct scratch_buf *dst,
+			   const struct render_rect *rects, int num_rects)
+{
+	while (num_rects > 0) {
+		int n = gen6_render_copyrects_batch(batch, src, dst,
+						    rects, num_rects);
+
+		rects += n;
+		num_rects -= n;
+	}
+}
+
+void gen6_render_copyfunc(struct intel_batchbuffer *batch,
+			  struct scratch_buf *src, unsigned src_x, unsigned src_y,
+			  unsigned width, unsigned height,
+			  struct scratch_buf *dst, unsigned dst_x, unsigned dst_y)
+{
+	struct render_rect rect = {
+		.src_x = src_x, .src_y = src_y,
+		.dst_x = dst_x, .dst_y = dst_y,
+		.width = width, .height = height,
+	};
+
+	gen6_render_copyrects(batch, src, dst, &rect, 1);
 }
@@ -54,9 +54,11 @@ batch_copy(struct intel_batchbuffer *batch, const void *ptr, uint32_t size, uint
 static void
 gen7_render_flush(struct intel_batchbuffer *batch, uint32_t batch_end)
 {
-	int ret;
+	int ret = 0;
 
-	ret = drm_intel_bo_subdata(batch->bo, 0, 4096, batch->buffer);
+	if (!batch->direct)
+		ret = drm_intel_bo_subdata(batch->bo, 0, batch->size,
+					   batch->buffer);
 	if (ret == 0)
 		ret = drm_intel_bo_mrb_exec(batch->bo, batch_end,
 					    NULL, 0, 0, 0);
@@ -119,86 +121,106 @@ gen7_bind_buf(struct intel_batchbuffer *batch,
 static void
 gen7_emit_vertex_elements(struct intel_batchbuffer *batch)
 {
-	OUT_BATCH(GEN7_3DSTATE_VERTEX_ELEMENTS |
-		  ((2 * (1 + 2)) + 1 - 2));
-
-	OUT_BATCH(0 << GEN7_VE0_VERTEX_BUFFER_INDEX_SHIFT | GEN7_VE0_VALID |
-		  GEN7_SURFACEFORMAT_R32G32B32A32_FLOAT << GEN7_VE0_FORMAT_SHIFT |
-		  0 << GEN7_VE0_OFFSET_SHIFT);
-
-	OUT_BATCH(GEN7_VFCOMPONENT_STORE_0 << GEN7_VE1_VFCOMPONENT_0_SHIFT |
-		  GEN7_VFCOMPONENT_STORE_0 << GEN7_VE1_VFCOMPONENT_1_SHIFT |
-		  GEN7_VFCOMPONENT_STORE_0 << GEN7_VE1_VFCOMPONENT_2_SHIFT |
-		  GEN7_VFCOMPONENT_STORE_0 << GEN7_VE1_VFCOMPONENT_3_SHIFT);
-
-	/* x,y */
-	OUT_BATCH(0 << GEN7_VE0_VERTEX_BUFFER_INDEX_SHIFT | GEN7_VE0_VALID |
-		  GEN7_SURFACEFORMAT_R16G16_SSCALED << GEN7_VE0_FORMAT_SHIFT |
-		  0 << GEN7_VE0_OFFSET_SHIFT); /* offsets vb in bytes */
-	OUT_BATCH(GEN7_VFCOMPONENT_STORE_SRC << GEN7_VE1_VFCOMPONENT_0_SHIFT |
-		  GEN7_VFCOMPONENT_STORE_SRC << GEN7_VE1_VFCOMPONENT_1_SHIFT |
-		  GEN7_VFCOMPONENT_STORE_0 << GEN7_VE1_VFCOMPONENT_2_SHIFT |
-		  GEN7_VFCOMPONENT_STORE_1_FLT << GEN7_VE1_VFCOMPONENT_3_SHIFT);
-
-	/* s,t */
-	OUT_BATCH(0 << GEN7_VE0_VERTEX_BUFFER_INDEX_SHIFT | GEN7_VE0_VALID |
-		  GEN7_SURFACEFORMAT_R16G16_SSCALED << GEN7_VE0_FORMAT_SHIFT |
-		  4 << GEN7_VE0_OFFSET_SHIFT);  /* offset vb in bytes */
-	OUT_BATCH(GEN7_VFCOMPONENT_STORE_SRC << GEN7_VE1_VFCOMPONENT_0_SHIFT |
-		  GEN7_VFCOMPONENT_STORE_SRC << GEN7_VE1_VFCOMPONENT_1_SHIFT |
-		  GEN7_VFCOMPONENT_STORE_0 << GEN7_VE1_VFCOMPONENT_2_SHIFT |
-		  GEN7_VFCOMPONENT_STORE_1_FLT << GEN7_VE1_VFCOMPONENT_3_SHIFT);
+	OUT_PACKET(GEN7_3DSTATE_VERTEX_ELEMENTS |
+		   ((2 * (1 + 2)) + 1 - 2),
+
+		   0 << GEN7_VE0_VERTEX_BUFFER_INDEX_SHIFT | GEN7_VE0_VALID |
+		   GEN7_SURFACEFORMAT_R32G32B32A32_FLOAT << GEN7_VE0_FORMAT_SHIFT |
+		   0 << GEN7_VE0_OFFSET_SHIFT,
+
+		   GEN7_VFCOMPONENT_STORE_0 << GEN7_VE1_VFCOMPONENT_0_SHIFT |
+		   GEN7_VFCOMPONENT_STORE_0 << GEN7_VE1_VFCOMPONENT_1_SHIFT |
+		   GEN7_VFCOMPONENT_STORE_0 << GEN7_VE1_VFCOMPONENT_2_SHIFT |
+		   GEN7_VFCOMPONENT_STORE_0 << GEN7_VE1_VFCOMPONENT_3_SHIFT,
+
+		   /* x,y */
+		   0 << GEN7_VE0_VERTEX_BUFFER_INDEX_SHIFT | GEN7_VE0_VALID |
+		   GEN7_SURFACEFORMAT_R16G16_SSCALED << GEN7_VE0_FORMAT_SHIFT |
+		   0 << GEN7_VE0_OFFSET_SHIFT, /* offsets vb in bytes */
+		   GEN7_VFCOMPONENT_STORE_SRC << GEN7_VE1_VFCOMPONENT_0_SHIFT |
+		   GEN7_VFCOMPONENT_STORE_SRC << GEN7_VE1_VFCOMPONENT_1_SHIFT |
+		   GEN7_VFCOMPONENT_STORE_0 << GEN7_VE1_VFCOMPONENT_2_SHIFT |
+		   GEN7_VFCOMPONENT_STORE_1_FLT << GEN7_VE1_VFCOMPONENT_3_SHIFT,
+
+		   /* s,t */
+		   0 << GEN7_VE0_VERTEX_BUFFER_INDEX_SHIFT | GEN7_VE0_VALID |
+		   GEN7_SURFACEFORMAT_R16G16_SSCALED << GEN7_VE0_FORMAT_SHIFT |
+		   4 << GEN7_VE0_OFFSET_SHIFT,  /* offset vb in bytes */
+		   GEN7_VFCOMPONENT_STORE_SRC << GEN7_VE1_VFCOMPONENT_0_SHIFT |
+		   GEN7_VFCOMPONENT_STORE_SRC << GEN7_VE1_VFCOMPONENT_1_SHIFT |
+		   GEN7_VFCOMPONENT_STORE_0 << GEN7_VE1_VFCOMPONENT_2_SHIFT |
+		   GEN7_VFCOMPONENT_STORE_1_FLT << GEN7_VE1_VFCOMPONENT_3_SHIFT);
 }
 
+#define RECT_VERTEX_SIZE (12 * sizeof(uint16_t))
+
 static uint32_t
 gen7_create_vertex_buffer(struct intel_batchbuffer *batch,
-			  uint32_t src_x, uint32_t src_y,
-			  uint32_t dst_x, uint32_t dst_y,
-			  uint32_t width, uint32_t height)
+			  const struct render_rect *rects, int num_rects)
 {
 	uint16_t *v;
+	int i;
+
+	v = batch_alloc(batch, num_rects * RECT_VERTEX_SIZE, 8);
 
-	v = batch_alloc(batch, 12*sizeof(*v), 8);
+	for (i = 0; i < num_rects; i++) {
+		const struct render_rect *r = &rects[i];
+		uint16_t *rv = v + 12 * i;
 
-	v[0] = dst_x + width;
-	v[1] = dst_y + height;
-	v[2] = src_x + width;
-	v[3] = src_y + height;
+		rv[0] = r->dst_x + r->width;
+		rv[1] = r->dst_y + r->height;
+		rv[2] = r->src_x + r->width;
+		rv[3] = r->src_y + r->height;
 
-	v[4] = dst_x;
-	v[5] = dst_y + height;
-	v[6] = src_x;
-	v[7] = src_y + height;
+		rv[4] = r->dst_x;
+		rv[5] = r->dst_y + r->height;
+		rv[6] = r->src_x;
+		rv[7] = r->src_y + r->height;
 
-	v[8] = dst_x;
-	v[9] = dst_y;
-	v[10] = src_x;
-	v[11] = src_y;
+		rv[8] = r->dst_x;
+		rv[9] = r->dst_y;
+		rv[10] = r->src_x;
+		rv[11] = r->src_y;
+	}
 
 	return batch_offset(batch, v);
 }
 
-static void gen7_emit_vertex_buffer(struct intel_batchbuffer *batch,
-				    int src_x, int src_y,
-				    int dst_x, int dst_y,
-				    int width, int height)
+static void
+gen7_emit_vertex_buffers(struct intel_batchbuffer *batch, uint32_t offset)
+{
+	uint32_t *packet = intel_batchbuffer_reserve(batch, 5 * 4);
+	const uint32_t vb[] = {
+		GEN7_3DSTATE_VERTEX_BUFFERS | (5 - 2),
+		0 << GEN7_VB0_BUFFER_INDEX_SHIFT |
+		GEN7_VB0_VERTEXDATA |
+		GEN7_VB0_ADDRESS_MODIFY_ENABLE |
+		4*2 << GEN7_VB0_BUFFER_PITCH_SHIFT,
+		intel_batchbuffer_reloc(batch, &packet[2], batch->bo, offset,
+					I915_GEM_DOMAIN_VERTEX, 0, 0),
+		~0,
+		0,
+	};
+
+	memcpy(packet, vb, sizeof(vb));
+}
+
+/* Put as many of @rects as fit into the rest of the state, returns how many. */
+static int gen7_emit_vertex_buffer(struct intel_batchbuffer *batch,
+				   const struct render_rect *rects,
+				   int num_rects)
 {
-	uint32_t offset;
+	int n;
 
-	offset = gen7_create_vertex_buffer(batch,
-					   src_x, src_y,
-					   dst_x, dst_y,
-					   width, height);
+	n = (batch->size - ALIGN(batch_used(batch), 8)) / RECT_VERTEX_SIZE;
+	assert(n > 0);
+	if (n > num_rects)
+		n = num_rects;
 
-	OUT_BATCH(GEN7_3DSTATE_VERTEX_BUFFERS | (5 - 2));
-	OUT_BATCH(0 << GEN7_VB0_BUFFER_INDEX_SHIFT |
-		  GEN7_VB0_VERTEXDATA |
-		  GEN7_VB0_ADDRESS_MODIFY_ENABLE |
-		  4*2 << GEN7_VB0_BUFFER_PITCH_SHIFT);
+	gen7_emit_vertex_buffers(batch,
+				 gen7_create_vertex_buffer(batch, rects, n));
 
-	OUT_RELOC(batch->bo, I915_GEM_DOMAIN_VERTEX, 0, offset);
-	OUT_BATCH(~0);
-	OUT_BATCH(0);
+	return n;
 }
 
 static uint32_t
@@ -223,17 +245,17 @@ gen7_emit_binding_table(struct intel_batchbuffer *batch,
 			struct scratch_buf *src,
 			struct scratch_buf *dst)
 {
-	OUT_BATCH(GEN7_3DSTATE_BINDING_TABLE_POINTERS_PS | (2 - 2));
-	OUT_BATCH(gen7_bind_surfaces(batch, src, dst));
+	OUT_PACKET(GEN7_3DSTATE_BINDING_TABLE_POINTERS_PS | (2 - 2),
+		   gen7_bind_surfaces(batch, src, dst));
 }
 
 static void
 gen7_emit_drawing_rectangle(struct intel_batchbuffer *batch, struct scratch_buf *dst)
 {
-	OUT_BATCH(GEN7_3DSTATE_DRAWING_RECTANGLE | (4 - 2));
-	OUT_BATCH(0);
-	OUT_BATCH((buf_height(dst) - 1) << 16 | (buf_width(dst) - 1));
-	OUT_BATCH(0);
+	OUT_PACKET(GEN7_3DSTATE_DRAWING_RECTANGLE | (4 - 2),
+		   0,
+		   (buf_height(dst) - 1) << 16 | (buf_width(dst) - 1),
+		   0);
 }
 
 static uint32_t
@@ -252,20 +274,34 @@ gen7_create_blend_state(struct intel_batchbuffer *batch)
 	return batch_offset(batch, blend);
 }
 
+/* Relocation at @location in the batch to the batch bo, as a base address. */
+static uint32_t
+gen7_batch_base(struct intel_batchbuffer *batch, const uint32_t *location)
+{
+	return intel_batchbuffer_reloc(batch, location, batch->bo,
+				       BASE_ADDRESS_MODIFY,
+				       I915_GEM_DOMAIN_INSTRUCTION, 0, 0);
+}
+
 static void
 gen7_emit_state_base_address(struct intel_batchbuffer *batch)
 {
-	OUT_BATCH(GEN7_STATE_BASE_ADDRESS | (10 - 2));
-	OUT_BATCH(0);
-	OUT_RELOC(batch->bo, I915_GEM_DOMAIN_INSTRUCTION, 0, BASE_ADDRESS_MODIFY);
-	OUT_RELOC(batch->bo, I915_GEM_DOMAIN_INSTRUCTION, 0, BASE_ADDRESS_MODIFY);
-	OUT_BATCH(0);
-	OUT_RELOC(batch->bo, I915_GEM_DOMAIN_INSTRUCTION, 0, BASE_ADDRESS_MODIFY);
+	uint32_t *packet = intel_batchbuffer_reserve(batch, 10 * 4);
+	const uint32_t sba[] = {
+		GEN7_STATE_BASE_ADDRESS | (10 - 2),
+		0,
+		gen7_batch_base(batch, &packet[2]), /* surface state */
+		gen7_batch_base(batch, &packet[3]), /* dynamic state */
+		0,
+		gen7_batch_base(batch, &packet[5]), /* instructions */
+
+		0,
+		0 | BASE_ADDRESS_MODIFY,
+		0,
+		0 | BASE_ADDRESS_MODIFY,
+	};
 
-	OUT_BATCH(0);
-	OUT_BATCH(0 | BASE_ADDRESS_MODIFY);
-	OUT_BATCH(0);
-	OUT_BATCH(0 | BASE_ADDRESS_MODIFY);
+	memcpy(packet, sba, sizeof(sba));
 }
 
 static uint32_t
@@ -283,11 +319,11 @@ gen7_create_cc_viewport(struct intel_batchbuffer *batch)
 static void
 gen7_emit_cc(struct intel_batchbuffer *batch)
 {
-        OUT_BATCH(GEN7_3DSTATE_BLEND_STATE_POINTERS | (2 - 2));
-        OUT_BATCH(gen7_create_blend_state(batch));
+	OUT_PACKET(GEN7_3DSTATE_BLEND_STATE_POINTERS | (2 - 2),
+		   gen7_create_blend_state(batch));
 
-        OUT_BATCH(GEN7_3DSTATE_VIEWPORT_STATE_POINTERS_CC | (2 - 2));
-	OUT_BATCH(gen7_create_cc_viewport(batch));
+	OUT_PACKET(GEN7_3DSTATE_VIEWPORT_STATE_POINTERS_CC | (2 - 2),
+		   gen7_create_cc_viewport(batch));
 }
 
 static uint32_t
@@ -312,142 +348,142 @@ gen7_create_sampler(struct intel_batchbuffer *batch)
 static void
 gen7_emit_sampler(struct intel_batchbuffer *batch)
 {
-        OUT_BATCH(GEN7_3DSTATE_SAMPLER_STATE_POINTERS_PS | (2 - 2));
-        OUT_BATCH(gen7_create_sampler(batch));
+	OUT_PACKET(GEN7_3DSTATE_SAMPLER_STATE_POINTERS_PS | (2 - 2),
+		   gen7_create_sampler(batch));
 }
 
 static void
 gen7_emit_multisample(struct intel_batchbuffer *batch)
 {
-	OUT_BATCH(GEN7_3DSTATE_MULTISAMPLE | (4 - 2));
-	OUT_BATCH(GEN7_3DSTATE_MULTISAMPLE_PIXEL_LOCATION_CENTER |
-		  GEN7_3DSTATE_MULTISAMPLE_NUMSAMPLES_1); /* 1 sample/pixel */
-	OUT_BATCH(0);
-	OUT_BATCH(0);
+	OUT_PACKET(GEN7_3DSTATE_MULTISAMPLE | (4 - 2),
+		   GEN7_3DSTATE_MULTISAMPLE_PIXEL_LOCATION_CENTER |
+		   GEN7_3DSTATE_MULTISAMPLE_NUMSAMPLES_1, /* 1 sample/pixel */
+		   0,
+		   0);
 
-	OUT_BATCH(GEN7_3DSTATE_SAMPLE_MASK | (2 - 2));
-	OUT_BATCH(1);
+	OUT_PACKET(GEN7_3DSTATE_SAMPLE_MASK | (2 - 2),
+		   1);
 }
 
 static void
 gen7_emit_urb(struct intel_batchbuffer *batch)
 {
-	OUT_BATCH(GEN7_3DSTATE_PUSH_CONSTANT_ALLOC_PS | (2 - 2));
-	OUT_BATCH(8); /* in 1KBs */
+	OUT_PACKET(GEN7_3DSTATE_PUSH_CONSTANT_ALLOC_PS | (2 - 2),
+		   8); /* in 1KBs */
 
 	/* num of VS entries must be divisible by 8 if size < 9 */
-	OUT_BATCH(GEN7_3DSTATE_URB_VS | (2 - 2));
-	OUT_BATCH((64 << GEN7_URB_ENTRY_NUMBER_SHIFT) |
-		  (2 - 1) << GEN7_URB_ENTRY_SIZE_SHIFT |
-		  (1 << GEN7_URB_STARTING_ADDRESS_SHIFT));
+	OUT_PACKET(GEN7_3DSTATE_URB_VS | (2 - 2),
+		   (64 << GEN7_URB_ENTRY_NUMBER_SHIFT) |
+		   (2 - 1) << GEN7_URB_ENTRY_SIZE_SHIFT |
+		   (1 << GEN7_URB_STARTING_ADDRESS_SHIFT));
 
-	OUT_BATCH(GEN7_3DSTATE_URB_HS | (2 - 2));
-	OUT_BATCH((0 << GEN7_URB_ENTRY_SIZE_SHIFT) |
-		  (2 << GEN7_URB_STARTING_ADDRESS_SHIFT));
+	OUT_PACKET(GEN7_3DSTATE_URB_HS | (2 - 2),
+		   (0 << GEN7_URB_ENTRY_SIZE_SHIFT) |
+		   (2 << GEN7_URB_STARTING_ADDRESS_SHIFT));
 
-	OUT_BATCH(GEN7_3DSTATE_URB_DS | (2 - 2));
-	OUT_BATCH((0 << GEN7_URB_ENTRY_SIZE_SHIFT) |
-		  (2 << GEN7_URB_STARTING_ADDRESS_SHIFT));
+	OUT_PACKET(GEN7_3DSTATE_URB_DS | (2 - 2),
+		   (0 << GEN7_URB_ENTRY_SIZE_SHIFT) |
+		   (2 << GEN7_URB_STARTING_ADDRESS_SHIFT));
 
-	OUT_BATCH(GEN7_3DSTATE_URB_GS | (2 - 2));
-	OUT_BATCH((0 << GEN7_URB_ENTRY_SIZE_SHIFT) |
-		  (1 << GEN7_URB_STARTING_ADDRESS_SHIFT));
+	OUT_PACKET(GEN7_3DSTATE_URB_GS | (2 - 2),
+		   (0 << GEN7_URB_ENTRY_SIZE_SHIFT) |
+		   (1 << GEN7_URB_STARTING_ADDRESS_SHIFT));
 }
 
 static void
 gen7_emit_vs(struct intel_batchbuffer *batch)
 {
-	OUT_BATCH(GEN7_3DSTATE_VS | (6 - 2));
-	OUT_BATCH(0); /* no VS kernel */
-	OUT_BATCH(0);
-	OUT_BATCH(0);
-	OUT_BATCH(0);
-	OUT_BATCH(0); /* pass-through */
+	OUT_PACKET(GEN7_3DSTATE_VS | (6 - 2),
+		   0, /* no VS kernel */
+		   0,
+		   0,
+		   0,
+		   0); /* pass-through */
 }
 
 static void
 gen7_emit_hs(struct intel_batchbuffer *batch)
 {
-        OUT_BATCH(GEN7_3DSTATE_HS | (7 - 2));
-        OUT_BATCH(0); /* no HS kernel */
-        OUT_BATCH(0);
-        OUT_BATCH(0);
-        OUT_BATCH(0);
-        OUT_BATCH(0);
-        OUT_BATCH(0); /* pass-through */
+	OUT_PACKET(GEN7_3DSTATE_HS | (7 - 2),
+		   0, /* no HS kernel */
+		   0,
+		   0,
+		   0,
+		   0,
+		   0); /* pass-through */
 }
 
 static void
 gen7_emit_te(struct intel_batchbuffer *batch)
 {
-        OUT_BATCH(GEN7_3DSTATE_TE | (4 - 2));
-        OUT_BATCH(0);
-        OUT_BATCH(0);
-        OUT_BATCH(0);
+	OUT_PACKET(GEN7_3DSTATE_TE | (4 - 2),
+		   0,
+		   0,
+		   0);
 }
 
 static void
 gen7_emit_ds(struct intel_batchbuffer *batch)
 {
-        OUT_BATCH(GEN7_3DSTATE_DS | (6 - 2));
-        OUT_BATCH(0);
-        OUT_BATCH(0);
-        OUT_BATCH(0);
-        OUT_BATCH(0);
-        OUT_BATCH(0);
+	OUT_PACKET(GEN7_3DSTATE_DS | (6 - 2),
+		   0,
+		   0,
+		   0,
+		   0,
+		   0);
 }
 
 static void
 gen7_emit_gs(struct intel_batchbuffer *batch)
 {
-        OUT_BATCH(GEN7_3DSTATE_GS | (7 - 2));
-        OUT_BATCH(0); /* no GS kernel */
-        OUT_BATCH(0);
-        OUT_BATCH(0);
-        OUT_BATCH(0);
-        OUT_BATCH(0);
-        OUT_BATCH(0); /* pass-through  */
+	OUT_PACKET(GEN7_3DSTATE_GS | (7 - 2),
+		   0, /* no GS kernel */
+		   0,
+		   0,
+		   0,
+		   0,
+		   0); /* pass-through  */
 }
 
 static void
 gen7_emit_streamout(struct intel_batchbuffer *batch)
 {
-        OUT_BATCH(GEN7_3DSTATE_STREAMOUT | (3 - 2));
-        OUT_BATCH(0);
-        OUT_BATCH(0);
+	OUT_PACKET(GEN7_3DSTATE_STREAMOUT | (3 - 2),
+		   0,
+		   0);
 }
 
 static void
 gen7_emit_sf(struct intel_batchbuffer *batch)
 {
-        OUT_BATCH(GEN7_3DSTATE_SF | (7 - 2));
-        OUT_BATCH(0);
-        OUT_BATCH(GEN7_3DSTATE_SF_CULL_NONE);
-        OUT_BATCH(2 << GEN7_3DSTATE_SF_TRIFAN_PROVOKE_SHIFT);
-        OUT_BATCH(0);
-        OUT_BATCH(0);
-        OUT_BATCH(0);
+	OUT_PACKET(GEN7_3DSTATE_SF | (7 - 2),
+		   0,
+		   GEN7_3DSTATE_SF_CULL_NONE,
+		   2 << GEN7_3DSTATE_SF_TRIFAN_PROVOKE_SHIFT,
+		   0,
+		   0,
+		   0);
 }
 
 static void
 gen7_emit_sbe(struct intel_batchbuffer *batch)
 {
-	OUT_BATCH(GEN7_3DSTATE_SBE | (14 - 2));
-	OUT_BATCH(1 << GEN7_SBE_NUM_OUTPUTS_SHIFT |
-		  1 << GEN7_SBE_URB_ENTRY_READ_LENGTH_SHIFT |
-		  1 << GEN7_SBE_URB_ENTRY_READ_OFFSET_SHIFT);
-	OUT_BATCH(0);
-	OUT_BATCH(0); /* dw4 */
-	OUT_BATCH(0);
-	OUT_BATCH(0);
-	OUT_BATCH(0);
-	OUT_BATCH(0); /* dw8 */
-	OUT_BATCH(0);
-	OUT_BATCH(0);
-	OUT_BATCH(0);
-	OUT_BATCH(0); /* dw12 */
-	OUT_BATCH(0);
-	OUT_BATCH(0);
+	OUT_PACKET(GEN7_3DSTATE_SBE | (14 - 2),
+		   1 << GEN7_SBE_NUM_OUTPUTS_SHIFT |
+		   1 << GEN7_SBE_URB_ENTRY_READ_LENGTH_SHIFT |
+		   1 << GEN7_SBE_URB_ENTRY_READ_OFFSET_SHIFT,
+		   0,
+		   0, /* dw4 */
+		   0,
+		   0,
+		   0,
+		   0, /* dw8 */
+		   0,
+		   0,
+		   0,
+		   0, /* dw12 */
+		   0,
+		   0);
 }
 
 static void
@@ -460,67 +496,101 @@ gen7_emit_ps(struct intel_batchbuffer *batch)
 	else
 		threads = 40 << IVB_PS_MAX_THREADS_SHIFT;
 
-	OUT_BATCH(GEN7_3DSTATE_PS | (8 - 2));
-	OUT_BATCH(batch_copy(batch, ps_kernel, sizeof(ps_kernel), 64));
-	OUT_BATCH(1 << GEN7_PS_SAMPLER_COUNT_SHIFT |
-		  2 << GEN7_PS_BINDING_TABLE_ENTRY_COUNT_SHIFT);
-	OUT_BATCH(0); /* scratch address */
-	OUT_BATCH(threads |
-		  GEN7_PS_16_DISPATCH_ENABLE |
-		  GEN7_PS_ATTRIBUTE_ENABLE);
-	OUT_BATCH(6 << GEN7_PS_DISPATCH_START_GRF_SHIFT_0);
-	OUT_BATCH(0);
-	OUT_BATCH(0);
+	OUT_PACKET(GEN7_3DSTATE_PS | (8 - 2),
+		   batch_copy(batch, ps_kernel, sizeof(ps_kernel), 64),
+		   1 << GEN7_PS_SAMPLER_COUNT_SHIFT |
+		   2 << GEN7_PS_BINDING_TABLE_ENTRY_COUNT_SHIFT,
+		   0, /* scratch address */
+		   threads |
+		   GEN7_PS_16_DISPATCH_ENABLE |
+		   GEN7_PS_ATTRIBUTE_ENABLE,
+		   6 << GEN7_PS_DISPATCH_START_GRF_SHIFT_0,
+		   0,
+		   0);
 }
 
 static void
 gen7_emit_clip(struct intel_batchbuffer *batch)
 {
-        OUT_BATCH(GEN7_3DSTATE_CLIP | (4 - 2));
-        OUT_BATCH(0);
-        OUT_BATCH(0); /* pass-through */
-        OUT_BATCH(0);
+	OUT_PACKET(GEN7_3DSTATE_CLIP | (4 - 2),
+		   0,
+		   0, /* pass-through */
+		   0);
 
-        OUT_BATCH(GEN7_3DSTATE_VIEWPORT_STATE_POINTERS_SF_CL | (2 - 2));
-        OUT_BATCH(0);
+	OUT_PACKET(GEN7_3DSTATE_VIEWPORT_STATE_POINTERS_SF_CL | (2 - 2),
+		   0);
 }
 
 static void
 gen7_emit_wm(struct intel_batchbuffer *batch)
 {
-        OUT_BATCH(GEN7_3DSTATE_WM | (3 - 2));
-        OUT_BATCH(GEN7_WM_DISPATCH_ENABLE |
-                  GEN7_WM_PERSPECTIVE_PIXEL_BARYCENTRIC);
-        OUT_BATCH(0);
+	OUT_PACKET(GEN7_3DSTATE_WM | (3 - 2),
+		   GEN7_WM_DISPATCH_ENABLE |
+		   GEN7_WM_PERSPECTIVE_PIXEL_BARYCENTRIC,
+		   0);
 }
 
 static void
 gen7_emit_null_depth_buffer(struct intel_batchbuffer *batch)
 {
-        OUT_BATCH(GEN7_3DSTATE_DEPTH_BUFFER | (7 - 2));
-        OUT_BATCH(GEN7_SURFACE_NULL << GEN7_3DSTATE_DEPTH_BUFFER_TYPE_SHIFT |
-                  GEN7_DEPTHFORMAT_D32_FLOAT << GEN7_3DSTATE_DEPTH_BUFFER_FORMAT_SHIFT);
-        OUT_BATCH(0); /* disable depth, stencil and hiz */
-        OUT_BATCH(0);
-        OUT_BATCH(0);
-        OUT_BATCH(0);
-        OUT_BATCH(0);
+	OUT_PACKET(GEN7_3DSTATE_DEPTH_BUFFER | (7 - 2),
+		   GEN7_SURFACE_NULL << GEN7_3DSTATE_DEPTH_BUFFER_TYPE_SHIFT |
+		   GEN7_DEPTHFORMAT_D32_FLOAT << GEN7_3DSTATE_DEPTH_BUFFER_FORMAT_SHIFT,
+		   0, /* disable depth, stencil and hiz */
+		   0,
+		   0,
+		   0,
+		   0);
 
-        OUT_BATCH(GEN7_3DSTATE_CLEAR_PARAMS | (3 - 2));
-        OUT_BATCH(0);
-        OUT_BATCH(0);
+	OUT_PACKET(GEN7_3DSTATE_CLEAR_PARAMS | (3 - 2),
+		   0,
+		   0);
 }
 
 #define BATCH_STATE_SPLIT 2048
-void gen7_render_copyfunc(struct intel_batchbuffer *batch,
-			  struct scratch_buf *src, unsigned src_x, unsigned src_y,
-			  unsigned width, unsigned height,
-			  struct scratch_buf *dst, unsigned dst_x, unsigned dst_y)
+/* the commands of one more copy, up to and including the batch end */
+#define COPY_CMD_SPACE (24 * 4)
+/* binding table and surface states, alignment included */
+#define COPY_SURFACE_SPACE 128
+
+static bool
+same_surface(const struct intel_render_surface *cached,
+	     const struct scratch_buf *buf)
 {
-	uint32_t batch_end;
+	return cached->bo == buf->bo &&
+		cached->stride == buf->stride &&
+		cached->tiling == buf->tiling &&
+		cached->size == buf->size;
+}
+
+static void
+cache_surface(struct intel_render_surface *cached,
+	      const struct scratch_buf *buf)
+{
+	cached->bo = buf->bo;
+	cached->stride = buf->stride;
+	cached->tiling = buf->tiling;
+	cached->size = buf->size;
+}
+
+/* Whether one more copy of at least one rectangle fits in the batch. */
+static bool
+gen7_render_room(struct intel_batchbuffer *batch)
+{
+	return batch->ptr - batch->buffer + COPY_CMD_SPACE <= BATCH_STATE_SPLIT &&
+		batch_used(batch) + COPY_SURFACE_SPACE + 8 + RECT_VERTEX_SIZE <=
+		batch->size;
+}
 
+/* Start a fresh batch with the pipeline set up for copies. */
+static void
+gen7_render_setup(struct intel_batchbuffer *batch)
+{
 	intel_batchbuffer_flush(batch);
 
+	/* the state relocations go through libdrm */
+	assert(batch->lut == NULL);
+
 	batch->state = &batch->buffer[BATCH_STATE_SPLIT];
 
 	OUT_BATCH(GEN7_PIPELINE_SELECT | PIPELINE_SELECT_3D);
@@ -544,18 +614,70 @@ void gen7_render_copyfunc(struct intel_batchbuffer *batch,
         gen7_emit_sbe(batch);
         gen7_emit_ps(batch);
         gen7_emit_vertex_elements(batch);
-        gen7_emit_vertex_buffer(batch,
-				src_x, src_y, dst_x, dst_y, width, height);
-	gen7_emit_binding_table(batch, src, dst);
-	gen7_emit_drawing_rectangle(batch, dst);
-
-        OUT_BATCH(GEN7_3DPRIMITIVE | (7- 2));
-        OUT_BATCH(GEN7_3DPRIMITIVE_VERTEX_SEQUENTIAL | _3DPRIM_RECTLIST);
-        OUT_BATCH(3);
-        OUT_BATCH(0);
-        OUT_BATCH(1);   /* single instance */
-        OUT_BATCH(0);   /* start instance location */
-        OUT_BATCH(0);   /* index buffer offset, ignored */
+
+	batch->render.valid = true;
+	batch->render.submit = gen7_render_submit;
+}
+
+/* What an earlier copy wrote has to be visible to the next one. */
+static void
+gen7_emit_copy_flush(struct intel_batchbuffer *batch)
+{
+	intel_emit_pipe_control(batch,
+				GEN7_PIPE_CONTROL_CS_STALL |
+				GEN7_PIPE_CONTROL_WC_FLUSH |
+				GEN7_PIPE_CONTROL_TC_FLUSH,
+				NULL, 0, 0);
+}
+
+/*
+ * Queue a copy of as many of @rects as fit in the batch, returns how many.
+ * Everything but the surfaces and the vertices is already in the batch
+ * after the first copy, and the surfaces too while they stay the same.
+ */
+static int
+gen7_render_queue_rects(struct intel_batchbuffer *batch,
+			struct scratch_buf *src, struct scratch_buf *dst,
+			const struct render_rect *rects, int num_rects)
+{
+	int n;
+
+	if (batch->render.valid && !gen7_render_room(batch))
+		gen7_render_submit(batch);
+
+	if (!batch->render.valid)
+		gen7_render_setup(batch);
+	else
+		gen7_emit_copy_flush(batch);
+
+	if (!same_surface(&batch->render.src, src) ||
+	    !same_surface(&batch->render.dst, dst)) {
+		gen7_emit_binding_table(batch, src, dst);
+		gen7_emit_drawing_rectangle(batch, dst);
+		cache_surface(&batch->render.src, src);
+		cache_surface(&batch->render.dst, dst);
+	}
+
+	/* last, to take up whatever state space is left */
+	n = gen7_emit_vertex_buffer(batch, rects, num_rects);
+
+	OUT_PACKET(GEN7_3DPRIMITIVE | (7 - 2),
+		   GEN7_3DPRIMITIVE_VERTEX_SEQUENTIAL | _3DPRIM_RECTLIST,
+		   3 * n,
+		   0,
+		   1,   /* single instance */
+		   0,   /* start instance location */
+		   0);  /* index buffer offset, ignored */
+
+	return n;
+}
+
+void gen7_render_submit(struct intel_batchbuffer *batch)
+{
+	uint32_t batch_end;
+
+	if (!batch->render.valid)
+		return;
 
 	OUT_BATCH(MI_BATCH_BUFFER_END);
 
@@ -566,3 +688,41 @@ void gen7_render_copyfunc(struct intel_batchbuffer *batch,
 	gen7_render_flush(batch, batch_end);
 	intel_batchbuffer_reset(batch);
 }
+
+void gen7_render_queue_copy(struct intel_batchbuffer *batch,
+			    struct scratch_buf *src, unsigned src_x, unsigned src_y,
+			    unsigned width, unsigned height,
+			    struct scratch_buf *dst, unsigned dst_x, unsigned dst_y)
+{
+	struct render_rect rect = {
+		.src_x = src_x, .src_y = src_y,
+		.dst_x = dst_x, .dst_y = dst_y,
+		.width = width, .height = height,
+	};
+
+	gen7_render_queue_rects(batch, src, dst, &rect, 1);
+}
+
+void gen7_render_copyrects(struct intel_batchbuffer *batch,
+			   struct scratch_buf *src, struct scratch_buf *dst,
+			   const struct render_rect *rects, int num_rects)
+{
+	while (num_rects > 0) {
+		int n = gen7_render_queue_rects(batch, src, dst,
+						rects, num_rects);
+
+		rects += n;
+		num_rects -= n;
+	}
+	gen7_render_submit(batch);
+}
+
+void gen7_render_copyfunc(struct intel_batchbuffer *batch,
+			  struct scratch_buf *src, unsigned src_x, unsigned src_y,
+			  unsigned width, unsigned height,
+			  struct scratch_buf *dst, unsigned dst_x, unsigned dst_y)
+{
+	gen7_render_queue_copy(batch, src, src_x, src_y, width, height,
+			       dst, dst_x, dst_y);
+	gen7_render_submit(batch);
+}
@@ -243,3 +243,15 @@ render_copyfunc_t get_render_copyfunc(int devid)
 
 	return copy;
 }
+
+render_copyrects_t get_render_copyrects(int devid)
+{
+	render_copyrects_t copy = NULL;
+
+	if (IS_GEN6(devid))
+		copy = gen6_render_copyrects;
+	else if (IS_GEN7(devid))
+		copy = gen7_render_copyrects;
+
+	return copy;
+}
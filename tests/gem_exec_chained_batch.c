@@ -0,0 +1,147 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "drm.h"
+#include "i915_drm.h"
+#include "drmtest.h"
+#include "intel_bufmgr.h"
+#include "intel_batchbuffer.h"
+#include "intel_gpu_tools.h"
+
+/*
+ * Testcase: batches that outgrow their buffer
+ *
+ * Emit far more MI_STORE_DATA_IMM than fit in one batch buffer without
+ * flushing, so that the batch has to chain to more bos, and check that all
+ * the stores land once the single execbuffer is done.
+ */
+
+#define NUM_STORES 1024
+
+static drm_intel_bufmgr *bufmgr;
+struct intel_batchbuffer *batch;
+static drm_intel_bo *target_buffer;
+
+static void
+store_dwords(int devid, unsigned int batch_size, bool expect_chain)
+{
+	uint32_t *buf;
+	int i;
+
+	printf("storing %d dwords with a %u byte batch\n",
+	       NUM_STORES, batch_size);
+
+	batch = intel_batchbuffer_alloc_size(bufmgr, devid, batch_size);
+
+	for (i = 0; i < NUM_STORES; i++) {
+		BEGIN_BATCH(4);
+		OUT_BATCH(MI_STORE_DWORD_IMM);
+		OUT_BATCH(0); /* reserved */
+		OUT_RELOC(target_buffer, I915_GEM_DOMAIN_INSTRUCTION,
+			  I915_GEM_DOMAIN_INSTRUCTION, i * 4);
+		OUT_BATCH(i ^ 0xdeadbeef);
+		ADVANCE_BATCH();
+	}
+
+	if ((batch->chain != NULL) != expect_chain) {
+		fprintf(stderr, "batch %s chained\n",
+			expect_chain ? "wasn't" : "was");
+		exit(-1);
+	}
+
+	intel_batchbuffer_flush_on_ring(batch, I915_EXEC_BLT);
+
+	drm_intel_bo_map(target_buffer, 0);
+	buf = target_buffer->virtual;
+	for (i = 0; i < NUM_STORES; i++) {
+		if (buf[i] != (i ^ 0xdeadbeef)) {
+			fprintf(stderr,
+				"value mismatch at %d: cur 0x%08x, stored 0x%08x\n",
+				i, buf[i], i ^ 0xdeadbeef);
+			exit(-1);
+		}
+	}
+	memset(buf, 0, NUM_STORES * 4);
+	drm_intel_bo_unmap(target_buffer);
+
+	intel_batchbuffer_free(batch);
+}
+
+int main(int argc, char **argv)
+{
+	int fd;
+	int devid;
+
+	if (argc != 1) {
+		fprintf(stderr, "usage: %s\n", argv[0]);
+		exit(-1);
+	}
+
+	fd = drm_open_any();
+	devid = intel_get_drm_devid(fd);
+
+	if (!HAS_BLT_RING(devid)) {
+		fprintf(stderr, "MI_STORE_DATA needs the blitter ring\n");
+		return 77;
+	}
+
+	/* This only works with ppgtt */
+	if (!gem_uses_aliasing_ppgtt(fd)) {
+		fprintf(stderr, "no ppgtt detected, which is required\n");
+		return 77;
+	}
+
+	bufmgr = drm_intel_bufmgr_gem_init(fd, 4096);
+	if (!bufmgr) {
+		fprintf(stderr, "failed to init libdrm\n");
+		exit(-1);
+	}
+
+	target_buffer = drm_intel_bo_alloc(bufmgr, "target bo",
+					   NUM_STORES * 4, 4096);
+	if (!target_buffer) {
+		fprintf(stderr, "failed to alloc target buffer\n");
+		exit(-1);
+	}
+
+	/* 16 bytes per store: several bos, then all in one */
+	store_dwords(devid, BATCH_SZ, true);
+	store_dwords(devid, NUM_STORES * 16 + BATCH_SZ, false);
+
+	drm_intel_bo_unreference(target_buffer);
+	drm_intel_bufmgr_destroy(bufmgr);
+
+	close(fd);
+
+	return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "drm.h"
+#include "i915_drm.h"
+#include "drmtest.h"
+#include "intel_bufmgr.h"
+#include "intel_batchbuffer.h"
+#include "intel_gpu_tools.h"
+
+/*
+ * Testcase: batches that do their own execbuffer2 with a handle LUT
+ *
+ * Blit between many bos in one batch, big enough to chain, submitted by
+ * intel_batchbuffer itself. The first round has the kernel relocate, the
+ * later ones presume the bos stay put and tell the kernel to skip the
+ * relocations, which only works out if the bos really didn't move.
+ */
+
+#define NUM_BOS 64
+#define WIDTH 32
+#define HEIGHT 32
+#define ROUNDS 4
+#define COPIES 3
+
+static drm_intel_bufmgr *bufmgr;
+struct intel_batchbuffer *batch;
+static drm_intel_bo *src[NUM_BOS], *dst[NUM_BOS];
+static uint64_t src_offset[NUM_BOS], dst_offset[NUM_BOS];
+
+static void
+copy(drm_intel_bo *dst_bo, drm_intel_bo *src_bo)
+{
+	BEGIN_BATCH(8);
+	OUT_BATCH(XY_SRC_COPY_BLT_CMD |
+		  XY_SRC_COPY_BLT_WRITE_ALPHA |
+		  XY_SRC_COPY_BLT_WRITE_RGB);
+	OUT_BATCH((3 << 24) | /* 32 bits */
+		  (0xcc << 16) | /* copy ROP */
+		  WIDTH * 4);
+	OUT_BATCH(0); /* dst x1,y1 */
+	OUT_BATCH((HEIGHT << 16) | WIDTH); /* dst x2,y2 */
+	OUT_RELOC(dst_bo, I915_GEM_DOMAIN_RENDER, I915_GEM_DOMAIN_RENDER, 0);
+	OUT_BATCH(0); /* src x1,y1 */
+	OUT_BATCH(WIDTH * 4);
+	OUT_RELOC(src_bo, I915_GEM_DOMAIN_RENDER, 0, 0);
+	ADVANCE_BATCH();
+}
+
+static void
+set_bo(drm_intel_bo *bo, uint32_t val)
+{
+	uint32_t data[WIDTH * HEIGHT];
+	int i;
+
+	for (i = 0; i < WIDTH * HEIGHT; i++)
+		data[i] = val;
+	drm_intel_bo_subdata(bo, 0, sizeof(data), data);
+}
+
+static void
+check_bo(drm_intel_bo *bo, uint32_t val)
+{
+	uint32_t data[WIDTH * HEIGHT];
+	int i;
+
+	drm_intel_bo_get_subdata(bo, 0, sizeof(data), data);
+	for (i = 0; i < WIDTH * HEIGHT; i++) {
+		if (data[i] != val) {
+			fprintf(stderr, "Expected 0x%08x, found 0x%08x "
+				"at offset 0x%08x\n",
+				val, data[i], i * 4);
+			exit(-1);
+		}
+	}
+}
+
+/*
+ * The offsets the batch presumed are those the last exec left, so if the
+ * kernel reports the same ones back it had nothing to relocate.
+ */
+static void
+check_offsets(int round)
+{
+	int i;
+
+	for (i = 0; i < NUM_BOS; i++) {
+		if (round > 0 && (src[i]->offset != src_offset[i] ||
+				  dst[i]->offset != dst_offset[i])) {
+			fprintf(stderr, "bo pair %d moved in round %d, "
+				"the relocations weren't skipped\n",
+				i, round);
+			exit(-1);
+		}
+		src_offset[i] = src[i]->offset;
+		dst_offset[i] = dst[i]->offset;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int fd, round, i, j;
+
+	fd = drm_open_any();
+
+	bufmgr = drm_intel_bufmgr_gem_init(fd, 4096);
+	if (!bufmgr) {
+		fprintf(stderr, "failed to init libdrm\n");
+		exit(-1);
+	}
+
+	batch = intel_batchbuffer_alloc(bufmgr, intel_get_drm_devid(fd));
+	if (!intel_batchbuffer_set_lut(batch, fd)) {
+		fprintf(stderr, "no handle LUT support\n");
+		return 77;
+	}
+
+	for (i = 0; i < NUM_BOS; i++) {
+		src[i] = drm_intel_bo_alloc(bufmgr, "src", WIDTH * HEIGHT * 4,
+					    4096);
+		dst[i] = drm_intel_bo_alloc(bufmgr, "dst", WIDTH * HEIGHT * 4,
+					    4096);
+	}
+
+	for (round = 0; round < ROUNDS; round++) {
+		for (i = 0; i < NUM_BOS; i++)
+			set_bo(src[i], round << 16 | i);
+
+		/* the same copies a few times, more than one batch bo holds */
+		for (j = 0; j < COPIES; j++) {
+			for (i = 0; i < NUM_BOS; i++)
+				copy(dst[i], src[i]);
+		}
+		if (batch->chain == NULL) {
+			fprintf(stderr, "batch wasn't chained\n");
+			exit(-1);
+		}
+		intel_batchbuffer_flush(batch);
+		check_offsets(round);
+
+		for (i = 0; i < NUM_BOS; i++)
+			check_bo(dst[i], round << 16 | i);
+	}
+
+	for (i = 0; i < NUM_BOS; i++) {
+		drm_intel_bo_unreference(src[i]);
+		drm_intel_bo_unreference(dst[i]);
+	}
+	intel_batchbuffer_free(batch);
+	drm_intel_bufmgr_destroy(bufmgr);
+
+	close(fd);
+
+	return 0;
+}
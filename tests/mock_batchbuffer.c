@@ -0,0 +1,511 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "i915_drm.h"
+#include "intel_bufmgr.h"
+#include "intel_batchbuffer.h"
+#include "intel_chipset.h"
+#include "intel_reg.h"
+#include "intel_mock_bufmgr.h"
+
+/*
+ * Testcase: what intel_batchbuffer hands to the kernel
+ *
+ * Runs on the mock bufmgr, so it needs no GPU: checks the batch, the
+ * relocations and the buffer list of a blit, and that batches too big for
+ * their buffer chain on everything but gen2, with the jumps encoded for
+ * the ring the batch goes to, also when emitting directly
+ * into the bos, which are never left mapped, that batch bos are recycled,
+ * what the packet emitters write, and a batch doing its own execbuffer,
+ * which skips the relocations once the bos are placed.
+ */
+
+#define NUM_STORES 1024
+#define NUM_TARGETS 100
+
+#define LOCAL_I915_EXEC_NO_RELOC (1<<11)
+#define LOCAL_I915_EXEC_HANDLE_LUT (1<<12)
+#define LOCAL_EXEC_OBJECT_WRITE (1<<2)
+
+static drm_intel_bufmgr *bufmgr;
+struct intel_batchbuffer *batch;
+
+static void
+test_copy_bo(uint32_t devid)
+{
+	const struct intel_mock_exec *exec;
+	const struct intel_mock_buffer *buf;
+	drm_intel_bo *src, *dst;
+
+	src = drm_intel_bo_alloc(bufmgr, "src", 64 * 64 * 4, 4096);
+	dst = drm_intel_bo_alloc(bufmgr, "dst", 64 * 64 * 4, 4096);
+	batch = intel_batchbuffer_alloc(bufmgr, devid);
+
+	/* no kernel, so the batch stays with libdrm */
+	assert(!intel_batchbuffer_set_lut(batch, -1));
+
+	intel_copy_bo(batch, dst, src, 64, 64);
+
+	assert(intel_mock_bufmgr_num_execs(bufmgr) == 1);
+	exec = intel_mock_bufmgr_exec(bufmgr, 0);
+	assert(exec->flags == I915_EXEC_BLT);
+	assert((exec->used & 7) == 0);
+
+	/* the targets come first, the batch last */
+	assert(exec->num_buffers == 3);
+	assert(exec->buffers[0].handle == dst->handle);
+	assert(exec->buffers[1].handle == src->handle);
+	assert(exec->buffers[2].handle == exec->handle);
+
+	assert(exec->num_relocs == 2);
+	assert(exec->relocs[0].target_handle == dst->handle);
+	assert(exec->relocs[0].write_domain == I915_GEM_DOMAIN_RENDER);
+	assert(exec->relocs[0].offset == 4 * 4);
+	assert(exec->relocs[1].target_handle == src->handle);
+	assert(exec->relocs[1].write_domain == 0);
+	assert(exec->relocs[1].offset == 7 * 4);
+
+	buf = intel_mock_exec_buffer(exec, exec->handle);
+	assert(buf->data[0] == (XY_SRC_COPY_BLT_CMD |
+				XY_SRC_COPY_BLT_WRITE_ALPHA |
+				XY_SRC_COPY_BLT_WRITE_RGB));
+	assert(buf->data[4] == dst->offset);
+	assert(buf->data[7] == src->offset);
+	assert(buf->data[exec->used / 4 - 1] == MI_BATCH_BUFFER_END);
+
+	intel_batchbuffer_free(batch);
+	drm_intel_bo_unreference(src);
+	drm_intel_bo_unreference(dst);
+	intel_mock_bufmgr_clear(bufmgr);
+}
+
+static void
+emit_stores(drm_intel_bo *target)
+{
+	int i;
+
+	for (i = 0; i < NUM_STORES; i++) {
+		BEGIN_BATCH(4);
+		OUT_BATCH(MI_STORE_DWORD_IMM);
+		OUT_BATCH(0);
+		OUT_RELOC(target, I915_GEM_DOMAIN_INSTRUCTION,
+			  I915_GEM_DOMAIN_INSTRUCTION, i * 4);
+		OUT_BATCH(i);
+		ADVANCE_BATCH();
+	}
+}
+
+/* Follow the chain from the batch, counting the stores along the way. */
+static int
+count_chained_stores(const struct intel_mock_exec *exec, int *num_bos)
+{
+	const struct intel_mock_buffer *buf;
+	int stores = 0;
+
+	buf = intel_mock_exec_buffer(exec, exec->handle);
+	for (*num_bos = 1; ; (*num_bos)++) {
+		const struct intel_mock_buffer *next = NULL;
+		unsigned int i;
+		int j;
+
+		for (i = 0; i < buf->size / 4; i += 4) {
+			if (buf->data[i] != MI_STORE_DWORD_IMM)
+				break;
+			stores++;
+		}
+
+		if ((buf->data[i] & ~0x3fff) != MI_BATCH_BUFFER_START)
+			return stores;
+
+		for (j = 0; j < exec->num_buffers; j++) {
+			/* gen3 keeps its non-secure bit in the address */
+			if (exec->buffers[j].offset ==
+			    (buf->data[i + 1] & ~MI_BATCH_NON_SECURE))
+				next = &exec->buffers[j];
+		}
+		assert(next != NULL && next->data != NULL);
+		buf = next;
+	}
+}
+
+static void
+test_chain(uint32_t devid, bool direct)
+{
+	const struct intel_mock_exec *exec;
+	drm_intel_bo *target;
+	int i, stores, num_bos, chain_relocs = 0;
+
+	target = drm_intel_bo_alloc(bufmgr, "target", NUM_STORES * 4, 4096);
+	batch = intel_batchbuffer_alloc(bufmgr, devid);
+	if (direct) {
+		intel_batchbuffer_set_direct(batch, true);
+		assert(batch->buffer == batch->bo->virtual);
+	}
+
+	emit_stores(target);
+	assert(intel_mock_bufmgr_num_execs(bufmgr) == 0);
+	intel_batchbuffer_flush(batch);
+
+	assert(intel_mock_bufmgr_num_execs(bufmgr) == 1);
+	exec = intel_mock_bufmgr_exec(bufmgr, 0);
+	for (i = 0; i < exec->num_relocs; i++) {
+		if (exec->relocs[i].read_domains != I915_GEM_DOMAIN_COMMAND)
+			continue;
+
+		assert(exec->relocs[i].delta ==
+		       (IS_965(devid) ? 0 : MI_BATCH_NON_SECURE));
+		chain_relocs++;
+	}
+
+	stores = count_chained_stores(exec, &num_bos);
+	assert(stores == NUM_STORES);
+	assert(num_bos == chain_relocs + 1);
+	assert(num_bos >= NUM_STORES * 16 / BATCH_SZ);
+	assert(exec->num_relocs == NUM_STORES + chain_relocs);
+
+	intel_batchbuffer_free(batch);
+	drm_intel_bo_unreference(target);
+	intel_mock_bufmgr_clear(bufmgr);
+}
+
+/* The jumps use what the kernel starts a batch with on the ring it's on. */
+static void
+test_chain_ring(int ring, bool direct, uint32_t jump)
+{
+	const struct intel_mock_exec *exec;
+	drm_intel_bo *target;
+	int i, num_bos, jumps = 0;
+
+	target = drm_intel_bo_alloc(bufmgr, "target", NUM_STORES * 4, 4096);
+	batch = intel_batchbuffer_alloc(bufmgr, PCI_CHIP_HASWELL_GT2);
+	intel_batchbuffer_set_direct(batch, direct);
+
+	emit_stores(target);
+	intel_batchbuffer_flush_on_ring(batch, ring);
+
+	exec = intel_mock_bufmgr_exec(bufmgr, 0);
+	assert(exec->flags == ring);
+	assert(count_chained_stores(exec, &num_bos) == NUM_STORES);
+	for (i = 0; i < exec->num_buffers; i++) {
+		const struct intel_mock_buffer *buf = &exec->buffers[i];
+		unsigned int j;
+
+		if (buf->data == NULL)
+			continue;
+
+		for (j = 0; j < buf->size / 4; j += 4) {
+			if (buf->data[j] != MI_STORE_DWORD_IMM)
+				break;
+		}
+		if ((buf->data[j] & ~0x3fff) == MI_BATCH_BUFFER_START) {
+			assert(buf->data[j] == jump);
+			jumps++;
+		}
+	}
+	assert(jumps == num_bos - 1);
+
+	intel_batchbuffer_free(batch);
+	drm_intel_bo_unreference(target);
+	intel_mock_bufmgr_clear(bufmgr);
+}
+
+/* Direct mode never leaves a batch bo mapped behind it. */
+static void
+test_direct_unmap(void)
+{
+	batch = intel_batchbuffer_alloc(bufmgr, PCI_CHIP_IVYBRIDGE_GT2);
+
+	intel_batchbuffer_set_direct(batch, true);
+	assert(intel_mock_bufmgr_live_maps(bufmgr) == 1);
+	intel_batchbuffer_reset(batch);
+	assert(intel_mock_bufmgr_live_maps(bufmgr) == 1);
+	intel_batchbuffer_set_direct(batch, false);
+	assert(intel_mock_bufmgr_live_maps(bufmgr) == 0);
+
+	/* freed while mapped, with nothing flushed */
+	intel_batchbuffer_set_direct(batch, true);
+	intel_batchbuffer_free(batch);
+	assert(intel_mock_bufmgr_live_maps(bufmgr) == 0);
+
+	intel_mock_bufmgr_clear(bufmgr);
+}
+
+static void
+test_gen2_flush(void)
+{
+	drm_intel_bo *target;
+	int i;
+
+	target = drm_intel_bo_alloc(bufmgr, "target", NUM_STORES * 4, 4096);
+	batch = intel_batchbuffer_alloc(bufmgr, PCI_CHIP_I830_M);
+
+	emit_stores(target);
+	intel_batchbuffer_flush(batch);
+
+	assert(intel_mock_bufmgr_num_execs(bufmgr) > 1);
+	for (i = 0; i < intel_mock_bufmgr_num_execs(bufmgr); i++) {
+		const struct intel_mock_exec *exec =
+			intel_mock_bufmgr_exec(bufmgr, i);
+
+		assert(exec->num_buffers == 2);
+	}
+
+	intel_batchbuffer_free(batch);
+	drm_intel_bo_unreference(target);
+	intel_mock_bufmgr_clear(bufmgr);
+}
+
+static void
+test_pool(void)
+{
+	const struct intel_mock_exec *exec;
+	drm_intel_bo *first, *src, *dst;
+	int i;
+
+	batch = intel_batchbuffer_alloc(bufmgr, PCI_CHIP_IVYBRIDGE_GT2);
+	first = batch->bo;
+
+	/* idle bos come straight back */
+	for (i = 0; i < 4; i++) {
+		intel_batchbuffer_emit_mi_flush(batch);
+		intel_batchbuffer_flush(batch);
+		assert(batch->bo == first);
+	}
+	assert(batch->allocs == 1 && batch->stalls == 0);
+
+	/* busy ones make the pool grow, then wait */
+	intel_mock_bufmgr_set_keep_busy(bufmgr, true);
+	for (i = 0; i < BATCH_POOL_MAX + 2; i++) {
+		intel_batchbuffer_emit_mi_flush(batch);
+		intel_batchbuffer_flush(batch);
+	}
+	assert(batch->allocs == BATCH_POOL_MAX);
+	assert(batch->stalls == 3);
+	intel_mock_bufmgr_set_keep_busy(bufmgr, false);
+
+	/* a recycled bo carries no stale relocations */
+	src = drm_intel_bo_alloc(bufmgr, "src", 64 * 64 * 4, 4096);
+	dst = drm_intel_bo_alloc(bufmgr, "dst", 64 * 64 * 4, 4096);
+	for (i = 0; i < BATCH_POOL_MAX + 1; i++)
+		intel_copy_bo(batch, dst, src, 64, 64);
+	exec = intel_mock_bufmgr_exec(bufmgr,
+				      intel_mock_bufmgr_num_execs(bufmgr) - 1);
+	assert(exec->num_relocs == 2);
+
+	intel_batchbuffer_free(batch);
+	drm_intel_bo_unreference(src);
+	drm_intel_bo_unreference(dst);
+	intel_mock_bufmgr_clear(bufmgr);
+}
+
+static void
+test_packets(void)
+{
+	const struct intel_mock_exec *exec;
+	const struct intel_mock_buffer *buf;
+	drm_intel_bo *target;
+
+	target = drm_intel_bo_alloc(bufmgr, "target", 4096, 4096);
+	batch = intel_batchbuffer_alloc(bufmgr, PCI_CHIP_IVYBRIDGE_GT2);
+
+	/* chain in the middle of a packet rather than split it */
+	while (intel_batchbuffer_space(batch) > 8)
+		OUT_BATCH(MI_NOOP);
+	intel_emit_store_dword_imm(batch, target, 64, 0xdeadbeef);
+	assert(batch->chain != NULL);
+	assert(batch->ptr == batch->buffer + 16);
+	intel_batchbuffer_flush(batch);
+	intel_mock_bufmgr_clear(bufmgr);
+
+	intel_emit_xy_color_blt(batch, XY_COLOR_BLT_WRITE_RGB,
+				(3 << 24) | (0xf0 << 16) | 256,
+				target, 4, 8, 16, 2, 0x12345678);
+	intel_emit_store_dword_imm(batch, target, 64, 0xdeadbeef);
+	intel_emit_pipe_control(batch, PIPE_CONTROL_CS_STALL |
+				PIPE_CONTROL_WRITE_IMMEDIATE,
+				target, 128 | PIPE_CONTROL_GLOBAL_GTT, 1);
+	intel_emit_pipe_control(batch, PIPE_CONTROL_CS_STALL, NULL, 0, 0);
+	OUT_PACKET(MI_NOOP, MI_NOOP);
+	assert(batch->ptr - batch->buffer == (6 + 4 + 4 + 4 + 2) * 4);
+	intel_batchbuffer_flush(batch);
+
+	exec = intel_mock_bufmgr_exec(bufmgr, 0);
+	assert(exec->num_relocs == 3);
+	assert(exec->relocs[0].offset == 4 * 4);
+	assert(exec->relocs[0].write_domain == I915_GEM_DOMAIN_RENDER);
+	assert(exec->relocs[1].offset == 8 * 4);
+	assert(exec->relocs[1].delta == 64);
+	assert(exec->relocs[2].offset == 12 * 4);
+	assert(exec->relocs[2].delta == (128 | PIPE_CONTROL_GLOBAL_GTT));
+
+	buf = intel_mock_exec_buffer(exec, exec->handle);
+	assert(buf->data[0] == (XY_COLOR_BLT_CMD | XY_COLOR_BLT_WRITE_RGB));
+	assert(buf->data[1] == ((3 << 24) | (0xf0 << 16) | 256));
+	assert(buf->data[2] == (8 << 16 | 4));
+	assert(buf->data[3] == (10 << 16 | 20));
+	assert(buf->data[4] == target->offset);
+	assert(buf->data[5] == 0x12345678);
+
+	assert(buf->data[6] == MI_STORE_DWORD_IMM);
+	assert(buf->data[7] == 0);
+	assert(buf->data[8] == target->offset + 64);
+	assert(buf->data[9] == 0xdeadbeef);
+
+	assert(buf->data[10] == PIPE_CONTROL);
+	assert(buf->data[11] == (PIPE_CONTROL_CS_STALL |
+				 PIPE_CONTROL_WRITE_IMMEDIATE));
+	assert(buf->data[12] == target->offset + (128 | PIPE_CONTROL_GLOBAL_GTT));
+	assert(buf->data[13] == 1);
+
+	assert(buf->data[14] == PIPE_CONTROL);
+	assert(buf->data[16] == 0);
+	assert(buf->data[18] == MI_NOOP && buf->data[19] == MI_NOOP);
+
+	intel_batchbuffer_free(batch);
+	drm_intel_bo_unreference(target);
+	intel_mock_bufmgr_clear(bufmgr);
+}
+
+/* More targets than the handle LUT lists start out with. */
+static void
+test_lut(void)
+{
+	const struct intel_mock_exec *exec;
+	const struct intel_mock_buffer *buf;
+	drm_intel_bo *target[NUM_TARGETS];
+	int i;
+
+	for (i = 0; i < NUM_TARGETS; i++)
+		target[i] = drm_intel_bo_alloc(bufmgr, "target", 4096, 4096);
+	batch = intel_batchbuffer_alloc(bufmgr, PCI_CHIP_IVYBRIDGE_GT2);
+	assert(intel_batchbuffer_set_lut(batch, intel_mock_bufmgr_fd(bufmgr)));
+
+	for (i = 0; i < NUM_TARGETS; i++)
+		intel_emit_store_dword_imm(batch, target[i], 0, i);
+	intel_batchbuffer_flush(batch);
+
+	assert(intel_mock_bufmgr_num_execs(bufmgr) == 1);
+	exec = intel_mock_bufmgr_exec(bufmgr, 0);
+	assert(exec->flags & LOCAL_I915_EXEC_HANDLE_LUT);
+	assert(exec->num_buffers == NUM_TARGETS + 1);
+	assert(exec->num_relocs == NUM_TARGETS);
+
+	buf = intel_mock_exec_buffer(exec, exec->handle);
+	for (i = 0; i < NUM_TARGETS; i++) {
+		assert(exec->buffers[i].handle == target[i]->handle);
+		assert(exec->buffers[i].flags & LOCAL_EXEC_OBJECT_WRITE);
+		assert(exec->relocs[i].target_handle == target[i]->handle);
+		assert(buf->data[4 * i + 2] == target[i]->offset);
+	}
+
+	intel_batchbuffer_free(batch);
+	for (i = 0; i < NUM_TARGETS; i++)
+		drm_intel_bo_unreference(target[i]);
+	intel_mock_bufmgr_clear(bufmgr);
+}
+
+/*
+ * A LUT batch that chains, run again and again. The kernel places the
+ * fresh target on the first exec, after that the presumed offsets are
+ * right and it is told to skip the relocations.
+ */
+static void
+test_lut_no_reloc(void)
+{
+	const struct intel_mock_exec *exec;
+	const struct intel_mock_buffer *buf;
+	drm_intel_bo *target;
+	int round, num_bos;
+
+	target = drm_intel_bo_alloc(bufmgr, "target", NUM_STORES * 4, 4096);
+	target->offset = 0;
+	batch = intel_batchbuffer_alloc(bufmgr, PCI_CHIP_IVYBRIDGE_GT2);
+	assert(intel_batchbuffer_set_lut(batch, intel_mock_bufmgr_fd(bufmgr)));
+
+	for (round = 0; round < 3; round++) {
+		emit_stores(target);
+		assert(batch->chain != NULL);
+		intel_batchbuffer_flush(batch);
+
+		assert(intel_mock_bufmgr_num_execs(bufmgr) == round + 1);
+		exec = intel_mock_bufmgr_exec(bufmgr, round);
+		if (round == 0) {
+			assert(exec->num_relocated == NUM_STORES);
+		} else {
+			assert(exec->flags & LOCAL_I915_EXEC_NO_RELOC);
+			assert(exec->num_relocated == 0);
+		}
+
+		assert(target->offset != 0);
+		/* with no relocations to go by, the kernel needs telling */
+		assert(intel_mock_exec_buffer(exec, target->handle)->flags &
+		       LOCAL_EXEC_OBJECT_WRITE);
+		assert(count_chained_stores(exec, &num_bos) == NUM_STORES);
+		buf = intel_mock_exec_buffer(exec, exec->handle);
+		assert(buf->data[2] == target->offset);
+	}
+
+	intel_batchbuffer_free(batch);
+	drm_intel_bo_unreference(target);
+	intel_mock_bufmgr_clear(bufmgr);
+}
+
+int main(int argc, char **argv)
+{
+	bufmgr = intel_mock_bufmgr_init();
+	assert(bufmgr);
+
+	test_copy_bo(PCI_CHIP_SANDYBRIDGE_GT1);
+	test_chain(PCI_CHIP_I945_G, false);
+	test_chain(PCI_CHIP_SANDYBRIDGE_GT1, false);
+	test_chain(PCI_CHIP_IVYBRIDGE_GT2, false);
+	test_chain(PCI_CHIP_HASWELL_GT2, false);
+	test_chain(PCI_CHIP_IVYBRIDGE_GT2, true);
+	test_chain_ring(I915_EXEC_BLT, false,
+			MI_BATCH_BUFFER_START | MI_BATCH_NON_SECURE_I965);
+	test_chain_ring(I915_EXEC_RENDER, false,
+			MI_BATCH_BUFFER_START |
+			MI_BATCH_PPGTT_HSW | MI_BATCH_NON_SECURE_HSW);
+	test_chain_ring(I915_EXEC_RENDER, true,
+			MI_BATCH_BUFFER_START |
+			MI_BATCH_PPGTT_HSW | MI_BATCH_NON_SECURE_HSW);
+	test_direct_unmap();
+	test_gen2_flush();
+	test_pool();
+	test_packets();
+	test_lut();
+	test_lut_no_reloc();
+
+	/* nothing leaked, chained bos included */
+	assert(intel_mock_bufmgr_live_bos(bufmgr) == 0);
+	assert(intel_mock_bufmgr_live_maps(bufmgr) == 0);
+
+	drm_intel_bufmgr_destroy(bufmgr);
+
+	return 0;
+}
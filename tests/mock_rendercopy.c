@@ -0,0 +1,263 @@
+/*
+ * Copyright © 2013 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "i915_drm.h"
+#include "intel_bufmgr.h"
+#include "intel_batchbuffer.h"
+#include "intel_chipset.h"
+#include "intel_mock_bufmgr.h"
+#include "rendercopy.h"
+#include "gen7_render.h"
+
+/*
+ * Testcase: what a multi-rectangle render copy hands to the kernel
+ *
+ * Runs on the mock bufmgr, so it needs no GPU: copies a lot of rectangles
+ * in one call and checks that every batch has a single 3DPRIMITIVE, that
+ * the vertex counts add up, and that bigger batches take fewer execs. Then
+ * queues copies on gen7 and checks that they share the pipeline setup,
+ * and that a plain flush submits them the same way.
+ */
+
+#define NUM_QUEUED 16
+
+#define WIDTH 1024
+#define HEIGHT 1024
+#define TILE 16
+#define NUM_RECTS (WIDTH / TILE * HEIGHT / TILE)
+
+static drm_intel_bufmgr *bufmgr;
+struct intel_batchbuffer *batch;
+static struct render_rect rects[NUM_RECTS];
+
+static void
+init_buf(struct scratch_buf *buf)
+{
+	memset(buf, 0, sizeof(*buf));
+	buf->bo = drm_intel_bo_alloc(bufmgr, "", WIDTH * HEIGHT * 4, 4096);
+	buf->stride = WIDTH * 4;
+	buf->tiling = I915_TILING_NONE;
+	buf->size = WIDTH * HEIGHT * 4;
+}
+
+static int
+count_commands(const struct intel_mock_exec *exec, uint32_t cmd)
+{
+	const struct intel_mock_buffer *buf;
+	unsigned int i;
+	int count = 0;
+
+	buf = intel_mock_exec_buffer(exec, exec->handle);
+	for (i = 0; i < exec->used / 4; i++) {
+		if ((buf->data[i] & 0xffff0000) == cmd)
+			count++;
+	}
+
+	return count;
+}
+
+/* 3DPRIMITIVE has the same opcode on gen6 and gen7, the vertex count
+ * follows the header on gen6 and the topology on gen7. */
+static int
+count_vertices(const struct intel_mock_exec *exec, uint32_t devid)
+{
+	const struct intel_mock_buffer *buf;
+	unsigned int i;
+	int primitives = 0, vertices = 0;
+
+	buf = intel_mock_exec_buffer(exec, exec->handle);
+	for (i = 0; i < exec->used / 4; i++) {
+		if ((buf->data[i] & 0xffff0000) != GEN7_3DPRIMITIVE)
+			continue;
+
+		vertices = buf->data[i + (IS_GEN6(devid) ? 1 : 2)];
+		primitives++;
+	}
+	assert(primitives == 1);
+
+	return vertices;
+}
+
+static int
+test_copyrects(uint32_t devid, unsigned int batch_size)
+{
+	render_copyrects_t copy = get_render_copyrects(devid);
+	struct scratch_buf src, dst;
+	int i, num_execs, vertices = 0;
+
+	assert(copy != NULL);
+
+	batch = intel_batchbuffer_alloc_size(bufmgr, devid, batch_size);
+	init_buf(&src);
+	init_buf(&dst);
+
+	copy(batch, &src, &dst, rects, NUM_RECTS);
+
+	num_execs = intel_mock_bufmgr_num_execs(bufmgr);
+	for (i = 0; i < num_execs; i++)
+		vertices += count_vertices(intel_mock_bufmgr_exec(bufmgr, i),
+					   devid);
+	assert(vertices == 3 * NUM_RECTS);
+	assert(num_execs < NUM_RECTS / 10);
+
+	intel_batchbuffer_free(batch);
+	drm_intel_bo_unreference(src.bo);
+	drm_intel_bo_unreference(dst.bo);
+	intel_mock_bufmgr_clear(bufmgr);
+
+	return num_execs;
+}
+
+static void
+test_queue(uint32_t devid)
+{
+	const struct intel_mock_exec *exec;
+	struct scratch_buf src, dst;
+	unsigned int first, second;
+	int i;
+
+	batch = intel_batchbuffer_alloc(bufmgr, devid);
+	init_buf(&src);
+	init_buf(&dst);
+
+	/* one copy on its own, to size up the full setup */
+	gen7_render_copyfunc(batch, &src, 0, 0, TILE, TILE, &dst, 0, 0);
+	exec = intel_mock_bufmgr_exec(bufmgr, 0);
+	first = exec->used;
+
+	/* the rest only add a flush, the vertices and the primitive */
+	for (i = 0; i < NUM_QUEUED; i++)
+		gen7_render_queue_copy(batch, &src, i * TILE, 0, TILE, TILE,
+				       &dst, i * TILE, 0);
+	assert(intel_mock_bufmgr_num_execs(bufmgr) == 1);
+	gen7_render_submit(batch);
+	assert(intel_mock_bufmgr_num_execs(bufmgr) == 2);
+
+	exec = intel_mock_bufmgr_exec(bufmgr, 1);
+	second = exec->used;
+	assert((second - first) / (NUM_QUEUED - 1) < first / 8);
+	assert(count_commands(exec, GEN7_3DPRIMITIVE) == NUM_QUEUED);
+	assert(count_commands(exec, GEN7_3DSTATE_URB_VS) == 1);
+	assert(count_commands(exec, GEN7_3DSTATE_BINDING_TABLE_POINTERS_PS) == 1);
+
+	/* new surfaces get bound again */
+	for (i = 0; i < NUM_QUEUED; i++)
+		gen7_render_queue_copy(batch, i & 1 ? &src : &dst, 0, 0,
+				       TILE, TILE,
+				       i & 1 ? &dst : &src, 0, 0);
+	gen7_render_submit(batch);
+	exec = intel_mock_bufmgr_exec(bufmgr, 2);
+	assert(count_commands(exec, GEN7_3DSTATE_BINDING_TABLE_POINTERS_PS) ==
+	       NUM_QUEUED);
+
+	/* nothing queued, nothing to submit */
+	gen7_render_submit(batch);
+	assert(intel_mock_bufmgr_num_execs(bufmgr) == 3);
+
+	intel_batchbuffer_free(batch);
+	drm_intel_bo_unreference(src.bo);
+	drm_intel_bo_unreference(dst.bo);
+	intel_mock_bufmgr_clear(bufmgr);
+}
+
+/* A plain flush of queued copies submits them like gen7_render_submit(). */
+static void
+test_queue_flush(uint32_t devid)
+{
+	const struct intel_mock_exec *submitted, *flushed;
+	struct scratch_buf src, dst;
+	int i, pass;
+
+	batch = intel_batchbuffer_alloc(bufmgr, devid);
+	init_buf(&src);
+	init_buf(&dst);
+
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < NUM_QUEUED; i++)
+			gen7_render_queue_copy(batch, &src, i * TILE, 0,
+					       TILE, TILE, &dst, i * TILE, 0);
+		if (pass == 0)
+			gen7_render_submit(batch);
+		else
+			intel_batchbuffer_flush(batch);
+	}
+
+	assert(intel_mock_bufmgr_num_execs(bufmgr) == 2);
+	submitted = intel_mock_bufmgr_exec(bufmgr, 0);
+	flushed = intel_mock_bufmgr_exec(bufmgr, 1);
+	assert(flushed->flags == submitted->flags);
+	assert(flushed->used == submitted->used);
+	assert(flushed->handle == submitted->handle);
+	assert(count_commands(flushed, GEN7_3DPRIMITIVE) == NUM_QUEUED);
+
+	/* the state past the commands went too */
+	assert(memcmp(intel_mock_exec_buffer(flushed, flushed->handle)->data,
+		      intel_mock_exec_buffer(submitted, submitted->handle)->data,
+		      batch->size) == 0);
+
+	intel_batchbuffer_free(batch);
+	drm_intel_bo_unreference(src.bo);
+	drm_intel_bo_unreference(dst.bo);
+	intel_mock_bufmgr_clear(bufmgr);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t devids[] = {
+		PCI_CHIP_SANDYBRIDGE_GT1,
+		PCI_CHIP_IVYBRIDGE_GT2,
+		PCI_CHIP_HASWELL_GT2,
+	};
+	int i;
+
+	for (i = 0; i < NUM_RECTS; i++) {
+		rects[i].src_x = rects[i].dst_x = i % (WIDTH / TILE) * TILE;
+		rects[i].src_y = rects[i].dst_y = i / (WIDTH / TILE) * TILE;
+		rects[i].width = rects[i].height = TILE;
+	}
+
+	bufmgr = intel_mock_bufmgr_init();
+	assert(bufmgr);
+
+	for (i = 0; i < sizeof(devids) / sizeof(devids[0]); i++) {
+		assert(test_copyrects(devids[i], BATCH_SZ) >
+		       test_copyrects(devids[i], 16 * BATCH_SZ));
+	}
+
+	test_queue(PCI_CHIP_IVYBRIDGE_GT2);
+	test_queue(PCI_CHIP_HASWELL_GT2);
+	test_queue_flush(PCI_CHIP_IVYBRIDGE_GT2);
+	test_queue_flush(PCI_CHIP_HASWELL_GT2);
+
+	/* nothing leaked */
+	assert(intel_mock_bufmgr_live_bos(bufmgr) == 0);
+
+	drm_intel_bufmgr_destroy(bufmgr);
+
+	return 0;
+}
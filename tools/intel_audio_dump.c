@@ -34,6 +34,7 @@
 #include <err.h>
 #include <arpa/inet.h>
 #include "intel_gpu_tools.h"
+#include "intel_reg_desc.h"
 
 static uint32_t devid;
 
@@ -57,6 +58,14 @@ static uint32_t devid;
 	    printf("%-21s 0x%08x  %s\n", # reg, dword, desc);	\
     } while (0)
 
+/* Registers known to the description database carry their own name/desc */
+#define dump_desc(id)						\
+    do {							\
+	    dword = DESC_INREG(id);				\
+	    printf("%-21s 0x%08x  %s\n", intel_reg_name(id),	\
+		   dword, intel_reg_description(id));		\
+    } while (0)
+
 
 static const char *pixel_clock[] = {
 	[0] = "25.2 / 1.001 MHz",
@@ -248,6 +257,39 @@ static void do_self_tests(void)
 #define AUDIO_HOTPLUG_EN	(1<<24)
 
 
+static const enum intel_reg_id eaglelake_audio_regs[] = {
+	INTEL_REG_AUD_CONFIG,
+	INTEL_REG_AUD_DEBUG,
+	INTEL_REG_AUD_VID_DID,
+	INTEL_REG_AUD_RID,
+	INTEL_REG_AUD_SUBN_CNT,
+	INTEL_REG_AUD_FUNC_GRP,
+	INTEL_REG_AUD_SUBN_CNT2,
+	INTEL_REG_AUD_GRP_CAP,
+	INTEL_REG_AUD_PWRST,
+	INTEL_REG_AUD_SUPPWR,
+	INTEL_REG_AUD_SID,
+	INTEL_REG_AUD_OUT_CWCAP,
+	INTEL_REG_AUD_OUT_PCMSIZE,
+	INTEL_REG_AUD_OUT_STR,
+	INTEL_REG_AUD_OUT_DIG_CNVT,
+	INTEL_REG_AUD_OUT_CH_STR,
+	INTEL_REG_AUD_OUT_STR_DESC,
+	INTEL_REG_AUD_PINW_CAP,
+	INTEL_REG_AUD_PIN_CAP,
+	INTEL_REG_AUD_PINW_CONNLNG,
+	INTEL_REG_AUD_PINW_CONNLST,
+	INTEL_REG_AUD_PINW_CNTR,
+	INTEL_REG_AUD_PINW_UNSOLRESP,
+	INTEL_REG_AUD_CNTL_ST,
+	INTEL_REG_AUD_PINW_CONFIG,
+	INTEL_REG_AUD_HDMIW_STATUS,
+	INTEL_REG_AUD_HDMIW_HDMIEDID,
+	INTEL_REG_AUD_HDMIW_INFOFR,
+	INTEL_REG_AUD_CONV_CHCNT,
+	INTEL_REG_AUD_CTS_ENABLE,
+};
+
 static void dump_eaglelake(void)
 {
     uint32_t dword;
@@ -255,53 +297,31 @@ static void dump_eaglelake(void)
 
     /* printf("%-18s   %8s  %s\n\n", "register name", "raw value", "description"); */
 
-    dump_reg(VIDEO_DIP_CTL,	"Video DIP Control");
-    dump_reg(SDVOB,		"Digital Display Port B Control Register");
-    dump_reg(SDVOC,		"Digital Display Port C Control Register");
-    dump_reg(PORT_HOTPLUG_EN,	"Hot Plug Detect Enable");
-
-    dump_reg(AUD_CONFIG,	"Audio Configuration");
-    dump_reg(AUD_DEBUG,		"Audio Debug");
-    dump_reg(AUD_VID_DID,	"Audio Vendor ID / Device ID");
-    dump_reg(AUD_RID,		"Audio Revision ID");
-    dump_reg(AUD_SUBN_CNT,	"Audio Subordinate Node Count");
-    dump_reg(AUD_FUNC_GRP,	"Audio Function Group Type");
-    dump_reg(AUD_SUBN_CNT2,	"Audio Subordinate Node Count");
-    dump_reg(AUD_GRP_CAP,	"Audio Function Group Capabilities");
-    dump_reg(AUD_PWRST,		"Audio Power State");
-    dump_reg(AUD_SUPPWR,	"Audio Supported Power States");
-    dump_reg(AUD_SID,		"Audio Root Node Subsystem ID");
-    dump_reg(AUD_OUT_CWCAP,	"Audio Output Converter Widget Capabilities");
-    dump_reg(AUD_OUT_PCMSIZE,	"Audio PCM Size and Rates");
-    dump_reg(AUD_OUT_STR,	"Audio Stream Formats");
-    dump_reg(AUD_OUT_DIG_CNVT,	"Audio Digital Converter");
-    dump_reg(AUD_OUT_CH_STR,	"Audio Channel ID and Stream ID");
-    dump_reg(AUD_OUT_STR_DESC,	"Audio Stream Descriptor Format");
-    dump_reg(AUD_PINW_CAP,	"Audio Pin Complex Widget Capabilities");
-    dump_reg(AUD_PIN_CAP,	"Audio Pin Capabilities");
-    dump_reg(AUD_PINW_CONNLNG,	"Audio Connection List Length");
-    dump_reg(AUD_PINW_CONNLST,	"Audio Connection List Entry");
-    dump_reg(AUD_PINW_CNTR,	"Audio Pin Widget Control");
-    dump_reg(AUD_PINW_UNSOLRESP,"Audio Unsolicited Response Enable");
-    dump_reg(AUD_CNTL_ST,	"Audio Control State Register");
-    dump_reg(AUD_PINW_CONFIG,	"Audio Configuration Default");
-    dump_reg(AUD_HDMIW_STATUS,	"Audio HDMI Status");
-    dump_reg(AUD_HDMIW_HDMIEDID,"Audio HDMI Data EDID Block");
-    dump_reg(AUD_HDMIW_INFOFR,	"Audio HDMI Widget Data Island Packet");
-    dump_reg(AUD_CONV_CHCNT,	"Audio Converter Channel Count");
-    dump_reg(AUD_CTS_ENABLE,	"Audio CTS Programming Enable");
+    dump_desc(INTEL_REG_VIDEO_DIP_CTL);
+    dump_desc(INTEL_REG_SDVOB);
+    dump_desc(INTEL_REG_SDVOC);
+    dump_desc(INTEL_REG_PORT_HOTPLUG_EN);
 
-    printf("\nDetails:\n\n");
+    for (i = 0; i < ARRAY_SIZE(eaglelake_audio_regs); i++)
+	    dump_desc(eaglelake_audio_regs[i]);
 
-    dword = INREG(AUD_VID_DID);
-    printf("AUD_VID_DID vendor id\t\t\t0x%x\n", dword >> 16);
-    printf("AUD_VID_DID device id\t\t\t0x%x\n", dword & 0xffff);
+    printf("\nDetails:\n\n");
 
-    dword = INREG(AUD_RID);
-    printf("AUD_RID major revision\t\t\t0x%lx\n", BITS(dword, 23, 20));
-    printf("AUD_RID minor revision\t\t\t0x%lx\n", BITS(dword, 19, 16));
-    printf("AUD_RID revision id\t\t\t0x%lx\n",    BITS(dword, 15, 8));
-    printf("AUD_RID stepping id\t\t\t0x%lx\n",    BITS(dword, 7, 0));
+    dword = DESC_INREG(INTEL_REG_AUD_VID_DID);
+    printf("AUD_VID_DID vendor id\t\t\t0x%x\n",
+	   intel_reg_field_get(INTEL_FIELD_AUD_VID_DID_VENDOR_ID, dword));
+    printf("AUD_VID_DID device id\t\t\t0x%x\n",
+	   intel_reg_field_get(INTEL_FIELD_AUD_VID_DID_DEVICE_ID, dword));
+
+    dword = DESC_INREG(INTEL_REG_AUD_RID);
+    printf("AUD_RID major revision\t\t\t0x%x\n",
+	   intel_reg_field_get(INTEL_FIELD_AUD_RID_MAJOR_REVISION, dword));
+    printf("AUD_RID minor revision\t\t\t0x%x\n",
+	   intel_reg_field_get(INTEL_FIELD_AUD_RID_MINOR_REVISION, dword));
+    printf("AUD_RID revision id\t\t\t0x%x\n",
+	   intel_reg_field_get(INTEL_FIELD_AUD_RID_REVISION_ID, dword));
+    printf("AUD_RID stepping id\t\t\t0x%x\n",
+	   intel_reg_field_get(INTEL_FIELD_AUD_RID_STEPPING_ID, dword));
 
     dword = INREG(SDVOB);
     printf("SDVOB enable\t\t\t\t%u\n",      !!(dword & SDVO_ENABLE));
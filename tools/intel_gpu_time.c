@@ -26,21 +26,166 @@
  *
  */
 
+#define _GNU_SOURCE
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/time.h>
+#include <string.h>
 #include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 
 #include "intel_gpu_tools.h"
+#include "intel_ring.h"
+#include "intel_sampler.h"
 
 #define SAMPLES_PER_SEC             10000
+#define DRAIN_PER_SEC		    10
+
+/* the child marks the start of a phase by writing its name to this FIFO */
+#define PHASE_ENV		    "INTEL_GPU_TIME_PHASE"
+
+/*
+ * Where the samples go. The first phase is "default", the child can start
+ * others by name; a phase entered several times accumulates.
+ */
+struct phase {
+	char *name;
+	uint64_t time;		/* ns spent in the phase */
+	uint64_t periods;	/* sampling periods covered */
+	uint64_t gpu_idle;
+	uint64_t ring_idle[INTEL_MAX_RINGS];
+};
+
+static struct intel_sampler sampler = {
+	.cpu = -1,
+};
+
+static struct phase *phases;
+static int num_phases, current_phase;
+static uint64_t phase_start;
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+account_sample(const struct intel_sample *sample, void *data)
+{
+	struct phase *phase = &phases[current_phase];
+	int i, idle = 0;
+
+	for (i = 0; i < sampler.num_rings; i++) {
+		if (sample->ring[i].head == sample->ring[i].tail) {
+			phase->ring_idle[i] += sample->weight;
+			idle++;
+		}
+	}
+	/* the GPU is busy as long as any of its rings is */
+	if (idle == sampler.num_rings)
+		phase->gpu_idle += sample->weight;
+	phase->periods += sample->weight;
+}
+
+static void
+enter_phase(const char *name)
+{
+	uint64_t now = now_ns();
+	int i;
+
+	/* what was sampled so far belongs to the phase we are leaving */
+	intel_sampler_drain(&sampler, account_sample, NULL);
+	if (num_phases)
+		phases[current_phase].time += now - phase_start;
+	phase_start = now;
+
+	for (i = 0; i < num_phases; i++) {
+		if (!strcmp(phases[i].name, name))
+			break;
+	}
+
+	if (i == num_phases) {
+		phases = realloc(phases, (num_phases + 1) * sizeof(*phases));
+		if (phases == NULL) {
+			fprintf(stderr, "Couldn't allocate phase\n");
+			exit(1);
+		}
+		memset(&phases[i], 0, sizeof(*phases));
+		phases[i].name = strdup(name);
+		num_phases++;
+	}
 
-static volatile int goddo;
+	current_phase = i;
+}
+
+/* Start a phase for every complete line written to the FIFO. */
+static void
+read_phases(int fd)
+{
+	static char buf[4096];
+	static size_t len;
+	ssize_t ret;
+	char *line, *nl;
+
+	ret = read(fd, buf + len, sizeof(buf) - 1 - len);
+	if (ret <= 0)
+		return;
+	len += ret;
+	buf[len] = '\0';
+
+	line = buf;
+	while ((nl = strchr(line, '\n'))) {
+		*nl = '\0';
+		if (nl > line && nl[-1] == '\r')
+			nl[-1] = '\0';
+		if (*line)
+			enter_phase(line);
+		line = nl + 1;
+	}
+
+	len -= line - buf;
+	memmove(buf, line, len);
+
+	/* a name longer than the buffer is cut short */
+	if (len == sizeof(buf) - 1) {
+		enter_phase(buf);
+		len = 0;
+	}
+}
+
+/*
+ * A descriptor that polls readable once the child exits: a pidfd where
+ * the kernel has them, otherwise a signalfd for SIGCHLD, which the caller
+ * blocked before forking.
+ */
+static int
+child_fd(pid_t pid, const sigset_t *sigchld)
+{
+	int fd = -1;
+
+#ifdef SYS_pidfd_open
+	fd = syscall(SYS_pidfd_open, pid, 0);
+#endif
+	if (fd < 0)
+		fd = signalfd(-1, sigchld, SFD_NONBLOCK | SFD_CLOEXEC);
 
-static pid_t spawn(char **argv)
+	return fd;
+}
+
+static pid_t spawn(char **argv, const sigset_t *sigmask)
 {
 	pid_t pid;
 
@@ -48,63 +193,281 @@ static pid_t spawn(char **argv)
 	if (pid != 0)
 		return pid;
 
+	sigprocmask(SIG_SETMASK, sigmask, NULL);
 	execvp(argv[0], argv);
-	exit(1);
+	_exit(127);
+}
+
+static double
+percent_busy(uint64_t idle, uint64_t periods)
+{
+	return periods ? 100 - idle * 100. / periods : 0;
+}
+
+static void
+json_string(FILE *out, const char *str)
+{
+	fputc('"', out);
+	for (; *str; str++) {
+		unsigned char c = *str;
+
+		if (c == '"' || c == '\\')
+			fprintf(out, "\\%c", c);
+		else if (c < 0x20)
+			fprintf(out, "\\u%04x", c);
+		else
+			fputc(c, out);
+	}
+	fputc('"', out);
+}
+
+static void
+json_rings(FILE *out, uint64_t *ring_idle, uint64_t periods)
+{
+	int i;
+
+	fprintf(out, "{");
+	for (i = 0; i < sampler.num_rings; i++) {
+		fprintf(out, "%s", i ? ", " : " ");
+		json_string(out, sampler.rings[i].name);
+		fprintf(out, ": { \"busy\": %.1f, \"busy_time\": %.6f }",
+			percent_busy(ring_idle[i], periods),
+			(periods - ring_idle[i]) / (double)sampler.rate);
+	}
+	fprintf(out, " }");
+}
+
+static void
+print_json(FILE *out, char **argv, int exit_status,
+	   struct timeval *elapsed, struct rusage *rusage,
+	   struct phase *total)
+{
+	int i;
+
+	fprintf(out, "{\n  \"command\": [");
+	for (i = 0; argv[i]; i++) {
+		fprintf(out, "%s", i ? ", " : "");
+		json_string(out, argv[i]);
+	}
+	fprintf(out, "],\n");
+	fprintf(out, "  \"exit_status\": %d,\n", exit_status);
+	fprintf(out, "  \"user\": %ld.%06ld,\n  \"sys\": %ld.%06ld,\n"
+		"  \"elapsed\": %ld.%06ld,\n",
+		rusage->ru_utime.tv_sec, rusage->ru_utime.tv_usec,
+		rusage->ru_stime.tv_sec, rusage->ru_stime.tv_usec,
+		elapsed->tv_sec, elapsed->tv_usec);
+	fprintf(out, "  \"samples_per_sec\": %d,\n", sampler.rate);
+	fprintf(out, "  \"gpu\": %.1f,\n",
+		percent_busy(total->gpu_idle, total->periods));
+	fprintf(out, "  \"rings\": ");
+	json_rings(out, total->ring_idle, total->periods);
+	fprintf(out, ",\n  \"phases\": [");
+	for (i = 0; i < num_phases; i++) {
+		struct phase *phase = &phases[i];
+
+		fprintf(out, "%s\n    { \"name\": ", i ? "," : "");
+		json_string(out, phase->name);
+		fprintf(out, ", \"elapsed\": %.6f, \"gpu\": %.1f, \"rings\": ",
+			phase->time / 1e9,
+			percent_busy(phase->gpu_idle, phase->periods));
+		json_rings(out, phase->ring_idle, phase->periods);
+		fprintf(out, " }");
+	}
+	fprintf(out, "\n  ]\n}\n");
+}
+
+static void
+print_rings(uint64_t *ring_idle, uint64_t periods)
+{
+	int i;
+
+	for (i = 0; i < sampler.num_rings; i++)
+		printf(", %s: %.1f%%", sampler.rings[i].name,
+		       percent_busy(ring_idle[i], periods));
+	printf("\n");
 }
 
-static void sighandler(int sig)
+static void usage(const char *appname)
 {
-	goddo = sig;
+	fprintf(stderr,
+		"usage: %s [-s <samples>] [-j <file>] cmd [args...]\n"
+		"\n"
+		"  -s <samples>  samples per second (default %d)\n"
+		"  -j <file>     also write the results as JSON to file, '-' for stdout\n"
+		"\n"
+		"The command can start named phases by writing their name, one per\n"
+		"line, to the FIFO given in $" PHASE_ENV ".\n",
+		appname, SAMPLES_PER_SEC);
 }
 
 int main(int argc, char **argv)
 {
+	struct pci_device *pci_dev;
 	pid_t child;
-	uint64_t ring_idle = 0, ring_time = 0;
 	struct timeval start, end;
 	static struct rusage rusage;
-	int status;
+	struct phase total = { 0 };
+	char fifo_dir[] = "/tmp/intel_gpu_time.XXXXXX", fifo_path[64];
+	const char *json_file = NULL;
+	sigset_t sigchld, sigmask;
+	int i, ch, status, exit_status, fifo, child_events;
+
+	sampler.rate = SAMPLES_PER_SEC;
 
-	intel_get_mmio(intel_get_pci_device());
+	while ((ch = getopt(argc, argv, "+s:j:h")) != -1) {
+		switch (ch) {
+		case 's':
+			sampler.rate = atoi(optarg);
+			if (sampler.rate < 1) {
+				fprintf(stderr, "samples per second must be >= 1\n");
+				return 1;
+			}
+			break;
+		case 'j':
+			json_file = optarg;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
 
-	if (argc == 1) {
-		fprintf(stderr, "usage: %s cmd [args...]\n", argv[0]);
+	if (optind == argc) {
+		usage(argv[0]);
 		return 1;
 	}
 
-	signal(SIGCHLD, sighandler);
-	signal(SIGINT, SIG_IGN);
-	signal(SIGQUIT, SIG_IGN);
+	pci_dev = intel_get_pci_device();
+	intel_get_mmio(pci_dev);
+
+	if (mkdtemp(fifo_dir) == NULL) {
+		perror("mkdtemp");
+		return 1;
+	}
+	snprintf(fifo_path, sizeof(fifo_path), "%s/phase", fifo_dir);
+	if (mkfifo(fifo_path, 0600)) {
+		perror("mkfifo");
+		return 1;
+	}
+	/* opened for writing too, so that we don't see EOF between writers */
+	fifo = open(fifo_path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (fifo < 0) {
+		perror(fifo_path);
+		return 1;
+	}
+	setenv(PHASE_ENV, fifo_path, 1);
+
+	/* blocked before the sampler thread inherits the mask, so that
+	 * SIGCHLD stays pending for the signalfd */
+	sigemptyset(&sigchld);
+	sigaddset(&sigchld, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &sigchld, &sigmask);
+
+	enter_phase("default");
+	intel_sampler_start(&sampler, pci_dev->device_id);
 
 	gettimeofday(&start, NULL);
-	child = spawn(argv+1);
+	child = spawn(argv + optind, &sigmask);
 	if (child < 0)
 		return 127;
 
-	while (!goddo) {
-		uint32_t ring_head, ring_tail;
+	signal(SIGINT, SIG_IGN);
+	signal(SIGQUIT, SIG_IGN);
+
+	child_events = child_fd(child, &sigchld);
+	if (child_events < 0) {
+		perror("child_fd");
+		return 1;
+	}
+
+	for (;;) {
+		struct pollfd pfd[2] = {
+			{ .fd = child_events, .events = POLLIN },
+			{ .fd = fifo, .events = POLLIN },
+		};
 
-		ring_head = INREG(LP_RING + RING_HEAD) & HEAD_ADDR;
-		ring_tail = INREG(LP_RING + RING_TAIL) & TAIL_ADDR;
+		if (poll(pfd, 2, 1000 / DRAIN_PER_SEC) < 0 && errno != EINTR) {
+			perror("poll");
+			return 1;
+		}
 
-		if (ring_tail == ring_head)
-			ring_idle++;
-		ring_time++;
+		if (pfd[1].revents & POLLIN)
+			read_phases(fifo);
 
-		usleep(1000000 / SAMPLES_PER_SEC);
+		intel_sampler_drain(&sampler, account_sample, NULL);
+
+		if (pfd[0].revents & POLLIN) {
+			struct signalfd_siginfo info;
+
+			/* a signalfd has to be read for the next event */
+			while (read(child_events, &info, sizeof(info)) > 0)
+				;
+			if (waitpid(child, &status, WNOHANG) == child)
+				break;
+		}
 	}
 	gettimeofday(&end, NULL);
 	timersub(&end, &start, &end);
 
-	waitpid(child, &status, 0);
+	/* close the last phase */
+	read_phases(fifo);
+	enter_phase(phases[current_phase].name);
+	intel_sampler_stop(&sampler);
+
+	close(child_events);
+	close(fifo);
+	unlink(fifo_path);
+	rmdir(fifo_dir);
+
+	if (WIFSIGNALED(status))
+		exit_status = 128 + WTERMSIG(status);
+	else
+		exit_status = WEXITSTATUS(status);
+
+	for (i = 0; i < num_phases; i++) {
+		int j;
+
+		total.periods += phases[i].periods;
+		total.gpu_idle += phases[i].gpu_idle;
+		for (j = 0; j < sampler.num_rings; j++)
+			total.ring_idle[j] += phases[i].ring_idle[j];
+	}
 
 	getrusage(RUSAGE_CHILDREN, &rusage);
-	printf("user: %ld.%06lds, sys: %ld.%06lds, elapsed: %ld.%06lds, CPU: %.1f%%, GPU: %.1f%%\n",
+	printf("user: %ld.%06lds, sys: %ld.%06lds, elapsed: %ld.%06lds, CPU: %.1f%%, GPU: %.1f%%",
 	       rusage.ru_utime.tv_sec, rusage.ru_utime.tv_usec,
 	       rusage.ru_stime.tv_sec, rusage.ru_stime.tv_usec,
 	       end.tv_sec, end.tv_usec,
 	       100*(rusage.ru_utime.tv_sec + 1e-6*rusage.ru_utime.tv_usec + rusage.ru_stime.tv_sec + 1e-6*rusage.ru_stime.tv_usec) / (end.tv_sec + 1e-6*end.tv_usec),
-	       100 - ring_idle * 100. / ring_time);
+	       percent_busy(total.gpu_idle, total.periods));
+	print_rings(total.ring_idle, total.periods);
+
+	/* only worth a breakdown if the command marked phases */
+	for (i = 0; num_phases > 1 && i < num_phases; i++) {
+		printf("%s: elapsed: %.6fs, GPU: %.1f%%", phases[i].name,
+		       phases[i].time / 1e9,
+		       percent_busy(phases[i].gpu_idle, phases[i].periods));
+		print_rings(phases[i].ring_idle, phases[i].periods);
+	}
+
+	if (json_file) {
+		FILE *out = stdout;
+
+		if (strcmp(json_file, "-")) {
+			out = fopen(json_file, "w");
+			if (out == NULL) {
+				perror(json_file);
+				return 1;
+			}
+		}
+		print_json(out, argv + optind, exit_status, &end, &rusage,
+			   &total);
+		if (out != stdout)
+			fclose(out);
+	}
 
-	return WEXITSTATUS(status);
+	return exit_status;
 }
@@ -29,12 +29,25 @@
 
 #include "config.h"
 
+#define _GNU_SOURCE
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
 #include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <netdb.h>
+#include <getopt.h>
+#include <signal.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 #include <string.h>
 #ifdef HAVE_TERMIOS_H
@@ -42,6 +55,9 @@
 #endif
 #include "intel_gpu_tools.h"
 #include "instdone.h"
+#include "intel_ring.h"
+#include "intel_sampler.h"
+#include "intel_gpu_shm.h"
 
 #define  FORCEWAKE	    0xA18C
 #define  FORCEWAKE_ACK	    0x130090
@@ -51,6 +67,12 @@
 
 #define MAX_NUM_TOP_BITS            100
 
+#define MAX_RINGS		INTEL_MAX_RINGS
+
+/* the main thread drains the sample ring this often */
+#define DRAIN_PER_SEC		10
+#define MAX_SAMPLES_PER_SEC	(INTEL_SAMPLER_RING_SIZE * DRAIN_PER_SEC / 2)
+
 #define HAS_STATS_REGS(devid)		IS_965(devid)
 
 struct top_bit {
@@ -59,7 +81,11 @@ struct top_bit {
 } top_bits[MAX_NUM_TOP_BITS];
 struct top_bit *top_bits_sorted[MAX_NUM_TOP_BITS];
 
-static uint32_t instdone, instdone1;
+static uint32_t devid;
+
+static struct intel_sampler sampler = {
+	.cpu = -1,
+};
 
 static const char *bars[] = {
 	" ",
@@ -113,12 +139,20 @@ const char *stats_reg_names[STATS_COUNT] = {
 uint64_t stats[STATS_COUNT];
 uint64_t last_stats[STATS_COUNT];
 
-static unsigned long
-gettime(void)
+static uint64_t
+timespec_to_ns(const struct timespec *ts)
+{
+	return (uint64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+static void
+timespec_add_ns(struct timespec *ts, long ns)
 {
-    struct timeval t;
-    gettimeofday(&t, NULL);
-    return (t.tv_usec + (t.tv_sec * 1000000));
+	ts->tv_nsec += ns;
+	while (ts->tv_nsec >= 1000000000) {
+		ts->tv_nsec -= 1000000000;
+		ts->tv_sec++;
+	}
 }
 
 static int
@@ -137,18 +171,110 @@ top_bits_sort(const void *a, const void *b)
 		return -1;
 }
 
+/*
+ * Busy counts of the instdone bits, kept bit-sliced: plane k holds bit k of
+ * the count of each of the 32 bits of an instdone register. Accounting a
+ * sample is then a ripple-carry add of the whole busy word into the planes,
+ * which takes two steps on average no matter how many units there are.
+ * The planes are flushed into plain counters before they can overflow and
+ * at the end of each interval.
+ */
+#define COUNTER_PLANES		16
+#define COUNTER_MAX		((1 << COUNTER_PLANES) - 1)
+
+static struct {
+	uint32_t planes[2][COUNTER_PLANES];
+	uint32_t mask[2];	/* bits we show, word 1 is INST_DONE_1 */
+	int pending;
+	int counts[2][32];
+} busy;
+
+static int
+instdone_word(const struct instdone_bit *bit)
+{
+	return bit->reg == INST_DONE_1;
+}
+
 static void
-update_idle_bit(struct top_bit *top_bit)
+instdone_counters_init(void)
 {
-	uint32_t reg_val;
+	int i;
 
-	if (top_bit->bit->reg == INST_DONE_1)
-		reg_val = instdone1;
-	else
-		reg_val = instdone;
+	for (i = 0; i < num_instdone_bits; i++)
+		busy.mask[instdone_word(&instdone_bits[i])] |= instdone_bits[i].bit;
+}
+
+static inline void
+planes_add(uint32_t *planes, uint32_t bits)
+{
+	int k;
+
+	for (k = 0; bits; k++) {
+		uint32_t carry = planes[k] & bits;
+
+		planes[k] ^= bits;
+		bits = carry;
+	}
+}
+
+static void
+instdone_counters_flush(void)
+{
+	int w, k;
+
+	for (w = 0; w < 2; w++) {
+		for (k = 0; k < COUNTER_PLANES; k++) {
+			uint32_t plane = busy.planes[w][k];
+
+			while (plane) {
+				busy.counts[w][ffs(plane) - 1] += 1 << k;
+				plane &= plane - 1;
+			}
+			busy.planes[w][k] = 0;
+		}
+	}
+	busy.pending = 0;
+}
+
+static inline void
+instdone_account(const struct intel_sample *sample)
+{
+	/* a unit is busy while its done bit is clear */
+	uint32_t bits0 = ~sample->instdone & busy.mask[0];
+	uint32_t bits1 = ~sample->instdone1 & busy.mask[1];
+
+	/* the few samples taken while idling count for several periods,
+	 * add those straight to the counts */
+	if (sample->weight > 1) {
+		for (; bits0; bits0 &= bits0 - 1)
+			busy.counts[0][ffs(bits0) - 1] += sample->weight;
+		for (; bits1; bits1 &= bits1 - 1)
+			busy.counts[1][ffs(bits1) - 1] += sample->weight;
+		return;
+	}
+
+	planes_add(busy.planes[0], bits0);
+	planes_add(busy.planes[1], bits1);
+
+	if (++busy.pending == COUNTER_MAX)
+		instdone_counters_flush();
+}
+
+/* Move the counts of the last interval into top_bits and start over. */
+static void
+instdone_counters_collect(void)
+{
+	int i;
+
+	instdone_counters_flush();
+
+	for (i = 0; i < num_instdone_bits; i++) {
+		struct instdone_bit *bit = top_bits[i].bit;
+
+		top_bits[i].count = busy.counts[instdone_word(bit)][ffs(bit->bit) - 1];
+	}
 
-	if ((reg_val & top_bit->bit->bit) == 0)
-		top_bit->count++;
+	memset(busy.counts, 0, sizeof(busy.counts));
 }
 
 static void
@@ -162,7 +288,6 @@ print_clock(const char *name, int clock) {
 static int
 print_clock_info(struct pci_device *pci_dev)
 {
-	uint32_t devid = pci_dev->device_id;
 	uint16_t gcfgc;
 
 	if (IS_GM45(devid)) {
@@ -306,55 +431,248 @@ print_percentage_bar(float percent, int cur_line_len)
 	printf("%*s", PERCENTAGE_BAR_END - cur_line_len, "");
 }
 
+/*
+ * Log-linear histogram: values below HIST_SUB each get a bucket, above that
+ * every power of two is split in HIST_SUB linear buckets, so any value is
+ * known to within 1/HIST_SUB (12.5%) with a fixed, small number of buckets.
+ */
+#define HIST_SUB_BITS		3
+#define HIST_SUB		(1 << HIST_SUB_BITS)
+#define HIST_BUCKETS		((32 - HIST_SUB_BITS + 1) << HIST_SUB_BITS)
+
+struct histogram {
+	uint32_t count[HIST_BUCKETS];
+	uint32_t total;
+	uint32_t max;
+};
+
+static int
+hist_bucket(uint32_t value)
+{
+	int shift;
+
+	if (value < HIST_SUB)
+		return value;
+
+	shift = 31 - __builtin_clz(value) - HIST_SUB_BITS;
+	return ((shift + 1) << HIST_SUB_BITS) +
+		((value >> shift) & (HIST_SUB - 1));
+}
+
+/* The largest value that falls in @bucket. */
+static uint32_t
+hist_bucket_max(int bucket)
+{
+	int shift;
+
+	if (bucket < HIST_SUB)
+		return bucket;
+
+	shift = (bucket >> HIST_SUB_BITS) - 1;
+	return (((uint64_t)(HIST_SUB + (bucket & (HIST_SUB - 1))) + 1) << shift) - 1;
+}
+
+static void
+hist_add_n(struct histogram *hist, uint32_t value, uint32_t n)
+{
+	hist->count[hist_bucket(value)] += n;
+	hist->total += n;
+	if (value > hist->max)
+		hist->max = value;
+}
+
+static void
+hist_add(struct histogram *hist, uint32_t value)
+{
+	hist_add_n(hist, value, 1);
+}
+
+static uint32_t
+hist_percentile(const struct histogram *hist, int percentile)
+{
+	uint32_t rank, seen = 0;
+	int i;
+
+	if (!hist->total)
+		return 0;
+
+	rank = ((uint64_t)hist->total * percentile + 99) / 100;
+	for (i = 0; i < HIST_BUCKETS; i++) {
+		seen += hist->count[i];
+		if (seen >= rank)
+			break;
+	}
+
+	return hist_bucket_max(i) < hist->max ? hist_bucket_max(i) : hist->max;
+}
+
+static void
+hist_reset(struct histogram *hist)
+{
+	memset(hist, 0, sizeof(*hist));
+}
+
 struct ring {
 	const char *name;
 	uint32_t mmio;
 	int head, tail, size;
+	uint32_t wait_mask;
 	uint64_t full;
-	int idle;
+	int idle, wait;
+
+	/* the run of busy (or idle) samples the ring is in */
+	bool busy;
+	uint64_t run_start;
+
+	struct histogram busy_runs;	/* in us */
+	struct histogram idle_runs;	/* in us */
+	struct histogram fill;		/* in bytes */
+
+	/* what is shown of the histograms, see ring_summarize() */
+	uint32_t busy_period[INTEL_GPU_SHM_PERCENTILES];
+	uint32_t fill_level[INTEL_GPU_SHM_PERCENTILES];
 };
 
+/* the percentiles shown for each distribution */
+static const int percentiles[INTEL_GPU_SHM_PERCENTILES] = { 50, 90, 99, 100 };
+
 static uint32_t ring_read(struct ring *ring, uint32_t reg)
 {
 	return INREG(ring->mmio + reg);
 }
 
-static void ring_init(struct ring *ring)
+static void ring_init(struct ring *ring, const struct intel_ring_desc *desc)
 {
+	ring->name = desc->name;
+	ring->mmio = desc->mmio;
+	ring->wait_mask = desc->wait_mask;
 	ring->size = (((ring_read(ring, RING_LEN) & RING_NR_PAGES) >> 12) + 1) * 4096;
 }
 
 static void ring_reset(struct ring *ring)
 {
-	ring->idle = ring->full = 0;
+	ring->idle = ring->wait = ring->full = 0;
+	hist_reset(&ring->busy_runs);
+	hist_reset(&ring->idle_runs);
+	hist_reset(&ring->fill);
+}
+
+static uint32_t ring_run_us(struct ring *ring, uint64_t now)
+{
+	uint64_t us = (now - ring->run_start) / 1000;
+
+	return us > UINT32_MAX ? UINT32_MAX : us;
+}
+
+/*
+ * Count the run the ring is still in as if it ended now, so that a ring
+ * that stays busy (or idle) for a whole interval still shows up.
+ */
+static void ring_close_runs(struct ring *ring, uint64_t now)
+{
+	if (!ring->size || !ring->run_start)
+		return;
+
+	hist_add(ring->busy ? &ring->busy_runs : &ring->idle_runs,
+		 ring_run_us(ring, now));
+}
+
+static void ring_summarize(struct ring *ring)
+{
+	int i;
+
+	for (i = 0; i < INTEL_GPU_SHM_PERCENTILES; i++) {
+		ring->busy_period[i] = hist_percentile(&ring->busy_runs,
+						       percentiles[i]);
+		ring->fill_level[i] = hist_percentile(&ring->fill,
+						      percentiles[i]);
+	}
 }
 
-static void ring_sample(struct ring *ring)
+/* the rings of the device, from intel_get_rings(), the rest have size 0 */
+static struct ring rings[MAX_RINGS];
+
+static void ring_sample(struct ring *ring, const struct intel_sample *sample, int i)
 {
+	bool ring_busy;
 	int full;
 
 	if (!ring->size)
 		return;
 
-	ring->head = ring_read(ring, RING_HEAD) & HEAD_ADDR;
-	ring->tail = ring_read(ring, RING_TAIL) & TAIL_ADDR;
-
-	if (ring->tail == ring->head)
-		ring->idle++;
+	ring->head = sample->ring[i].head;
+	ring->tail = sample->ring[i].tail;
+
+	ring_busy = ring->tail != ring->head;
+	if (!ring_busy)
+		ring->idle += sample->weight;
+	if (sample->ring[i].wait)
+		ring->wait += sample->weight;
+
+	if (!ring->run_start) {
+		ring->busy = ring_busy;
+		ring->run_start = sample->time;
+	} else if (ring_busy != ring->busy) {
+		hist_add(ring->busy ? &ring->busy_runs : &ring->idle_runs,
+			 ring_run_us(ring, sample->time));
+		ring->busy = ring_busy;
+		ring->run_start = sample->time;
+	}
 
 	full = ring->tail - ring->head;
 	if (full < 0)
 		full += ring->size;
-	ring->full += full;
+	ring->full += (uint64_t)full * sample->weight;
+	hist_add_n(&ring->fill, full, sample->weight);
+}
+
+/*
+ * The rings -o logs, whether the GPU has them or not. The first four are
+ * the columns it always had, the gen4/5 bitstream ring before the gen6+
+ * one. Vebox and everything else added since come after the stats, so
+ * that scripts reading the old columns still find them.
+ */
+#define LOG_RINGS 5
+#define LOG_OLD_RINGS 4
+static const char *log_ring_names[LOG_RINGS] = {
+	"render", "bitstream", "bitstream", "blitter", "vebox",
+};
+
+static struct ring *find_ring(const char *name)
+{
+	int i;
+
+	for (i = 0; i < MAX_RINGS; i++) {
+		if (rings[i].size && strcmp(rings[i].name, name) == 0)
+			return &rings[i];
+	}
+
+	return NULL;
+}
+
+static struct ring *log_ring(int slot)
+{
+	/* only gen6+, with its own bitstream ring, has a blitter */
+	bool gen6 = find_ring("blitter") != NULL;
+
+	if ((slot == 1 && gen6) || (slot == 2 && !gen6))
+		return NULL;
+
+	return find_ring(log_ring_names[slot]);
 }
 
-static void ring_print_header(FILE *out, struct ring *ring)
+static void ring_print_header(FILE *out, const char *name)
 {
     fprintf(out, "%.6s%%\tops\t",
-            ring->name
+            name
           );
 }
 
+static void ring_print_runs_header(FILE *out, const char *name)
+{
+	fprintf(out, "%.6s-busy99\tbusymx\tfill99\tfillmx\t", name);
+}
+
 static void ring_print(struct ring *ring, unsigned long samples_per_sec)
 {
 	int percent_busy, len;
@@ -370,12 +688,24 @@ static void ring_print(struct ring *ring, unsigned long samples_per_sec)
 		   ring->name,
 		   (int)(ring->full / samples_per_sec),
 		   ring->size);
+	printf("%30s  p50 %uus  p90 %uus  p99 %uus  max %uus",
+	       "busy periods:",
+	       ring->busy_period[0], ring->busy_period[1],
+	       ring->busy_period[2], ring->busy_period[3]);
+	if (ring->wait_mask)
+		printf("  waiting: %d%%",
+		       (int)(100 * ring->wait / samples_per_sec));
+	printf("\n");
+	printf("%30s  p50 %u  p90 %u  p99 %u  max %u\n",
+	       "fill:",
+	       ring->fill_level[0], ring->fill_level[1],
+	       ring->fill_level[2], ring->fill_level[3]);
 }
 
 static void ring_log(struct ring *ring, unsigned long samples_per_sec,
 		FILE *output)
 {
-	if (ring->size)
+	if (ring)
 		fprintf(output, "%3d\t%d\t",
 			(int)(100 - 100 * ring->idle / samples_per_sec),
 			(int)(ring->full / samples_per_sec));
@@ -383,316 +713,1598 @@ static void ring_log(struct ring *ring, unsigned long samples_per_sec,
 		fprintf(output, "-1\t-1\t");
 }
 
-static void
-usage(const char *appname)
+static void ring_log_runs(struct ring *ring, FILE *output)
 {
-	printf("intel_gpu_top - Display a top-like summary of Intel GPU usage\n"
-			"\n"
-			"usage: %s [parameters]\n"
-			"\n"
-			"The following parameters apply:\n"
-			"[-s <samples>]       samples per seconds (default %d)\n"
-			"[-e <command>]       command to profile\n"
-			"[-o <file>]          output statistics to file. If file is '-',"
-			"                     run in batch mode and output statistics to stdio only \n"
-			"[-h]                 show this help screen\n"
-			"\n",
-			appname,
-			SAMPLES_PER_SEC
-		  );
-	return;
+	if (ring)
+		fprintf(output, "%u\t%u\t%u\t%u\t",
+			ring->busy_period[2], ring->busy_period[3],
+			ring->fill_level[2], ring->fill_level[3]);
+	else
+		fprintf(output, "-1\t-1\t-1\t-1\t");
 }
 
-int main(int argc, char **argv)
-{
-	uint32_t devid;
-	struct pci_device *pci_dev;
-	struct ring render_ring = {
-		.name = "render",
-		.mmio = 0x2030,
-	}, bsd_ring = {
-		.name = "bitstream",
-		.mmio = 0x4030,
-	}, bsd6_ring = {
-		.name = "bitstream",
-		.mmio = 0x12030,
-	}, blt_ring = {
-		.name = "blitter",
-		.mmio = 0x22030,
-	};
-	int i, ch;
-	int samples_per_sec = SAMPLES_PER_SEC;
-	FILE *output = NULL;
-	double elapsed_time=0;
-	int print_headers=1;
-	pid_t child_pid=-1;
-	int child_stat;
-	char *cmd=NULL;
-	int interactive=1;
+/* Sampling health over the last interval, shown along with the results. */
+struct sample_stats {
+	uint32_t *lateness;
+	int count, size;
+	int periods;		/* sampling periods covered by the samples */
+	int busy;		/* periods with work queued on any ring */
+	uint64_t last;		/* time of the last sample */
 
-	/* Parse options? */
-	while ((ch = getopt(argc, argv, "s:o:e:h")) != -1) {
-		switch (ch) {
-		case 'e': cmd = strdup(optarg);
-			break;
-		case 's': samples_per_sec = atoi(optarg);
-			if (samples_per_sec < 100) {
-				fprintf(stderr, "Error: samples per second must be >= 100\n");
-				exit(1);
-			}
-			break;
-		case 'o':
-			if (!strcmp(optarg, "-")) {
-				/* Running in non-interactive mode */
-				interactive = 0;
-				output = stdout;
-			}
-			else
-				output = fopen(optarg, "w");
-			if (!output)
-			{
-				perror("fopen");
-				exit(1);
-			}
-			break;
-		case 'h':
-			usage(argv[0]);
-			exit(0);
-			break;
-		default:
-			fprintf(stderr, "Invalid flag %c!\n", (char)optopt);
-			usage(argv[0]);
-			exit(1);
-			break;
-		}
-	}
+	uint32_t jitter[INTEL_GPU_SHM_PERCENTILES];	/* of the lateness */
+};
 
-	pci_dev = intel_get_pci_device();
-	devid = pci_dev->device_id;
-	intel_get_mmio(pci_dev);
-	init_instdone_definitions(devid);
+static struct sample_stats sample_stats;
 
-	/* Do we have a command to run? */
-	if (cmd != NULL) {
-		if (output) {
-			fprintf(output, "# Profiling: %s\n", cmd);
-			fflush(output);
-		}
-		child_pid = fork();
-		if (child_pid < 0) {
-			perror("fork");
-			exit(1);
-		}
-		else if (child_pid == 0) {
-			int res;
-			res = system(cmd);
-			if (res < 0)
-				perror("running command");
-			if (output) {
-				fflush(output);
-				fprintf(output, "# %s exited with status %d\n", cmd, res);
-				fflush(output);
-			}
-			free(cmd);
-			exit(0);
-		} else {
-			free(cmd);
-		}
-	}
+static int
+lateness_cmp(const void *a, const void *b)
+{
+	uint32_t la = *(const uint32_t *)a, lb = *(const uint32_t *)b;
 
-	for (i = 0; i < num_instdone_bits; i++) {
-		top_bits[i].bit = &instdone_bits[i];
-		top_bits[i].count = 0;
-		top_bits_sorted[i] = &top_bits[i];
-	}
+	return la < lb ? -1 : la > lb;
+}
 
-	/* Grab access to the registers */
-	intel_register_access_init(pci_dev, 0);
+static uint32_t
+lateness_percentile(struct sample_stats *ss, int percentile)
+{
+	int i;
 
-	ring_init(&render_ring);
-	if (IS_GEN4(devid) || IS_GEN5(devid))
-		ring_init(&bsd_ring);
-	if (IS_GEN6(devid) || IS_GEN7(devid)) {
-		ring_init(&bsd6_ring);
-		ring_init(&blt_ring);
-	}
+	if (!ss->count)
+		return 0;
 
-	/* Initialize GPU stats */
-	if (HAS_STATS_REGS(devid)) {
-		for (i = 0; i < STATS_COUNT; i++) {
-			uint32_t stats_high, stats_low, stats_high_2;
+	i = (ss->count - 1) * percentile / 100;
+	return ss->lateness[i];
+}
 
-			do {
-				stats_high = INREG(stats_regs[i] + 4);
-				stats_low = INREG(stats_regs[i]);
-				stats_high_2 = INREG(stats_regs[i] + 4);
-			} while (stats_high != stats_high_2);
+static void
+sample_stats_summarize(struct sample_stats *ss)
+{
+	int i;
 
-			last_stats[i] = (uint64_t)stats_high << 32 |
-				stats_low;
-		}
-	}
+	qsort(ss->lateness, ss->count, sizeof(*ss->lateness),
+	      lateness_cmp);
 
-	for (;;) {
-		int j;
-		unsigned long long t1, ti, tf, t2;
-		unsigned long long def_sleep = 1000000 / samples_per_sec;
-		unsigned long long last_samples_per_sec = samples_per_sec;
-		unsigned short int max_lines;
-		struct winsize ws;
-		char clear_screen[] = {0x1b, '[', 'H',
-				       0x1b, '[', 'J',
-				       0x0};
-		int percent;
-		int len;
-
-		t1 = gettime();
-
-		ring_reset(&render_ring);
-		ring_reset(&bsd_ring);
-		ring_reset(&bsd6_ring);
-		ring_reset(&blt_ring);
-
-		for (i = 0; i < samples_per_sec; i++) {
-			long long interval;
-			ti = gettime();
-			if (IS_965(devid)) {
-				instdone = INREG(INST_DONE_I965);
-				instdone1 = INREG(INST_DONE_1);
-			} else
-				instdone = INREG(INST_DONE);
-
-			for (j = 0; j < num_instdone_bits; j++)
-				update_idle_bit(&top_bits[j]);
-
-			ring_sample(&render_ring);
-			ring_sample(&bsd_ring);
-			ring_sample(&bsd6_ring);
-			ring_sample(&blt_ring);
-
-			tf = gettime();
-			if (tf - t1 >= 1000000) {
-				/* We are out of sync, bail out */
-				last_samples_per_sec = i+1;
-				break;
-			}
-			interval = def_sleep - (tf - ti);
-			if (interval > 0)
-				usleep(interval);
-		}
+	for (i = 0; i < INTEL_GPU_SHM_PERCENTILES; i++)
+		ss->jitter[i] = lateness_percentile(ss, percentiles[i]);
+}
 
-		if (HAS_STATS_REGS(devid)) {
-			for (i = 0; i < STATS_COUNT; i++) {
-				uint32_t stats_high, stats_low, stats_high_2;
+static void
+print_sample_stats(struct sample_stats *ss, double seconds,
+		   unsigned long dropped)
+{
+	printf("%25s: %d/s (%d/s requested", "sampling",
+	       (int)(ss->count / seconds + .5), sampler.rate);
+	if (sampler.idle_rate)
+		printf(", %d/s when idle", sampler.idle_rate);
+	printf("), %lu dropped\n", dropped);
+	printf("%25s: p50 %uus  p90 %uus  p99 %uus  max %uus\n",
+	       "jitter",
+	       ss->jitter[0] / 1000, ss->jitter[1] / 1000,
+	       ss->jitter[2] / 1000, ss->jitter[3] / 1000);
+}
 
-				do {
-					stats_high = INREG(stats_regs[i] + 4);
-					stats_low = INREG(stats_regs[i]);
-					stats_high_2 = INREG(stats_regs[i] + 4);
-				} while (stats_high != stats_high_2);
+/*
+ * Frequency and RC6 residency, from the sysfs directory of the card (-S).
+ * Reading sysfs is far slower than MMIO, so the current frequency is only
+ * read each time the samples are drained, and applies to the busy periods
+ * drained then; the rest is read once per interval.
+ */
+static struct {
+	const char *root;	/* NULL if there is nothing to show */
+	bool have_freq, have_rc6;
+
+	int cur, min, max, rp0;	/* MHz */
+	uint64_t busy_mhz;	/* busy periods times the frequency */
+	int busy_drained;	/* busy periods already weighted */
+
+	uint64_t rc6[3], last_rc6[3];	/* rc6, rc6p, rc6pp residency, ms */
+} gt;
+
+static const char *gt_rc6_states[3] = { "rc6", "rc6p", "rc6pp" };
+static const char *gt_rc6_files[3] = {
+	"power/rc6_residency_ms",
+	"power/rc6p_residency_ms",
+	"power/rc6pp_residency_ms",
+};
 
-				stats[i] = (uint64_t)stats_high << 32 |
-					stats_low;
-			}
+static bool
+gt_read(const char *file, uint64_t *value)
+{
+	char path[PATH_MAX], buf[32];
+	int fd, len;
+
+	snprintf(path, sizeof(path), "%s/%s", gt.root, file);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (len <= 0)
+		return false;
+
+	buf[len] = '\0';
+	*value = strtoull(buf, NULL, 0);
+	return true;
+}
+
+static int
+gt_read_mhz(const char *name)
+{
+	char file[32];
+	uint64_t mhz;
+
+	snprintf(file, sizeof(file), "gt_%s_freq_mhz", name);
+	return gt_read(file, &mhz) ? mhz : 0;
+}
+
+static void
+gt_read_rc6(uint64_t *rc6)
+{
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		rc6[i] = 0;
+		gt_read(gt_rc6_files[i], &rc6[i]);
+	}
+}
+
+/* Use @root, or the first card that has the files when it is NULL. */
+static void
+gt_init(const char *root)
+{
+	static char card[64];
+	uint64_t value;
+	int i;
+
+	for (i = 0; root == NULL && i < 16; i++) {
+		snprintf(card, sizeof(card), "/sys/class/drm/card%d", i);
+		gt.root = card;
+		if (gt_read("gt_cur_freq_mhz", &value) ||
+		    gt_read(gt_rc6_files[0], &value))
+			root = card;
+	}
+
+	gt.root = root;
+	if (root == NULL)
+		return;
+
+	gt.have_freq = gt_read("gt_cur_freq_mhz", &value);
+	gt.have_rc6 = gt_read(gt_rc6_files[0], &value);
+	if (!gt.have_freq && !gt.have_rc6) {
+		gt.root = NULL;
+		return;
+	}
+
+	gt_read_rc6(gt.last_rc6);
+}
+
+/* Weight the busy periods drained since the last call by the frequency. */
+static void
+gt_sample_freq(void)
+{
+	if (!gt.root || !gt.have_freq)
+		return;
+
+	gt.cur = gt_read_mhz("cur");
+	gt.busy_mhz += (uint64_t)(sample_stats.busy - gt.busy_drained) * gt.cur;
+	gt.busy_drained = sample_stats.busy;
+}
+
+static void
+gt_update(void)
+{
+	if (!gt.root)
+		return;
+
+	if (gt.have_freq) {
+		gt_sample_freq();
+		gt.min = gt_read_mhz("min");
+		gt.max = gt_read_mhz("max");
+		gt.rp0 = gt_read_mhz("RP0");
+	}
+	if (gt.have_rc6)
+		gt_read_rc6(gt.rc6);
+}
+
+static void
+gt_reset(void)
+{
+	gt.busy_mhz = 0;
+	gt.busy_drained = 0;
+	memcpy(gt.last_rc6, gt.rc6, sizeof(gt.rc6));
+}
+
+/* Percentage of the work the GPU could have done at its top frequency. */
+static double
+gt_effective(int n)
+{
+	int top = gt.rp0 ? gt.rp0 : gt.max;
+
+	return top ? 100. * gt.busy_mhz / ((uint64_t)n * top) : 0;
+}
+
+static double
+gt_rc6_percent(int i, double interval)
+{
+	return (gt.rc6[i] - gt.last_rc6[i]) / (interval * 10);
+}
+
+static void
+print_gt_info(int n, double interval)
+{
+	if (gt.have_freq)
+		printf("%25s: %d MHz (min %d, max %d, RP0 %d), "
+		       "effective busy: %.1f%%\n", "frequency",
+		       gt.cur, gt.min, gt.max, gt.rp0, gt_effective(n));
+	if (gt.have_rc6)
+		printf("%25s: %s %.1f%%  %s %.1f%%  %s %.1f%%\n",
+		       "residency",
+		       gt_rc6_states[0], gt_rc6_percent(0, interval),
+		       gt_rc6_states[1], gt_rc6_percent(1, interval),
+		       gt_rc6_states[2], gt_rc6_percent(2, interval));
+}
+
+/* Add one raw sample to the statistics of the current interval. */
+static void
+account_sample(const struct intel_sample *sample)
+{
+	int i;
+
+	instdone_account(sample);
+
+	for (i = 0; i < MAX_RINGS; i++)
+		ring_sample(&rings[i], sample, i);
+
+	for (i = 0; i < MAX_RINGS; i++) {
+		if (rings[i].size &&
+		    sample->ring[i].head != sample->ring[i].tail) {
+			sample_stats.busy += sample->weight;
+			break;
+		}
+	}
+
+	if (sample_stats.count == sample_stats.size) {
+		sample_stats.size = sample_stats.size * 2 + 4096;
+		sample_stats.lateness = realloc(sample_stats.lateness,
+						sample_stats.size * sizeof(uint32_t));
+		if (sample_stats.lateness == NULL)
+			err(1, "failed to allocate sample statistics");
+	}
+	sample_stats.lateness[sample_stats.count++] = sample->lateness;
+	sample_stats.periods += sample->weight;
+	sample_stats.last = sample->time;
+}
+
+static void
+read_stats(uint64_t *counters)
+{
+	int i;
+
+	for (i = 0; i < STATS_COUNT; i++) {
+		uint32_t stats_high, stats_low, stats_high_2;
+
+		do {
+			stats_high = INREG(stats_regs[i] + 4);
+			stats_low = INREG(stats_regs[i]);
+			stats_high_2 = INREG(stats_regs[i] + 4);
+		} while (stats_high != stats_high_2);
+
+		counters[i] = (uint64_t)stats_high << 32 | stats_low;
+	}
+}
+
+/*
+ * Binary trace of every raw sample, for looking at a run again later, at
+ * any aggregation window, with intel_gpu_top -i. The file starts with a
+ * struct trace_header, followed by records made of a one byte tag and its
+ * payload, all in host byte order:
+ *
+ *   TRACE_SAMPLE: u64 time (ns), u32 lateness (ns), u32 weight,
+ *                 u32 instdone, u32 instdone1, then u32 head, u32 tail,
+ *                 u32 wait for each ring whose size in the header isn't 0,
+ *                 in the order of intel_get_rings()
+ *   TRACE_STATS:  u64 time (ns), u64 dropped samples, u64 stats[STATS_COUNT]
+ *
+ * Records are collected in buffers that a background thread writes out, so
+ * a slow disk never holds up the accounting.
+ */
+#define TRACE_MAGIC		"GPUTOPTR"
+#define TRACE_VERSION		1
+#define TRACE_BUFFER_SIZE	(1 << 20)
+
+enum trace_tag {
+	TRACE_SAMPLE = 1,
+	TRACE_STATS,
+};
+
+struct trace_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t devid;
+	uint32_t rate;
+	uint32_t ring_size[MAX_RINGS];
+};
+
+struct trace_buffer {
+	struct trace_buffer *next;
+	size_t len;
+	char data[TRACE_BUFFER_SIZE];
+};
+
+static struct {
+	FILE *file;
+	const char *name;
+	struct trace_buffer *current;
+	struct trace_buffer *queue, **queue_tail;
+	struct trace_buffer *free_list;
+	bool done;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_t thread;
+} trace;
+
+static void *
+trace_writer(void *arg)
+{
+	pthread_mutex_lock(&trace.lock);
+	for (;;) {
+		struct trace_buffer *buf = trace.queue;
+
+		if (buf == NULL) {
+			if (trace.done)
+				break;
+			pthread_cond_wait(&trace.cond, &trace.lock);
+			continue;
+		}
+
+		trace.queue = buf->next;
+		if (trace.queue == NULL)
+			trace.queue_tail = &trace.queue;
+		pthread_mutex_unlock(&trace.lock);
+
+		if (fwrite(buf->data, 1, buf->len, trace.file) != buf->len)
+			err(1, "failed to write %s", trace.name);
+
+		pthread_mutex_lock(&trace.lock);
+		buf->next = trace.free_list;
+		trace.free_list = buf;
+	}
+	pthread_mutex_unlock(&trace.lock);
+
+	return NULL;
+}
+
+/* Hand the current buffer to the writer and get an empty one. */
+static void
+trace_submit(void)
+{
+	struct trace_buffer *buf;
+
+	pthread_mutex_lock(&trace.lock);
+	if (trace.current) {
+		trace.current->next = NULL;
+		*trace.queue_tail = trace.current;
+		trace.queue_tail = &trace.current->next;
+		pthread_cond_signal(&trace.cond);
+	}
+
+	buf = trace.free_list;
+	if (buf)
+		trace.free_list = buf->next;
+	pthread_mutex_unlock(&trace.lock);
+
+	if (buf == NULL) {
+		buf = malloc(sizeof(*buf));
+		if (buf == NULL)
+			err(1, "failed to allocate trace buffer");
+	}
+	buf->len = 0;
+	trace.current = buf;
+}
+
+static void
+trace_append(const void *data, size_t len)
+{
+	if (trace.current->len + len > TRACE_BUFFER_SIZE)
+		trace_submit();
+
+	memcpy(trace.current->data + trace.current->len, data, len);
+	trace.current->len += len;
+}
+
+static void
+trace_open(const char *name)
+{
+	struct trace_header header = {
+		.magic = TRACE_MAGIC,
+		.version = TRACE_VERSION,
+		.devid = devid,
+		.rate = sampler.rate,
+	};
+	int i;
+
+	trace.name = name;
+	trace.file = fopen(name, "w");
+	if (trace.file == NULL)
+		err(1, "failed to open %s", name);
+
+	trace.queue_tail = &trace.queue;
+	pthread_mutex_init(&trace.lock, NULL);
+	pthread_cond_init(&trace.cond, NULL);
+	if (pthread_create(&trace.thread, NULL, trace_writer, NULL))
+		errx(1, "failed to create trace writer thread");
+
+	trace_submit();
+
+	for (i = 0; i < MAX_RINGS; i++)
+		header.ring_size[i] = rings[i].size;
+	trace_append(&header, sizeof(header));
+}
+
+static void
+trace_close(void)
+{
+	trace_submit();
+
+	pthread_mutex_lock(&trace.lock);
+	trace.done = true;
+	pthread_cond_signal(&trace.cond);
+	pthread_mutex_unlock(&trace.lock);
+
+	pthread_join(trace.thread, NULL);
+	fclose(trace.file);
+
+	free(trace.current);
+	while (trace.free_list) {
+		struct trace_buffer *buf = trace.free_list;
+
+		trace.free_list = buf->next;
+		free(buf);
+	}
+}
+
+static void
+trace_record_sample(const struct intel_sample *sample)
+{
+	char record[1 + 8 + 4 * 4 + MAX_RINGS * 3 * 4], *p = record;
+	int i;
+
+	*p++ = TRACE_SAMPLE;
+	memcpy(p, &sample->time, 8); p += 8;
+	memcpy(p, &sample->lateness, 4); p += 4;
+	memcpy(p, &sample->weight, 4); p += 4;
+	memcpy(p, &sample->instdone, 4); p += 4;
+	memcpy(p, &sample->instdone1, 4); p += 4;
+	for (i = 0; i < MAX_RINGS; i++) {
+		if (!rings[i].size)
+			continue;
+		memcpy(p, &sample->ring[i], 12);
+		p += 12;
+	}
+
+	trace_append(record, p - record);
+}
+
+static void
+trace_record_stats(uint64_t time, uint64_t dropped)
+{
+	char record[1 + 8 + 8 + STATS_COUNT * 8], *p = record;
+
+	*p++ = TRACE_STATS;
+	memcpy(p, &time, 8); p += 8;
+	memcpy(p, &dropped, 8); p += 8;
+	memcpy(p, stats, sizeof(stats));
+
+	trace_append(record, sizeof(record));
+}
+
+/*
+ * OpenMetrics exporter, for -m. Once per interval the main thread formats
+ * the aggregates it just computed into a text exposition, and a server
+ * thread hands out the latest one to every client that connects, so a
+ * scrape never touches the hardware nor waits for the next interval.
+ */
+#define METRICS_CONTENT_TYPE \
+	"application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+static struct {
+	int fd;
+	char *path;		/* unix socket to remove on exit */
+
+	unsigned long long samples, dropped;
+
+	pthread_mutex_t lock;
+	char *text;
+	size_t len;
+	pthread_t thread;
+} metrics = {
+	.fd = -1,
+};
+
+static bool
+metrics_unit_seen(int i)
+{
+	int j;
+
+	for (j = 0; j < i; j++) {
+		if (!strcmp(top_bits[j].bit->name, top_bits[i].bit->name))
+			return true;
+	}
+
+	return false;
+}
+
+static void
+metrics_update(double interval, int n, unsigned long dropped)
+{
+	char *text;
+	size_t len;
+	FILE *out;
+	int i;
+
+	metrics.samples += sample_stats.count;
+	metrics.dropped += dropped;
+
+	out = open_memstream(&text, &len);
+	if (out == NULL)
+		err(1, "failed to format metrics");
+
+	fprintf(out, "# TYPE intel_gpu_ring_busy_ratio gauge\n"
+		"# HELP intel_gpu_ring_busy_ratio Fraction of the samples the ring wasn't empty.\n");
+	for (i = 0; i < MAX_RINGS; i++) {
+		if (rings[i].size)
+			fprintf(out, "intel_gpu_ring_busy_ratio{ring=\"%s\"} %.4f\n",
+				rings[i].name, 1 - (double)rings[i].idle / n);
+	}
+
+	fprintf(out, "# TYPE intel_gpu_ring_wait_ratio gauge\n"
+		"# HELP intel_gpu_ring_wait_ratio Fraction of the samples the ring was waiting on an event or semaphore.\n");
+	for (i = 0; i < MAX_RINGS; i++) {
+		if (rings[i].size && rings[i].wait_mask)
+			fprintf(out, "intel_gpu_ring_wait_ratio{ring=\"%s\"} %.4f\n",
+				rings[i].name, (double)rings[i].wait / n);
+	}
+
+	fprintf(out, "# TYPE intel_gpu_ring_fill_bytes gauge\n"
+		"# UNIT intel_gpu_ring_fill_bytes bytes\n"
+		"# HELP intel_gpu_ring_fill_bytes Average number of bytes queued in the ring.\n");
+	for (i = 0; i < MAX_RINGS; i++) {
+		if (rings[i].size)
+			fprintf(out, "intel_gpu_ring_fill_bytes{ring=\"%s\"} %llu\n",
+				rings[i].name,
+				(unsigned long long)(rings[i].full / n));
+	}
+
+	fprintf(out, "# TYPE intel_gpu_ring_size_bytes gauge\n"
+		"# UNIT intel_gpu_ring_size_bytes bytes\n"
+		"# HELP intel_gpu_ring_size_bytes Size of the ring.\n");
+	for (i = 0; i < MAX_RINGS; i++) {
+		if (rings[i].size)
+			fprintf(out, "intel_gpu_ring_size_bytes{ring=\"%s\"} %d\n",
+				rings[i].name, rings[i].size);
+	}
+
+	/* a few gen4 units have two INSTDONE bits under the same name,
+	 * only export the first one so that the series stay unique */
+	fprintf(out, "# TYPE intel_gpu_unit_busy_ratio gauge\n"
+		"# HELP intel_gpu_unit_busy_ratio Fraction of the samples INSTDONE showed the unit busy.\n");
+	for (i = 0; i < num_instdone_bits; i++) {
+		if (!metrics_unit_seen(i))
+			fprintf(out, "intel_gpu_unit_busy_ratio{unit=\"%s\"} %.4f\n",
+				top_bits[i].bit->name,
+				(double)top_bits[i].count / n);
+	}
+
+	if (HAS_STATS_REGS(devid)) {
+		fprintf(out, "# TYPE intel_gpu_pipeline_statistics counter\n"
+			"# HELP intel_gpu_pipeline_statistics 3D pipeline statistics counters.\n");
+		for (i = 0; i < STATS_COUNT; i++)
+			fprintf(out, "intel_gpu_pipeline_statistics_total{counter=\"%s\"} %llu\n",
+				stats_reg_names[i], (unsigned long long)stats[i]);
+	}
+
+	if (gt.have_freq)
+		fprintf(out, "# TYPE intel_gpu_frequency_mhz gauge\n"
+			"# HELP intel_gpu_frequency_mhz Current GPU frequency.\n"
+			"intel_gpu_frequency_mhz %d\n"
+			"# TYPE intel_gpu_effective_busy_ratio gauge\n"
+			"# HELP intel_gpu_effective_busy_ratio Busy time weighted by frequency over the top frequency.\n"
+			"intel_gpu_effective_busy_ratio %.4f\n",
+			gt.cur, gt_effective(n) / 100);
+	if (gt.have_rc6) {
+		fprintf(out, "# TYPE intel_gpu_rc6_residency_ratio gauge\n"
+			"# HELP intel_gpu_rc6_residency_ratio Fraction of the interval spent in each RC6 state.\n");
+		for (i = 0; i < 3; i++)
+			fprintf(out, "intel_gpu_rc6_residency_ratio{state=\"%s\"} %.4f\n",
+				gt_rc6_states[i],
+				gt_rc6_percent(i, interval) / 100);
+	}
+
+	fprintf(out, "# TYPE intel_gpu_interval_seconds gauge\n"
+		"# UNIT intel_gpu_interval_seconds seconds\n"
+		"# HELP intel_gpu_interval_seconds Length of the interval the gauges cover.\n"
+		"intel_gpu_interval_seconds %.3f\n"
+		"# TYPE intel_gpu_samples counter\n"
+		"# HELP intel_gpu_samples Samples taken.\n"
+		"intel_gpu_samples_total %llu\n"
+		"# TYPE intel_gpu_samples_dropped counter\n"
+		"# HELP intel_gpu_samples_dropped Samples lost because they weren't processed in time.\n"
+		"intel_gpu_samples_dropped_total %llu\n"
+		"# EOF\n",
+		interval, metrics.samples, metrics.dropped);
+
+	if (fclose(out))
+		err(1, "failed to format metrics");
+
+	pthread_mutex_lock(&metrics.lock);
+	free(metrics.text);
+	metrics.text = text;
+	metrics.len = len;
+	pthread_mutex_unlock(&metrics.lock);
+}
+
+static void
+metrics_send(int fd, const char *data, size_t len)
+{
+	while (len) {
+		ssize_t ret = send(fd, data, len, MSG_NOSIGNAL);
+
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return;
+
+		data += ret;
+		len -= ret;
+	}
+}
+
+/* Answer one HTTP request with the current exposition. */
+static void
+metrics_serve(int fd)
+{
+	struct timeval timeout = { .tv_sec = 1 };
+	char request[4096], header[256], *text;
+	size_t count = 0, len;
+	bool found;
+
+	/* don't let a stuck client hold up everybody else */
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	while (count < sizeof(request) - 1) {
+		ssize_t ret = recv(fd, request + count,
+				   sizeof(request) - 1 - count, 0);
+
+		if (ret <= 0)
+			break;
+		count += ret;
+		request[count] = '\0';
+		if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n"))
+			break;
+	}
+	request[count] = '\0';
+
+	found = !strncmp(request, "GET / ", 6) ||
+		!strncmp(request, "GET /metrics ", 13);
+	if (!found) {
+		len = snprintf(header, sizeof(header),
+			       "HTTP/1.0 404 Not Found\r\n"
+			       "Content-Length: 0\r\n"
+			       "Connection: close\r\n\r\n");
+		metrics_send(fd, header, len);
+		return;
+	}
+
+	pthread_mutex_lock(&metrics.lock);
+	len = metrics.len;
+	text = malloc(len);
+	if (text)
+		memcpy(text, metrics.text, len);
+	pthread_mutex_unlock(&metrics.lock);
+	if (text == NULL)
+		return;
+
+	count = snprintf(header, sizeof(header),
+			 "HTTP/1.0 200 OK\r\n"
+			 "Content-Type: " METRICS_CONTENT_TYPE "\r\n"
+			 "Content-Length: %zu\r\n"
+			 "Connection: close\r\n\r\n", len);
+	metrics_send(fd, header, count);
+	metrics_send(fd, text, len);
+	free(text);
+}
+
+static void *
+metrics_thread(void *arg)
+{
+	for (;;) {
+		int fd = accept(metrics.fd, NULL, NULL);
+
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			break;
+		}
+
+		metrics_serve(fd);
+		close(fd);
+	}
+
+	return NULL;
+}
+
+/*
+ * Listen on @endpoint, either the path of a unix socket (anything with a
+ * '/' in it) or a TCP [host:]port, on the loopback interface by default.
+ */
+static void
+metrics_open(const char *endpoint)
+{
+	static const char empty[] = "# EOF\n";
+	int one = 1;
+
+	if (strchr(endpoint, '/')) {
+		struct sockaddr_un addr = { .sun_family = AF_UNIX };
+		struct stat st;
+
+		if (strlen(endpoint) >= sizeof(addr.sun_path))
+			errx(1, "socket path too long: %s", endpoint);
+		strcpy(addr.sun_path, endpoint);
+
+		/* replace a socket left behind by a previous run */
+		if (stat(endpoint, &st) == 0 && S_ISSOCK(st.st_mode))
+			unlink(endpoint);
+
+		metrics.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (metrics.fd < 0 ||
+		    bind(metrics.fd, (struct sockaddr *)&addr, sizeof(addr)))
+			err(1, "failed to bind %s", endpoint);
+		metrics.path = strdup(endpoint);
+	} else {
+		struct addrinfo hints = {
+			.ai_family = AF_UNSPEC,
+			.ai_socktype = SOCK_STREAM,
+		};
+		struct addrinfo *ai;
+		const char *host = "localhost", *port = endpoint;
+		char *colon, *copy = strdup(endpoint);
+		int ret;
+
+		colon = strrchr(copy, ':');
+		if (colon) {
+			*colon = '\0';
+			host = copy;
+			port = colon + 1;
 		}
 
-		qsort(top_bits_sorted, num_instdone_bits,
-		      sizeof(struct top_bit *), top_bits_sort);
+		ret = getaddrinfo(host, port, &hints, &ai);
+		if (ret)
+			errx(1, "%s: %s", endpoint, gai_strerror(ret));
+
+		metrics.fd = socket(ai->ai_family, ai->ai_socktype,
+				    ai->ai_protocol);
+		if (metrics.fd < 0)
+			err(1, "failed to create socket");
+		setsockopt(metrics.fd, SOL_SOCKET, SO_REUSEADDR,
+			   &one, sizeof(one));
+		if (bind(metrics.fd, ai->ai_addr, ai->ai_addrlen))
+			err(1, "failed to bind %s", endpoint);
+
+		freeaddrinfo(ai);
+		free(copy);
+	}
+
+	if (listen(metrics.fd, 16))
+		err(1, "failed to listen on %s", endpoint);
+
+	/* until the first interval is over there is nothing to report */
+	metrics.text = strdup(empty);
+	metrics.len = strlen(empty);
+	pthread_mutex_init(&metrics.lock, NULL);
+
+	if (pthread_create(&metrics.thread, NULL, metrics_thread, NULL))
+		errx(1, "failed to create metrics thread");
+}
+
+static void
+metrics_close(void)
+{
+	shutdown(metrics.fd, SHUT_RDWR);
+	pthread_join(metrics.thread, NULL);
+	close(metrics.fd);
+
+	if (metrics.path) {
+		unlink(metrics.path);
+		free(metrics.path);
+	}
+	free(metrics.text);
+}
+
+/*
+ * Shared memory publication, for -P, see intel_gpu_shm.h. The latest
+ * sample goes out each time the samples are drained and the aggregates at
+ * the end of each interval, in the form report_interval() shows them, so
+ * that intel_gpu_top -A can show them again.
+ */
+static struct {
+	const char *name;
+	struct intel_gpu_shm *shm;
+	struct intel_sample latest;
+	bool have_latest;
+} publish;
+
+static void
+publish_open(const char *name)
+{
+	publish.name = name;
+	publish.shm = intel_gpu_shm_create(name);
+	publish.shm->devid = devid;
+	publish.shm->rate = sampler.rate;
+	publish.shm->idle_rate = sampler.idle_rate;
+}
+
+static void
+publish_sample(void)
+{
+	struct intel_gpu_shm *shm = publish.shm;
+
+	if (!publish.have_latest)
+		return;
+
+	intel_gpu_shm_write_begin(&shm->sample_seq);
+	shm->sample = publish.latest;
+	intel_gpu_shm_write_end(&shm->sample_seq);
+	publish.have_latest = false;
+}
+
+static void
+publish_interval(double interval, unsigned long dropped)
+{
+	struct intel_gpu_shm *shm = publish.shm;
+	struct intel_gpu_shm_interval *p = &shm->interval;
+	struct timespec now;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	intel_gpu_shm_write_begin(&shm->interval_seq);
+
+	p->end = timespec_to_ns(&now);
+	p->seconds = interval;
+	p->samples = sample_stats.count;
+	p->periods = sample_stats.periods;
+	p->busy = sample_stats.busy;
+	p->dropped = dropped;
+	memcpy(p->jitter, sample_stats.jitter, sizeof(p->jitter));
+
+	for (i = 0; i < MAX_RINGS; i++) {
+		struct intel_gpu_shm_ring *ring = &p->ring[i];
+
+		ring->size = rings[i].size;
+		if (!ring->size)
+			continue;
+
+		snprintf(ring->name, sizeof(ring->name), "%s", rings[i].name);
+		ring->wait_mask = rings[i].wait_mask;
+		ring->idle = rings[i].idle;
+		ring->wait = rings[i].wait;
+		ring->full = rings[i].full;
+		memcpy(ring->busy_period, rings[i].busy_period,
+		       sizeof(ring->busy_period));
+		memcpy(ring->fill, rings[i].fill_level, sizeof(ring->fill));
+	}
+
+	p->num_units = num_instdone_bits;
+	for (i = 0; i < num_instdone_bits; i++) {
+		snprintf(p->unit[i].name, sizeof(p->unit[i].name), "%s",
+			 top_bits[i].bit->name);
+		p->unit[i].busy = top_bits[i].count;
+	}
+
+	p->num_stats = HAS_STATS_REGS(devid) ? STATS_COUNT : 0;
+	for (i = 0; i < p->num_stats; i++) {
+		snprintf(p->stat_name[i], sizeof(p->stat_name[i]), "%s",
+			 stats_reg_names[i]);
+		p->stats[i] = stats[i];
+		p->last_stats[i] = last_stats[i];
+	}
+
+	p->have_freq = gt.have_freq;
+	p->have_rc6 = gt.have_rc6;
+	p->cur_mhz = gt.cur;
+	p->min_mhz = gt.min;
+	p->max_mhz = gt.max;
+	p->rp0_mhz = gt.rp0;
+	p->busy_mhz = gt.busy_mhz;
+	memcpy(p->rc6, gt.rc6, sizeof(p->rc6));
+	memcpy(p->last_rc6, gt.last_rc6, sizeof(p->last_rc6));
+
+	intel_gpu_shm_write_end(&shm->interval_seq);
+}
+
+static void
+publish_close(void)
+{
+	intel_gpu_shm_destroy(publish.shm, publish.name);
+}
+
+/*
+ * Gather the statistics of the last @interval seconds and hand them to the
+ * exporters, before report_interval() shows them.
+ */
+static void
+collect_interval(double interval, unsigned long dropped)
+{
+	int i;
+
+	instdone_counters_collect();
 
-		/* Limit the number of lines printed to the terminal height so the
-		 * most important info (at the top) will stay on screen. */
-		max_lines = -1;
-		if (ioctl(0, TIOCGWINSZ, &ws) != -1)
-			max_lines = ws.ws_row - 6; /* exclude header lines */
-		if (max_lines >= num_instdone_bits)
-			max_lines = num_instdone_bits;
+	for (i = 0; i < MAX_RINGS; i++) {
+		ring_close_runs(&rings[i], sample_stats.last);
+		ring_summarize(&rings[i]);
+	}
+	sample_stats_summarize(&sample_stats);
 
-		t2 = gettime();
-		elapsed_time += (t2 - t1) / 1000000.0;
+	if (publish.shm)
+		publish_interval(interval, dropped);
 
-		if (interactive) {
-			printf("%s", clear_screen);
-			print_clock_info(pci_dev);
+	if (metrics.fd >= 0)
+		metrics_update(interval,
+			       sample_stats.periods ? sample_stats.periods : 1,
+			       dropped);
+}
 
-			ring_print(&render_ring, last_samples_per_sec);
-			ring_print(&bsd_ring, last_samples_per_sec);
-			ring_print(&bsd6_ring, last_samples_per_sec);
-			ring_print(&blt_ring, last_samples_per_sec);
-
-			printf("\n%30s  %s\n", "task", "percent busy");
-			for (i = 0; i < max_lines; i++) {
-				if (top_bits_sorted[i]->count > 0) {
-					percent = (top_bits_sorted[i]->count * 100) /
-						last_samples_per_sec;
-					len = printf("%30s: %3d%%: ",
-							 top_bits_sorted[i]->bit->name,
-							 percent);
-					print_percentage_bar (percent, len);
-				} else {
-					printf("%*s", PERCENTAGE_BAR_END, "");
-				}
+/*
+ * Show (or log) the statistics collected over the last @interval seconds
+ * and start a new interval.
+ */
+static void
+report_interval(struct pci_device *pci_dev, double interval,
+		unsigned long dropped, bool interactive, FILE *output)
+{
+	static double elapsed_time;
+	static bool print_headers = true;
+	unsigned short int max_lines;
+	struct winsize ws;
+	char clear_screen[] = {0x1b, '[', 'H',
+			       0x1b, '[', 'J',
+			       0x0};
+	int i, n, percent, len, ring_count;
+
+	/* timing gaps also hold back the percentages, so use the number
+	 * of sampling periods we actually covered */
+	n = sample_stats.periods ? sample_stats.periods : 1;
+	elapsed_time += interval;
+
+	qsort(top_bits_sorted, num_instdone_bits,
+	      sizeof(struct top_bit *), top_bits_sort);
+
+	ring_count = 0;
+	for (i = 0; i < MAX_RINGS; i++) {
+		if (rings[i].size)
+			ring_count++;
+	}
+
+	/* Limit the number of lines printed to the terminal height so the
+	 * most important info (at the top) will stay on screen. */
+	max_lines = -1;
+	if (ioctl(0, TIOCGWINSZ, &ws) != -1)
+		max_lines = ws.ws_row - 8 - 2 * ring_count -
+			    gt.have_freq - gt.have_rc6; /* exclude header lines */
+	if (max_lines >= num_instdone_bits)
+		max_lines = num_instdone_bits;
+
+	if (interactive) {
+		printf("%s", clear_screen);
+		if (pci_dev)
+			print_clock_info(pci_dev);
+		if (gt.have_freq || gt.have_rc6)
+			print_gt_info(n, interval);
+		print_sample_stats(&sample_stats, interval, dropped);
+		printf("\n");
+
+		for (i = 0; i < MAX_RINGS; i++)
+			ring_print(&rings[i], n);
+
+		printf("\n%30s  %s\n", "task", "percent busy");
+		for (i = 0; i < max_lines; i++) {
+			if (top_bits_sorted[i]->count > 0) {
+				percent = (top_bits_sorted[i]->count * 100) / n;
+				len = printf("%30s: %3d%%: ",
+						 top_bits_sorted[i]->bit->name,
+						 percent);
+				print_percentage_bar (percent, len);
+			} else {
+				printf("%*s", PERCENTAGE_BAR_END, "");
+			}
 
+			if (i < STATS_COUNT && HAS_STATS_REGS(devid)) {
+				printf("%13s: %llu (%lld/sec)",
+					   stats_reg_names[i],
+					   (long long)stats[i],
+					   (long long)(stats[i] - last_stats[i]));
+				last_stats[i] = stats[i];
+			} else {
+				if (!top_bits_sorted[i]->count)
+					break;
+			}
+			printf("\n");
+		}
+	}
+	if (output) {
+		/* Print headers for columns at first run */
+		if (print_headers) {
+			fprintf(output, "# time\t");
+			for (i = 0; i < LOG_OLD_RINGS; i++)
+				ring_print_header(output, log_ring_names[i]);
+			for (i = 0; i < MAX_NUM_TOP_BITS; i++) {
 				if (i < STATS_COUNT && HAS_STATS_REGS(devid)) {
-					printf("%13s: %llu (%lld/sec)",
-						   stats_reg_names[i],
-						   (long long)stats[i],
-						   (long long)(stats[i] - last_stats[i]));
-					last_stats[i] = stats[i];
-				} else {
-					if (!top_bits_sorted[i]->count)
-						break;
+					fprintf(output, "%.6s\t",
+						   stats_reg_names[i]
+						   );
 				}
-				printf("\n");
+				if (!top_bits[i].count)
+					continue;
 			}
+			fprintf(output, "MHz\teffbu%%\trc6%%\t");
+			for (i = LOG_OLD_RINGS; i < LOG_RINGS; i++)
+				ring_print_header(output, log_ring_names[i]);
+			for (i = 0; i < LOG_RINGS; i++)
+				ring_print_runs_header(output, log_ring_names[i]);
+			fprintf(output, "\n");
+			print_headers = false;
 		}
-		if (output) {
-			/* Print headers for columns at first run */
-			if (print_headers) {
-				fprintf(output, "# time\t");
-				ring_print_header(output, &render_ring);
-				ring_print_header(output, &bsd_ring);
-				ring_print_header(output, &bsd6_ring);
-				ring_print_header(output, &blt_ring);
-				for (i = 0; i < MAX_NUM_TOP_BITS; i++) {
-					if (i < STATS_COUNT && HAS_STATS_REGS(devid)) {
-						fprintf(output, "%.6s\t",
-							   stats_reg_names[i]
-							   );
-					}
-					if (!top_bits[i].count)
-						continue;
-				}
-				fprintf(output, "\n");
-				print_headers = 0;
+
+		/* Print statistics */
+		fprintf(output, "%.2f\t", elapsed_time);
+		for (i = 0; i < LOG_OLD_RINGS; i++)
+			ring_log(log_ring(i), n, output);
+
+		for (i = 0; i < MAX_NUM_TOP_BITS; i++) {
+			if (i < STATS_COUNT && HAS_STATS_REGS(devid)) {
+				fprintf(output, "%lu\t",
+					   stats[i] - last_stats[i]);
+				last_stats[i] = stats[i];
 			}
+				if (!top_bits[i].count)
+					continue;
+		}
 
-			/* Print statistics */
-			fprintf(output, "%.2f\t", elapsed_time);
-			ring_log(&render_ring, last_samples_per_sec, output);
-			ring_log(&bsd_ring, last_samples_per_sec, output);
-			ring_log(&bsd6_ring, last_samples_per_sec, output);
-			ring_log(&blt_ring, last_samples_per_sec, output);
+		if (gt.have_freq)
+			fprintf(output, "%d\t%.1f\t", gt.cur, gt_effective(n));
+		else
+			fprintf(output, "-1\t-1\t");
+		if (gt.have_rc6)
+			fprintf(output, "%.1f\t", gt_rc6_percent(0, interval) +
+				gt_rc6_percent(1, interval) +
+				gt_rc6_percent(2, interval));
+		else
+			fprintf(output, "-1\t");
+		for (i = LOG_OLD_RINGS; i < LOG_RINGS; i++)
+			ring_log(log_ring(i), n, output);
+		for (i = 0; i < LOG_RINGS; i++)
+			ring_log_runs(log_ring(i), output);
+		fprintf(output, "\n");
+		fflush(output);
+	}
 
-			for (i = 0; i < MAX_NUM_TOP_BITS; i++) {
-				if (i < STATS_COUNT && HAS_STATS_REGS(devid)) {
-					fprintf(output, "%lu\t",
-						   stats[i] - last_stats[i]);
-					last_stats[i] = stats[i];
-				}
-					if (!top_bits[i].count)
-						continue;
+	for (i = 0; i < num_instdone_bits; i++) {
+		top_bits_sorted[i]->count = 0;
+
+		if (i < STATS_COUNT)
+			last_stats[i] = stats[i];
+	}
+
+	for (i = 0; i < MAX_RINGS; i++)
+		ring_reset(&rings[i]);
+	sample_stats.count = 0;
+	sample_stats.periods = 0;
+	sample_stats.busy = 0;
+	gt_reset();
+}
+
+static void
+init_top_bits(void)
+{
+	int i;
+
+	init_instdone_definitions(devid);
+
+	for (i = 0; i < num_instdone_bits; i++) {
+		top_bits[i].bit = &instdone_bits[i];
+		top_bits[i].count = 0;
+		top_bits_sorted[i] = &top_bits[i];
+	}
+	instdone_counters_init();
+}
+
+static int
+trace_read(void *data, size_t len, FILE *file)
+{
+	return fread(data, 1, len, file) == len;
+}
+
+/*
+ * Replay a trace recorded with -t, showing (or logging) the statistics
+ * for every @window_ms of recorded time as if they had just been sampled.
+ */
+static int
+replay_trace(const char *name, int window_ms, bool interactive, FILE *output)
+{
+	const struct intel_ring_desc *descs;
+	struct trace_header header;
+	int num_rings;
+	uint64_t window = (uint64_t)window_ms * 1000000, window_end = 0;
+	uint64_t last_time = 0;
+	unsigned long dropped = 0;
+	bool have_stats = false;
+	FILE *file;
+	int i, tag;
+
+	file = fopen(name, "r");
+	if (file == NULL)
+		err(1, "failed to open %s", name);
+
+	if (!trace_read(&header, sizeof(header), file) ||
+	    memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)))
+		errx(1, "%s is not an intel_gpu_top trace", name);
+	if (header.version != TRACE_VERSION)
+		errx(1, "%s: unsupported trace version %u", name,
+		     header.version);
+
+	devid = header.devid;
+	sampler.rate = header.rate;
+	num_rings = intel_get_rings(devid, &descs);
+	for (i = 0; i < num_rings; i++) {
+		rings[i].name = descs[i].name;
+		rings[i].wait_mask = descs[i].wait_mask;
+		rings[i].size = header.ring_size[i];
+	}
+	init_top_bits();
+
+	while ((tag = fgetc(file)) != EOF) {
+		struct intel_sample sample = { 0 };
+		uint64_t time, lost;
+
+		switch (tag) {
+		case TRACE_SAMPLE:
+			if (!trace_read(&sample.time, 8, file) ||
+			    !trace_read(&sample.lateness, 4, file) ||
+			    !trace_read(&sample.weight, 4, file) ||
+			    !trace_read(&sample.instdone, 4, file) ||
+			    !trace_read(&sample.instdone1, 4, file))
+				goto truncated;
+			for (i = 0; i < MAX_RINGS; i++) {
+				if (rings[i].size &&
+				    !trace_read(&sample.ring[i], 12, file))
+					goto truncated;
 			}
-			fprintf(output, "\n");
+
+			if (window_end == 0)
+				window_end = sample.time + window;
+			while (sample.time >= window_end) {
+				collect_interval(window_ms / 1000.0, dropped);
+				report_interval(NULL, window_ms / 1000.0,
+						dropped, interactive, output);
+				dropped = 0;
+				window_end += window;
+				if (interactive)
+					usleep(window_ms * 1000);
+			}
+
+			account_sample(&sample);
+			last_time = sample.time;
+			break;
+
+		case TRACE_STATS:
+			if (!trace_read(&time, 8, file) ||
+			    !trace_read(&lost, 8, file) ||
+			    !trace_read(stats, sizeof(stats), file))
+				goto truncated;
+
+			dropped += lost;
+			if (!have_stats) {
+				memcpy(last_stats, stats, sizeof(stats));
+				have_stats = true;
+			}
+			break;
+
+		default:
+			errx(1, "%s: corrupt trace, unknown record %d at %ld",
+			     name, tag, ftell(file) - 1);
+		}
+	}
+
+out:
+	/* the last, partial window */
+	if (sample_stats.count) {
+		double interval = (last_time - (window_end - window)) / 1e9;
+
+		collect_interval(interval, dropped);
+		report_interval(NULL, interval, dropped, interactive, output);
+	}
+
+	fclose(file);
+	return 0;
+
+truncated:
+	fprintf(stderr, "%s: trace is truncated\n", name);
+	goto out;
+}
+
+/* Load the interval last published in @p, as collect_interval() would. */
+static void
+attach_load(const struct intel_gpu_shm_interval *p)
+{
+	int i;
+
+	sample_stats.count = p->samples;
+	sample_stats.periods = p->periods;
+	sample_stats.busy = p->busy;
+	memcpy(sample_stats.jitter, p->jitter, sizeof(sample_stats.jitter));
+
+	for (i = 0; i < MAX_RINGS; i++) {
+		const struct intel_gpu_shm_ring *ring = &p->ring[i];
+
+		rings[i].size = ring->size;
+		rings[i].name = ring->name;
+		rings[i].wait_mask = ring->wait_mask;
+		rings[i].idle = ring->idle;
+		rings[i].wait = ring->wait;
+		rings[i].full = ring->full;
+		memcpy(rings[i].busy_period, ring->busy_period,
+		       sizeof(rings[i].busy_period));
+		memcpy(rings[i].fill_level, ring->fill,
+		       sizeof(rings[i].fill_level));
+	}
+
+	for (i = 0; i < num_instdone_bits; i++)
+		top_bits[i].count = p->unit[i].busy;
+
+	for (i = 0; i < STATS_COUNT && i < p->num_stats; i++) {
+		stats[i] = p->stats[i];
+		last_stats[i] = p->last_stats[i];
+	}
+
+	gt.have_freq = p->have_freq;
+	gt.have_rc6 = p->have_rc6;
+	gt.cur = p->cur_mhz;
+	gt.min = p->min_mhz;
+	gt.max = p->max_mhz;
+	gt.rp0 = p->rp0_mhz;
+	gt.busy_mhz = p->busy_mhz;
+	memcpy(gt.rc6, p->rc6, sizeof(gt.rc6));
+	memcpy(gt.last_rc6, p->last_rc6, sizeof(gt.last_rc6));
+}
+
+/*
+ * Show (or log) what another intel_gpu_top publishes with -P, each time it
+ * completes an interval, without touching the hardware.
+ */
+static int
+attach_shm(const char *name, bool interactive, FILE *output)
+{
+	static struct intel_gpu_shm_interval snapshot;
+	const struct intel_gpu_shm *shm;
+	uint64_t last_end = 0;
+
+	shm = intel_gpu_shm_attach(name);
+
+	devid = shm->devid;
+	sampler.rate = shm->rate;
+	sampler.idle_rate = shm->idle_rate;
+	init_top_bits();
+
+	for (;;) {
+		if (kill(shm->pid, 0) && errno == ESRCH) {
+			fprintf(stderr, "%s: intel_gpu_top -P exited\n", name);
+			return 1;
+		}
+
+		if (!intel_gpu_shm_read(&shm->interval_seq, &snapshot,
+					&shm->interval, sizeof(snapshot)))
+			errx(1, "%s: writer stuck in the middle of an update",
+			     name);
+
+		if (snapshot.end != last_end) {
+			if (snapshot.num_units != num_instdone_bits)
+				errx(1, "%s: expected %d units, found %u",
+				     name, num_instdone_bits,
+				     snapshot.num_units);
+
+			attach_load(&snapshot);
+			report_interval(NULL, snapshot.seconds,
+					snapshot.dropped, interactive, output);
+			last_end = snapshot.end;
+		}
+
+		usleep(1000000 / DRAIN_PER_SEC);
+	}
+}
+
+static void
+drain_sample(const struct intel_sample *sample, void *data)
+{
+	account_sample(sample);
+	if (trace.file)
+		trace_record_sample(sample);
+	if (publish.shm) {
+		publish.latest = *sample;
+		publish.have_latest = true;
+	}
+}
+
+static void
+usage(const char *appname)
+{
+	printf("intel_gpu_top - Display a top-like summary of Intel GPU usage\n"
+			"\n"
+			"usage: %s [parameters]\n"
+			"\n"
+			"The following parameters apply:\n"
+			"[-s <samples>]       samples per seconds (default %d)\n"
+			"[-e <command>]       command to profile\n"
+			"[-o <file>]          output statistics to file. If file is '-',"
+			"                     run in batch mode and output statistics to stdio only \n"
+			"[-p <cpu>]           pin the sampling thread to a cpu\n"
+			"[-R]                 sample with realtime (SCHED_FIFO) priority\n"
+			"[-a <samples>]       adaptive: samples per second while the GPU is idle\n"
+			"[-S <dir>]           sysfs directory of the card, for frequency and rc6\n"
+			"[-t <file>]          record every raw sample to a binary trace file\n"
+			"[-i <file>]          replay a trace recorded with -t instead of sampling\n"
+			"[-w <ms>]            aggregation window when replaying (default 1000)\n"
+			"[-m <endpoint>]      serve OpenMetrics on a unix socket path or [host:]port\n"
+			"[-P <name>]          publish to the shared memory segment <name>, e.g. %s\n"
+			"[-A <name>], [--attach <name>]\n"
+			"                     show what intel_gpu_top -P publishes instead of sampling\n"
+			"[-h]                 show this help screen\n"
+			"\n",
+			appname,
+			SAMPLES_PER_SEC,
+			INTEL_GPU_SHM_NAME
+		  );
+	return;
+}
+
+int main(int argc, char **argv)
+{
+	struct pci_device *pci_dev;
+	const struct intel_ring_desc *descs;
+	int i, ch, num_rings;
+	FILE *output = NULL;
+	pid_t child_pid=-1;
+	int child_stat;
+	char *cmd=NULL;
+	int interactive=1;
+	char *trace_file = NULL, *replay_file = NULL, *endpoint = NULL;
+	char *sysfs_root = NULL, *publish_name = NULL, *attach_name = NULL;
+	int window_ms = 1000;
+	static const struct option long_opts[] = {
+		{ "attach", required_argument, NULL, 'A' },
+		{ "publish", required_argument, NULL, 'P' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	struct timespec next_drain, last_update;
+
+	sampler.rate = SAMPLES_PER_SEC;
+
+	/* Parse options? */
+	while ((ch = getopt_long(argc, argv, "s:o:e:p:Ra:S:t:i:w:m:P:A:h",
+				 long_opts, NULL)) != -1) {
+		switch (ch) {
+		case 'e': cmd = strdup(optarg);
+			break;
+		case 's': sampler.rate = atoi(optarg);
+			if (sampler.rate < 100 ||
+			    sampler.rate > MAX_SAMPLES_PER_SEC) {
+				fprintf(stderr, "Error: samples per second must be between 100 and %d\n",
+					MAX_SAMPLES_PER_SEC);
+				exit(1);
+			}
+			break;
+		case 'o':
+			if (!strcmp(optarg, "-")) {
+				/* Running in non-interactive mode */
+				interactive = 0;
+				output = stdout;
+			}
+			else
+				output = fopen(optarg, "w");
+			if (!output)
+			{
+				perror("fopen");
+				exit(1);
+			}
+			break;
+		case 'p':
+			sampler.cpu = atoi(optarg);
+			break;
+		case 'R':
+			sampler.realtime = true;
+			break;
+		case 'a':
+			sampler.idle_rate = atoi(optarg);
+			if (sampler.idle_rate < 1) {
+				fprintf(stderr, "Error: idle samples per second must be >= 1\n");
+				exit(1);
+			}
+			break;
+		case 'S':
+			sysfs_root = optarg;
+			break;
+		case 't':
+			trace_file = optarg;
+			break;
+		case 'i':
+			replay_file = optarg;
+			break;
+		case 'w':
+			window_ms = atoi(optarg);
+			if (window_ms < 1) {
+				fprintf(stderr, "Error: window must be >= 1ms\n");
+				exit(1);
+			}
+			break;
+		case 'm':
+			endpoint = optarg;
+			/* an exporter runs unattended */
+			interactive = 0;
+			break;
+		case 'P':
+			publish_name = optarg;
+			interactive = 0;
+			break;
+		case 'A':
+			attach_name = optarg;
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+			break;
+		default:
+			fprintf(stderr, "Invalid flag %c!\n", (char)optopt);
+			usage(argv[0]);
+			exit(1);
+			break;
+		}
+	}
+
+	if (sampler.idle_rate > sampler.rate) {
+		fprintf(stderr, "Error: idle samples per second can't exceed %d\n",
+			sampler.rate);
+		exit(1);
+	}
+
+	if (attach_name) {
+		if (cmd || trace_file || replay_file || endpoint ||
+		    publish_name) {
+			fprintf(stderr, "Error: -A can't be combined with -e, -t, -i, -m or -P\n");
+			exit(1);
+		}
+		attach_shm(attach_name, interactive, output);
+		if (output)
+			fclose(output);
+		return 1;
+	}
+
+	if (replay_file) {
+		if (cmd || trace_file || endpoint || publish_name) {
+			fprintf(stderr, "Error: -i can't be combined with -e, -t, -m or -P\n");
+			exit(1);
+		}
+		replay_trace(replay_file, window_ms, interactive, output);
+		if (output)
+			fclose(output);
+		return 0;
+	}
+
+	pci_dev = intel_get_pci_device();
+	devid = pci_dev->device_id;
+	intel_get_mmio(pci_dev);
+
+	/* Do we have a command to run? */
+	if (cmd != NULL) {
+		if (output) {
+			fprintf(output, "# Profiling: %s\n", cmd);
 			fflush(output);
 		}
+		child_pid = fork();
+		if (child_pid < 0) {
+			perror("fork");
+			exit(1);
+		}
+		else if (child_pid == 0) {
+			int res;
+			res = system(cmd);
+			if (res < 0)
+				perror("running command");
+			if (output) {
+				fflush(output);
+				fprintf(output, "# %s exited with status %d\n", cmd, res);
+				fflush(output);
+			}
+			free(cmd);
+			exit(0);
+		} else {
+			free(cmd);
+		}
+	}
 
-		for (i = 0; i < num_instdone_bits; i++) {
-			top_bits_sorted[i]->count = 0;
+	init_top_bits();
 
-			if (i < STATS_COUNT)
-				last_stats[i] = stats[i];
+	/* Grab access to the registers */
+	intel_register_access_init(pci_dev, 0);
+
+	num_rings = intel_get_rings(devid, &descs);
+	for (i = 0; i < num_rings; i++)
+		ring_init(&rings[i], &descs[i]);
+
+	/* Initialize GPU stats */
+	if (HAS_STATS_REGS(devid)) {
+		read_stats(last_stats);
+		memcpy(stats, last_stats, sizeof(stats));
+	}
+
+	gt_init(sysfs_root);
+
+	if (trace_file)
+		trace_open(trace_file);
+
+	if (endpoint)
+		metrics_open(endpoint);
+
+	if (publish_name)
+		publish_open(publish_name);
+
+	intel_sampler_start(&sampler, devid);
+
+	clock_gettime(CLOCK_MONOTONIC, &last_update);
+	next_drain = last_update;
+
+	if (trace_file)
+		trace_record_stats(timespec_to_ns(&last_update), 0);
+
+	for (;;) {
+		unsigned long dropped;
+		struct timespec now;
+		double interval;
+		int n;
+
+		/* Account the samples as they come in, and update the
+		 * screen once per second. */
+		for (n = 0; n < DRAIN_PER_SEC; n++) {
+			timespec_add_ns(&next_drain, 1000000000 / DRAIN_PER_SEC);
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+					&next_drain, NULL);
+
+			intel_sampler_drain(&sampler, drain_sample, NULL);
+			gt_sample_freq();
+			if (publish.shm)
+				publish_sample();
 		}
 
+		dropped = intel_sampler_dropped(&sampler);
+
+		if (HAS_STATS_REGS(devid))
+			read_stats(stats);
+		gt_update();
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		interval = (timespec_to_ns(&now) -
+			    timespec_to_ns(&last_update)) / 1e9;
+		last_update = now;
+
+		if (trace_file)
+			trace_record_stats(timespec_to_ns(&now), dropped);
+
+		collect_interval(interval, dropped);
+		report_interval(pci_dev, interval, dropped, interactive,
+				output);
+
 		/* Check if child has gone */
 		if (child_pid > 0) {
 			int res;
@@ -707,7 +2319,20 @@ int main(int argc, char **argv)
 		}
 	}
 
-	fclose(output);
+	intel_sampler_stop(&sampler);
+	free(sample_stats.lateness);
+
+	if (trace_file)
+		trace_close();
+
+	if (endpoint)
+		metrics_close();
+
+	if (publish_name)
+		publish_close();
+
+	if (output)
+		fclose(output);
 
 	intel_register_access_fini();
 	return 0;
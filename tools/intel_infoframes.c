@@ -31,6 +31,7 @@
 #include <string.h>
 #include <getopt.h>
 #include "intel_gpu_tools.h"
+#include "intel_reg_desc.h"
 
 typedef enum {
 	TRANSC_A = 0,
@@ -39,21 +40,7 @@ typedef enum {
 	TRANSC_INVALID
 } Transcoder;
 
-typedef enum {
-	REG_HDMIB_GEN4    = 0x61140,
-	REG_HDMIC_GEN4    = 0x61160,
-	REG_HDMIB_PCH     = 0xe1140,
-	REG_HDMIC_PCH     = 0xe1150,
-	REG_HDMID_PCH     = 0xe1160,
-	REG_DIP_CTL_GEN4  = 0x61170,
-	REG_DIP_CTL_A     = 0xe0200,
-	REG_DIP_CTL_B     = 0xe1200,
-	REG_DIP_CTL_C     = 0xe2200,
-	REG_DIP_DATA_GEN4 = 0x61178,
-	REG_DIP_DATA_A    = 0xe0208,
-	REG_DIP_DATA_B    = 0xe1208,
-	REG_DIP_DATA_C    = 0xe2208,
-} Register;
+typedef enum intel_reg_id Register;
 
 typedef enum {
 	DIP_AVI    = 0,
@@ -86,37 +73,23 @@ typedef enum {
 	SOURCE_DEVICE_RESERVED          = 0x0c
 } SourceDevice;
 
-#define HDMI_PORT_ENABLE          (1 << 31)
-#define HDMI_PORT_TRANSCODER_GEN4 (1 << 30)
-#define HDMI_PORT_TRANSCODER_IBX  (1 << 30)
-#define HDMI_PORT_TRANSCODER_CPT  (3 << 29)
-#define HDMI_PORT_ENCODING        (3 << 10)
-#define HDMI_PORT_MODE            (1 << 9)
-#define HDMI_PORT_AUDIO           (1 << 6)
-#define HDMI_PORT_DETECTED        (1 << 2)
-
-#define DIP_CTL_ENABLE           (1 << 31)
-#define DIP_CTL_GCP_ENABLE       (1 << 25)
-#define DIP_CTL_SPD_ENABLE       (1 << 24)
-#define DIP_CTL_GAMUT_ENABLE     (1 << 23)
-#define DIP_CTL_VENDOR_ENABLE    (1 << 22)
-#define DIP_CTL_AVI_ENABLE       (1 << 21)
-#define DIP_CTL_BUFFER_INDEX     (3 << 19)
-#define DIP_CTL_BUFFER_AVI       (0 << 19)
-#define DIP_CTL_BUFFER_VENDOR    (1 << 19)
-#define DIP_CTL_BUFFER_GAMUT     (2 << 19)
-#define DIP_CTL_BUFFER_SPD       (3 << 19)
-#define DIP_CTL_FREQUENCY        (3 << 16)
-#define DIP_CTL_FREQ_ONCE        (0 << 16)
-#define DIP_CTL_FREQ_EVERY       (1 << 16)
-#define DIP_CTL_FREQ_EVERY_OTHER (2 << 16)
-#define DIP_CTL_BUFFER_SIZE      (15 << 8)
-#define DIP_CTL_ACCESS_ADDR      (15 << 0)
-
-#define DIP_CTL_PORT_SEL_MASK_GEN4       (3 << 29)
-#define DIP_CTL_PORT_SEL_B_GEN4          (1 << 29)
-#define DIP_CTL_PORT_SEL_C_GEN4          (2 << 29)
-#define DIP_CTL_BUFFER_TRANS_ACTIVE_GEN4 (1 << 28)
+/* Register bits, from the register description database */
+#define HDMI_PORT_ENABLE          intel_reg_field_mask(INTEL_FIELD_HDMI_ENABLE)
+#define HDMI_PORT_MODE            intel_reg_field_mask(INTEL_FIELD_HDMI_MODE)
+#define HDMI_PORT_AUDIO           intel_reg_field_mask(INTEL_FIELD_HDMI_AUDIO)
+#define HDMI_PORT_DETECTED        intel_reg_field_mask(INTEL_FIELD_HDMI_DETECTED)
+
+#define DIP_CTL_ENABLE           intel_reg_field_mask(INTEL_FIELD_DIP_CTL_ENABLE)
+#define DIP_CTL_GCP_ENABLE       intel_reg_field_mask(INTEL_FIELD_DIP_CTL_GCP)
+#define DIP_CTL_SPD_ENABLE       intel_reg_field_mask(INTEL_FIELD_DIP_CTL_SPD)
+#define DIP_CTL_GAMUT_ENABLE     intel_reg_field_mask(INTEL_FIELD_DIP_CTL_GAMUT)
+#define DIP_CTL_VENDOR_ENABLE    intel_reg_field_mask(INTEL_FIELD_DIP_CTL_VENDOR)
+#define DIP_CTL_AVI_ENABLE       intel_reg_field_mask(INTEL_FIELD_DIP_CTL_AVI)
+#define DIP_CTL_BUFFER_INDEX     intel_reg_field_mask(INTEL_FIELD_DIP_CTL_BUFFER_INDEX)
+#define DIP_CTL_FREQUENCY        intel_reg_field_mask(INTEL_FIELD_DIP_CTL_FREQUENCY)
+#define DIP_CTL_ACCESS_ADDR      intel_reg_field_mask(INTEL_FIELD_DIP_CTL_ACCESS_ADDR)
+#define DIP_CTL_BUFFER_TRANS_ACTIVE_GEN4 \
+	intel_reg_field_mask(INTEL_FIELD_DIP_CTL_TRANS_ACTIVE)
 
 #define AVI_INFOFRAME_TYPE    0x82
 #define AVI_INFOFRAME_VERSION 0x02
@@ -199,23 +172,23 @@ typedef union {
 } DipInfoFrame;
 
 Register gen4_hdmi_ports[] = {
-	REG_HDMIB_GEN4,
-	REG_HDMIC_GEN4,
+	INTEL_REG_SDVOB,
+	INTEL_REG_SDVOC,
 };
 Register pch_hdmi_ports[] = {
-	REG_HDMIB_PCH,
-	REG_HDMIC_PCH,
-	REG_HDMID_PCH
+	INTEL_REG_HDMIB,
+	INTEL_REG_HDMIC,
+	INTEL_REG_HDMID
 };
 Register pch_dip_ctl_regs[] = {
-	REG_DIP_CTL_A,
-	REG_DIP_CTL_B,
-	REG_DIP_CTL_C
+	INTEL_REG_VIDEO_DIP_CTL_A,
+	INTEL_REG_VIDEO_DIP_CTL_B,
+	INTEL_REG_VIDEO_DIP_CTL_C
 };
 Register pch_dip_data_regs[] = {
-	REG_DIP_DATA_A,
-	REG_DIP_DATA_B,
-	REG_DIP_DATA_C
+	INTEL_REG_VIDEO_DIP_DATA_A,
+	INTEL_REG_VIDEO_DIP_DATA_B,
+	INTEL_REG_VIDEO_DIP_DATA_C
 };
 const char *hdmi_port_names[] = {
 	"HDMIB",
@@ -271,7 +244,7 @@ static const char *spd_source_to_string(SourceDevice source)
 static Register get_dip_ctl_reg(Transcoder transcoder)
 {
 	if (gen == 4)
-		return REG_DIP_CTL_GEN4;
+		return INTEL_REG_VIDEO_DIP_CTL;
 	else
 		return pch_dip_ctl_regs[transcoder];
 }
@@ -279,7 +252,7 @@ static Register get_dip_ctl_reg(Transcoder transcoder)
 static Register get_dip_data_reg(Transcoder transcoder)
 {
 	if (gen == 4)
-		return REG_DIP_DATA_GEN4;
+		return INTEL_REG_VIDEO_DIP_DATA;
 	else
 		return pch_dip_data_regs[transcoder];
 }
@@ -302,20 +275,20 @@ static void load_infoframe(Transcoder transcoder, DipInfoFrame *frame,
 	uint32_t ctl_val;
 	uint32_t i;
 
-	ctl_val = INREG(ctl_reg);
+	ctl_val = DESC_INREG(ctl_reg);
 
 	ctl_val &= ~DIP_CTL_BUFFER_INDEX;
-	ctl_val |= type << 19;
-	OUTREG(ctl_reg, ctl_val);
-	ctl_val = INREG(ctl_reg);
+	ctl_val |= intel_reg_field_set(INTEL_FIELD_DIP_CTL_BUFFER_INDEX, type);
+	DESC_OUTREG(ctl_reg, ctl_val);
+	ctl_val = DESC_INREG(ctl_reg);
 
 	ctl_val &= ~DIP_CTL_ACCESS_ADDR;
-	OUTREG(ctl_reg, ctl_val);
+	DESC_OUTREG(ctl_reg, ctl_val);
 
 	for (i = 0; i < 16; i++) {
-		ctl_val = INREG(ctl_reg);
+		ctl_val = DESC_INREG(ctl_reg);
 		assert((ctl_val & DIP_CTL_ACCESS_ADDR) == i);
-		frame->data32[i] = INREG(data_reg);
+		frame->data32[i] = DESC_INREG(data_reg);
 	}
 }
 
@@ -350,7 +323,7 @@ static void infoframe_fix_checksum(DipInfoFrame *frame)
 static void dump_port_info(int hdmi_port_index)
 {
 	Register port = get_hdmi_port(hdmi_port_index);
-	uint32_t val = INREG(port);
+	uint32_t val = DESC_INREG(port);
 	Transcoder transcoder;
 
 	printf("\nPort %s:\n", hdmi_port_names[hdmi_port_index]);
@@ -360,15 +333,13 @@ static void dump_port_info(int hdmi_port_index)
 	if (!(val & HDMI_PORT_ENABLE))
 		return;
 
-	if (gen == 4)
-		transcoder = (val & HDMI_PORT_TRANSCODER_GEN4) >> 30;
-	else if (pch >= PCH_CPT)
-		transcoder = (val & HDMI_PORT_TRANSCODER_CPT) >> 29;
+	if (gen != 4 && pch >= PCH_CPT)
+		transcoder = intel_reg_field_get(INTEL_FIELD_HDMI_TRANSCODER_CPT, val);
 	else
-		transcoder = (val & HDMI_PORT_TRANSCODER_IBX) >> 30;
+		transcoder = intel_reg_field_get(INTEL_FIELD_HDMI_TRANSCODER, val);
 	printf("- transcoder: %s\n", transcoder_names[transcoder]);
 
-	switch ((val & HDMI_PORT_ENCODING) >> 10) {
+	switch (intel_reg_field_get(INTEL_FIELD_HDMI_ENCODING, val)) {
 	case 0:
 		printf("- mode: SDVO\n");
 		break;
@@ -403,7 +374,7 @@ static void dump_avi_info(Transcoder transcoder)
 	DipInfoFrame frame;
 
 	load_infoframe(transcoder, &frame, DIP_AVI);
-	val = INREG(reg);
+	val = DESC_INREG(reg);
 
 	printf("AVI InfoFrame:\n");
 
@@ -412,7 +383,7 @@ static void dump_avi_info(Transcoder transcoder)
 		       val & DIP_CTL_BUFFER_TRANS_ACTIVE_GEN4 ? "" : "not ");
 	}
 
-	freq = (val & DIP_CTL_FREQUENCY) >> 16;
+	freq = intel_reg_field_get(INTEL_FIELD_DIP_CTL_FREQUENCY, val);
 	printf("- frequency: %s\n", dip_frequency_names[freq]);
 
 	dump_raw_infoframe(&frame);
@@ -484,7 +455,7 @@ static void dump_vendor_info(Transcoder transcoder)
 	DipInfoFrame frame;
 
 	load_infoframe(transcoder, &frame, DIP_VENDOR);
-	val = INREG(reg);
+	val = DESC_INREG(reg);
 
 	printf("Vendor InfoFrame:\n");
 
@@ -493,7 +464,7 @@ static void dump_vendor_info(Transcoder transcoder)
 		       val & DIP_CTL_BUFFER_TRANS_ACTIVE_GEN4 ? "" : "not ");
 	}
 
-	freq = (val & DIP_CTL_FREQUENCY) >> 16;
+	freq = intel_reg_field_get(INTEL_FIELD_DIP_CTL_FREQUENCY, val);
 	printf("- frequency: %s\n", dip_frequency_names[freq]);
 
 	dump_raw_infoframe(&frame);
@@ -519,7 +490,7 @@ static void dump_gamut_info(Transcoder transcoder)
 	DipInfoFrame frame;
 
 	load_infoframe(transcoder, &frame, DIP_GAMUT);
-	val = INREG(reg);
+	val = DESC_INREG(reg);
 
 	printf("Gamut InfoFrame:\n");
 
@@ -528,7 +499,7 @@ static void dump_gamut_info(Transcoder transcoder)
 		       val & DIP_CTL_BUFFER_TRANS_ACTIVE_GEN4 ? "" : "not ");
 	}
 
-	freq = (val & DIP_CTL_FREQUENCY) >> 16;
+	freq = intel_reg_field_get(INTEL_FIELD_DIP_CTL_FREQUENCY, val);
 	printf("- frequency: %s\n", dip_frequency_names[freq]);
 
 	dump_raw_infoframe(&frame);
@@ -547,7 +518,7 @@ static void dump_spd_info(Transcoder transcoder)
 	char description[17];
 
 	load_infoframe(transcoder, &frame, DIP_SPD);
-	val = INREG(reg);
+	val = DESC_INREG(reg);
 
 	printf("SPD InfoFrame:\n");
 
@@ -556,7 +527,7 @@ static void dump_spd_info(Transcoder transcoder)
 		       val & DIP_CTL_BUFFER_TRANS_ACTIVE_GEN4 ? "" : "not ");
 	}
 
-	freq = (val & DIP_CTL_FREQUENCY) >> 16;
+	freq = intel_reg_field_get(INTEL_FIELD_DIP_CTL_FREQUENCY, val);
 	printf("- frequency: %s\n", dip_frequency_names[freq]);
 
 	dump_raw_infoframe(&frame);
@@ -582,15 +553,15 @@ static void dump_spd_info(Transcoder transcoder)
 static void dump_transcoder_info(Transcoder transcoder)
 {
 	Register reg = get_dip_ctl_reg(transcoder);
-	uint32_t val = INREG(reg);
+	uint32_t val = DESC_INREG(reg);
 
 	if (gen == 4) {
 		printf("\nDIP information:\n");
-		switch (val & DIP_CTL_PORT_SEL_MASK_GEN4) {
-		case DIP_CTL_PORT_SEL_B_GEN4:
+		switch (intel_reg_field_get(INTEL_FIELD_DIP_CTL_PORT_SEL, val)) {
+		case 1:
 			printf("- port B\n");
 			break;
-		case DIP_CTL_PORT_SEL_C_GEN4:
+		case 2:
 			printf("- port C\n");
 			break;
 		default:
@@ -640,37 +611,37 @@ static void write_infoframe(Transcoder transcoder, DipType type,
 	uint32_t ctl_val;
 	unsigned int i;
 
-	ctl_val = INREG(ctl_reg);
+	ctl_val = DESC_INREG(ctl_reg);
 	ctl_val &= ~DIP_CTL_BUFFER_INDEX;
-	ctl_val |= (type << 19);
+	ctl_val |= intel_reg_field_set(INTEL_FIELD_DIP_CTL_BUFFER_INDEX, type);
 	ctl_val &= ~DIP_CTL_ACCESS_ADDR;
-	OUTREG(ctl_reg, ctl_val);
+	DESC_OUTREG(ctl_reg, ctl_val);
 
 	for (i = 0; i < 8; i++) {
-		ctl_val = INREG(ctl_reg);
+		ctl_val = DESC_INREG(ctl_reg);
 		assert((ctl_val & DIP_CTL_ACCESS_ADDR) == i);
-		OUTREG(data_reg, frame->data32[i]);
+		DESC_OUTREG(data_reg, frame->data32[i]);
 	}
 }
 
 static void disable_infoframe(Transcoder transcoder, DipType type)
 {
 	Register reg = get_dip_ctl_reg(transcoder);
-	uint32_t val = INREG(reg);
+	uint32_t val = DESC_INREG(reg);
 	if (gen != 4 && type == DIP_AVI)
 		val &= ~DIP_CTL_ENABLE;
 	val &= ~(1 << (21 + type));
-	OUTREG(reg, val);
+	DESC_OUTREG(reg, val);
 }
 
 static void enable_infoframe(Transcoder transcoder, DipType type)
 {
 	Register reg = get_dip_ctl_reg(transcoder);
-	uint32_t val = INREG(reg);
+	uint32_t val = DESC_INREG(reg);
 	if (gen != 4 && type == DIP_AVI)
 		val |= DIP_CTL_ENABLE;
 	val |= (1 << (21 + type));
-	OUTREG(reg, val);
+	DESC_OUTREG(reg, val);
 }
 
 static int parse_infoframe_option_u(const char *name, const char *s,
@@ -729,7 +700,7 @@ static void change_avi_infoframe(Transcoder transcoder, char *commands)
 	char *current = commands;
 
 	load_infoframe(transcoder, &frame, DIP_AVI);
-	val = INREG(reg);
+	val = DESC_INREG(reg);
 
 	while (1) {
 		rc = sscanf(current, "%31s%n", option, &read);
@@ -797,8 +768,9 @@ static void change_avi_infoframe(Transcoder transcoder, char *commands)
 	}
 
 	val &= ~DIP_CTL_FREQUENCY;
-	val |= DIP_CTL_FREQ_EVERY;
-	OUTREG(reg, val);
+	val |= intel_reg_field_set(INTEL_FIELD_DIP_CTL_FREQUENCY,
+				   DIP_FREQ_EVERY_VSYNC);
+	DESC_OUTREG(reg, val);
 
 	frame.avi.header.type = AVI_INFOFRAME_TYPE;
 	frame.avi.header.version = AVI_INFOFRAME_VERSION;
@@ -830,7 +802,7 @@ static void change_spd_infoframe(Transcoder transcoder, char *commands)
 	char *current = commands;
 
 	load_infoframe(transcoder, &frame, DIP_SPD);
-	val = INREG(reg);
+	val = DESC_INREG(reg);
 
 	while (1) {
 		rc = sscanf(current, "%15s%n", option, &read);
@@ -858,8 +830,9 @@ static void change_spd_infoframe(Transcoder transcoder, char *commands)
 	}
 
 	val &= ~DIP_CTL_FREQUENCY;
-	val |= DIP_CTL_FREQ_EVERY_OTHER;
-	OUTREG(reg, val);
+	val |= intel_reg_field_set(INTEL_FIELD_DIP_CTL_FREQUENCY,
+				   DIP_FREQ_EVERY_OTHER_VSYNC);
+	DESC_OUTREG(reg, val);
 
 	frame.spd.header.type = SPD_INFOFRAME_TYPE;
 	frame.spd.header.version = SPD_INFOFRAME_VERSION;
@@ -888,7 +861,7 @@ static void change_infoframe_frequency(Transcoder transcoder, DipType type,
 				       DipFrequency frequency)
 {
 	Register reg = get_dip_ctl_reg(transcoder);
-	uint32_t val = INREG(reg);
+	uint32_t val = DESC_INREG(reg);
 
 	if (type == DIP_AVI && frequency != DIP_FREQ_EVERY_VSYNC) {
 		printf("Error: AVI infoframe must be sent every VSync!\n");
@@ -896,38 +869,38 @@ static void change_infoframe_frequency(Transcoder transcoder, DipType type,
 	}
 
 	val &= ~DIP_CTL_FREQUENCY;
-	val |= (frequency << 16);
-	OUTREG(reg, val);
+	val |= intel_reg_field_set(INTEL_FIELD_DIP_CTL_FREQUENCY, frequency);
+	DESC_OUTREG(reg, val);
 }
 
 static void disable_dip(Transcoder transcoder)
 {
 	Register reg = get_dip_ctl_reg(transcoder);
-	uint32_t val = INREG(reg);
+	uint32_t val = DESC_INREG(reg);
 	val &= ~DIP_CTL_ENABLE;
-	OUTREG(reg, val);
+	DESC_OUTREG(reg, val);
 }
 
 static void enable_dip(Transcoder transcoder)
 {
 	Register reg = get_dip_ctl_reg(transcoder);
-	uint32_t val = INREG(reg);
+	uint32_t val = DESC_INREG(reg);
 	val |= DIP_CTL_ENABLE;
-	OUTREG(reg, val);
+	DESC_OUTREG(reg, val);
 }
 
 static void disable_hdmi_port(Register reg)
 {
-	uint32_t val = INREG(reg);
+	uint32_t val = DESC_INREG(reg);
 	val &= ~HDMI_PORT_ENABLE;
-	OUTREG(reg, val);
+	DESC_OUTREG(reg, val);
 }
 
 static void enable_hdmi_port(Register reg)
 {
-	uint32_t val = INREG(reg);
+	uint32_t val = DESC_INREG(reg);
 	val |= HDMI_PORT_ENABLE;
-	OUTREG(reg, val);
+	DESC_OUTREG(reg, val);
 }
 
 static void print_usage(void)
@@ -31,39 +31,37 @@
 #include <stdlib.h>
 #include <string.h>
 #include "intel_gpu_tools.h"
+#include "intel_reg_desc.h"
 
 int gen;
 
-uint32_t HTOTAL[]     = { 0x60000, 0x61000, 0x62000 };
-uint32_t VTOTAL[]     = { 0x6000C, 0x6100C, 0x6200C };
-uint32_t PIPECONF[]   = { 0x70008, 0x71008, 0x72008 };
-uint32_t PIPESRC[]    = { 0x6001C, 0x6101C, 0x6201C };
-uint32_t PF_CTRL1[]   = { 0x68080, 0x68880, 0x69080 };
-uint32_t PF_WIN_POS[] = { 0x68070, 0x68870, 0x69070 };
-uint32_t PF_WIN_SZ[]  = { 0x68074, 0x68874, 0x69074 };
-
-#define PIPECONF_ENABLE         (1 << 31)
-#define PIPECONF_INTERLACE_MASK (7 << 21)
-#define PIPECONF_PF_PD          (0 << 21)
-#define PIPECONF_PF_ID          (1 << 21)
-#define PIPECONF_IF_ID          (3 << 21)
-
-#define HTOTAL_ACTIVE_MASK (0xFFF << 0)
-#define VTOTAL_ACTIVE_MASK (0xFFF << 0)
-
-#define PIPESRC_HORIZ_MASK (0xFFF << 16)
-#define PIPESRC_VERT_MASK  (0xFFF << 0)
-
-/*#define PF_ENABLE    (1 << 31)*/
-#define PF_PIPE_MASK   (3 << 29)
-#define PF_FILTER_MASK (3 << 23)
-#define PF_FILTER_MED  (1 << 23)
-#define PF_PIPE_A      (0 << 29)
-#define PF_PIPE_B      (1 << 29)
-#define PF_PIPE_C      (2 << 29)
-
-#define PF_WIN_SZ_X_MASK (0x1FFF << 16)
-#define PF_WIN_SZ_Y_MASK (0xFFF << 0)
+static const enum intel_reg_id HTOTAL[] = {
+	INTEL_REG_HTOTAL_A, INTEL_REG_HTOTAL_B, INTEL_REG_HTOTAL_C
+};
+static const enum intel_reg_id VTOTAL[] = {
+	INTEL_REG_VTOTAL_A, INTEL_REG_VTOTAL_B, INTEL_REG_VTOTAL_C
+};
+static const enum intel_reg_id PIPECONF[] = {
+	INTEL_REG_PIPEACONF, INTEL_REG_PIPEBCONF, INTEL_REG_PIPECCONF
+};
+static const enum intel_reg_id PIPESRC[] = {
+	INTEL_REG_PIPEASRC, INTEL_REG_PIPEBSRC, INTEL_REG_PIPECSRC
+};
+static const enum intel_reg_id PF_CTRL1[] = {
+	INTEL_REG_PFA_CTL_1, INTEL_REG_PFB_CTL_1, INTEL_REG_PFC_CTL_1
+};
+static const enum intel_reg_id PF_WIN_POS[] = {
+	INTEL_REG_PFA_WIN_POS, INTEL_REG_PFB_WIN_POS, INTEL_REG_PFC_WIN_POS
+};
+static const enum intel_reg_id PF_WIN_SZ[] = {
+	INTEL_REG_PFA_WIN_SIZE, INTEL_REG_PFB_WIN_SIZE, INTEL_REG_PFC_WIN_SIZE
+};
+
+#define PIPECONF_PF_PD          0
+#define PIPECONF_PF_ID          1
+#define PIPECONF_IF_ID          3
+
+#define PF_FILTER_MED           1
 
 struct pipe_info {
 	bool enabled;
@@ -81,22 +79,22 @@ static void read_pipe_info(int intel_pipe, struct pipe_info *info)
 {
 	uint32_t conf, vtotal, htotal, src, ctrl1, win_sz;
 
-	conf   = INREG(PIPECONF[intel_pipe]);
-	htotal = INREG(HTOTAL[intel_pipe]);
-	vtotal = INREG(VTOTAL[intel_pipe]);
-	src    = INREG(PIPESRC[intel_pipe]);
-	ctrl1  = INREG(PF_CTRL1[intel_pipe]);
-	win_sz = INREG(PF_WIN_SZ[intel_pipe]);
-
-	info->enabled = (conf & PIPECONF_ENABLE) ? true : false;
-	info->tot_width = (htotal & HTOTAL_ACTIVE_MASK) + 1;
-	info->tot_height = (vtotal & VTOTAL_ACTIVE_MASK) + 1;
-	info->src_width = ((src & PIPESRC_HORIZ_MASK) >> 16) + 1;
-	info->src_height = (src & PIPESRC_VERT_MASK) + 1;
-	info->interlace_mode = conf & PIPECONF_INTERLACE_MASK;
-	info->pf_enabled = ctrl1 & PF_ENABLE;
-	info->dst_width = (win_sz & PF_WIN_SZ_X_MASK) >> 16;
-	info->dst_height = win_sz & PF_WIN_SZ_Y_MASK;
+	conf   = DESC_INREG(PIPECONF[intel_pipe]);
+	htotal = DESC_INREG(HTOTAL[intel_pipe]);
+	vtotal = DESC_INREG(VTOTAL[intel_pipe]);
+	src    = DESC_INREG(PIPESRC[intel_pipe]);
+	ctrl1  = DESC_INREG(PF_CTRL1[intel_pipe]);
+	win_sz = DESC_INREG(PF_WIN_SZ[intel_pipe]);
+
+	info->enabled = intel_reg_field_get(INTEL_FIELD_PIPECONF_ENABLE, conf);
+	info->tot_width = intel_reg_field_get(INTEL_FIELD_TIMING_ACTIVE, htotal) + 1;
+	info->tot_height = intel_reg_field_get(INTEL_FIELD_TIMING_ACTIVE, vtotal) + 1;
+	info->src_width = intel_reg_field_get(INTEL_FIELD_PIPESRC_HSIZE, src) + 1;
+	info->src_height = intel_reg_field_get(INTEL_FIELD_PIPESRC_VSIZE, src) + 1;
+	info->interlace_mode = intel_reg_field_get(INTEL_FIELD_PIPECONF_INTERLACE, conf);
+	info->pf_enabled = intel_reg_field_get(INTEL_FIELD_PF_CTL_ENABLE, ctrl1);
+	info->dst_width = intel_reg_field_get(INTEL_FIELD_PF_WIN_X, win_sz);
+	info->dst_height = intel_reg_field_get(INTEL_FIELD_PF_WIN_Y, win_sz);
 }
 
 static void dump_pipe(int intel_pipe)
@@ -210,43 +208,34 @@ static int change_screen_size(int intel_pipe, int x, int y)
 	       intel_pipe + 'A', info.src_width, dst_width, info.src_height,
 	       dst_height, pos_x, pos_y);
 
-	ctrl1_val = PF_ENABLE | PF_FILTER_MED;
+	ctrl1_val = intel_reg_field_set(INTEL_FIELD_PF_CTL_ENABLE, 1) |
+		    intel_reg_field_set(INTEL_FIELD_PF_CTL_FILTER, PF_FILTER_MED);
 
 	/* This can break stuff if the panel fitter is already enabled for
 	 * another pipe */
 	if (gen >= 7) {
-		switch (intel_pipe) {
-		case 0:
-			ctrl1_val |= PF_PIPE_A;
-			break;
-		case 1:
-			ctrl1_val |= PF_PIPE_B;
-			break;
-		case 2:
-			ctrl1_val |= PF_PIPE_C;
-			break;
-		default:
-			assert(0);
-		}
+		assert(intel_pipe >= 0 && intel_pipe <= 2);
+		ctrl1_val |= intel_reg_field_set(INTEL_FIELD_PF_CTL_PIPE,
+						 intel_pipe);
 	}
-	OUTREG(PF_CTRL1[intel_pipe], ctrl1_val);
+	DESC_OUTREG(PF_CTRL1[intel_pipe], ctrl1_val);
 
-	win_pos_val = pos_x << 16;
-	win_pos_val |= pos_y;
-	OUTREG(PF_WIN_POS[intel_pipe], win_pos_val);
+	win_pos_val = intel_reg_field_set(INTEL_FIELD_PF_WIN_X, pos_x);
+	win_pos_val |= intel_reg_field_set(INTEL_FIELD_PF_WIN_Y, pos_y);
+	DESC_OUTREG(PF_WIN_POS[intel_pipe], win_pos_val);
 
-	win_sz_val = dst_width << 16;
-	win_sz_val |= dst_height;
-	OUTREG(PF_WIN_SZ[intel_pipe], win_sz_val);
+	win_sz_val = intel_reg_field_set(INTEL_FIELD_PF_WIN_X, dst_width);
+	win_sz_val |= intel_reg_field_set(INTEL_FIELD_PF_WIN_Y, dst_height);
+	DESC_OUTREG(PF_WIN_SZ[intel_pipe], win_sz_val);
 
 	return 0;
 }
 
 static int disable_panel_fitter(int intel_pipe)
 {
-	OUTREG(PF_CTRL1[intel_pipe], 0);
-	OUTREG(PF_WIN_POS[intel_pipe], 0);
-	OUTREG(PF_WIN_SZ[intel_pipe], 0);
+	DESC_OUTREG(PF_CTRL1[intel_pipe], 0);
+	DESC_OUTREG(PF_WIN_POS[intel_pipe], 0);
+	DESC_OUTREG(PF_WIN_SZ[intel_pipe], 0);
 	return 0;
 }
 
@@ -32,12 +32,45 @@
 #include <stdio.h>
 #include <string.h>
 #include <err.h>
+#include <errno.h>
 #include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "intel_gpu_tools.h"
+#include "intel_reg_desc.h"
+
+/*
+ * Everything the decoders need to know about the registers they decode: the
+ * device they come from and where to read the other registers of the same
+ * snapshot. Keeping this per snapshot lets us decode several at once.
+ */
+struct dump_context {
+	uint32_t devid;
+	enum pch_type pch;
+	void *mmio;
+	size_t size;		/* 0 for the live device */
+	FILE *out;
+};
+
+#define CTX_HAS_CPT(ctx) ((ctx)->pch == PCH_CPT)
+
+static inline uint32_t
+dump_read(const struct dump_context *ctx, uint32_t reg)
+{
+	if (ctx->mmio == NULL || (ctx->size && reg + 4 > ctx->size))
+		return 0;
 
-static uint32_t devid = 0;
+	return *(volatile uint32_t *)((volatile char *)ctx->mmio + reg);
+}
 
-#define DEBUGSTRING(func) static void func(char *result, int len, int reg, uint32_t val)
+#define DEBUGSTRING(func) static void func(const struct dump_context *ctx, \
+					   char *result, int len, int reg, uint32_t val)
 
 DEBUGSTRING(i830_16bit_func)
 {
@@ -48,10 +81,10 @@ DEBUGSTRING(i830_debug_dcc)
 {
 	const char *addressing = NULL;
 
-	if (!IS_MOBILE(devid))
+	if (!IS_MOBILE(ctx->devid))
 		return;
 
-	if (IS_965(devid)) {
+	if (IS_965(ctx->devid)) {
 		if (val & (1 << 1))
 			addressing = "dual channel interleaved";
 		else
@@ -109,50 +142,18 @@ DEBUGSTRING(i830_debug_chdecmisc)
 		 (val & (1 << 0)) ? "" : "not ");
 }
 
-DEBUGSTRING(i830_debug_xyminus1)
-{
-	snprintf(result, len, "%d, %d", (val & 0xffff) + 1,
-		 ((val & 0xffff0000) >> 16) + 1);
-}
-
-DEBUGSTRING(i830_debug_yxminus1)
-{
-	snprintf(result, len, "%d, %d", ((val & 0xffff0000) >> 16) + 1,
-		 (val & 0xffff) + 1);
-}
-
-DEBUGSTRING(i830_debug_xy)
-{
-	snprintf(result, len, "%d, %d", (val & 0xffff), ((val & 0xffff0000) >> 16));
-}
-
-DEBUGSTRING(i830_debug_dspstride)
-{
-	snprintf(result, len, "%d bytes", val);
-}
-
-DEBUGSTRING(i830_debug_dspcntr)
-{
-	const char *enabled = val & DISPLAY_PLANE_ENABLE ? "enabled" : "disabled";
-	char plane = val & DISPPLANE_SEL_PIPE_B ? 'B' : 'A';
-	if (HAS_PCH_SPLIT(devid))
-		snprintf(result, len, "%s", enabled);
-	else
-		snprintf(result, len, "%s, pipe %c", enabled, plane);
-}
-
 DEBUGSTRING(i830_debug_pipeconf)
 {
 	const char *enabled = val & PIPEACONF_ENABLE ? "enabled" : "disabled";
 	const char *bit30, *interlace;
 
-	if (IS_965(devid))
+	if (IS_965(ctx->devid))
 		bit30 = val & I965_PIPECONF_ACTIVE ? "active" : "inactive";
 	else
 		bit30 =
 		    val & PIPEACONF_DOUBLE_WIDE ? "double-wide" : "single-wide";
 
-	if (HAS_PCH_SPLIT(devid)) {
+	if (HAS_PCH_SPLIT(ctx->devid)) {
 		const char *bpc, *rotation;
 
 		switch ((val >> 21) & 7) {
@@ -210,7 +211,7 @@ DEBUGSTRING(i830_debug_pipeconf)
 		}
 		snprintf(result, len, "%s, %s, %s, %s, %s", enabled, bit30,
 			 interlace, rotation, bpc);
-	} else if (IS_GEN4(devid)) {
+	} else if (IS_GEN4(ctx->devid)) {
 		switch ((val >> 21) & 7) {
 		case 0:
 		case 1:
@@ -236,86 +237,6 @@ DEBUGSTRING(i830_debug_pipeconf)
 		snprintf(result, len, "%s, %s", enabled, bit30);
 }
 
-DEBUGSTRING(i830_debug_pipestat)
-{
-	const char *_FIFO_UNDERRUN = val & FIFO_UNDERRUN ? " FIFO_UNDERRUN" : "";
-	const char *_CRC_ERROR_ENABLE =
-	    val & CRC_ERROR_ENABLE ? " CRC_ERROR_ENABLE" : "";
-	const char *_CRC_DONE_ENABLE =
-	    val & CRC_DONE_ENABLE ? " CRC_DONE_ENABLE" : "";
-	const char *_GMBUS_EVENT_ENABLE =
-	    val & GMBUS_EVENT_ENABLE ? " GMBUS_EVENT_ENABLE" : "";
-	const char *_VSYNC_INT_ENABLE =
-	    val & VSYNC_INT_ENABLE ? " VSYNC_INT_ENABLE" : "";
-	const char *_DLINE_COMPARE_ENABLE =
-	    val & DLINE_COMPARE_ENABLE ? " DLINE_COMPARE_ENABLE" : "";
-	const char *_DPST_EVENT_ENABLE =
-	    val & DPST_EVENT_ENABLE ? " DPST_EVENT_ENABLE" : "";
-	const char *_LBLC_EVENT_ENABLE =
-	    val & LBLC_EVENT_ENABLE ? " LBLC_EVENT_ENABLE" : "";
-	const char *_OFIELD_INT_ENABLE =
-	    val & OFIELD_INT_ENABLE ? " OFIELD_INT_ENABLE" : "";
-	const char *_EFIELD_INT_ENABLE =
-	    val & EFIELD_INT_ENABLE ? " EFIELD_INT_ENABLE" : "";
-	const char *_SVBLANK_INT_ENABLE =
-	    val & SVBLANK_INT_ENABLE ? " SVBLANK_INT_ENABLE" : "";
-	const char *_VBLANK_INT_ENABLE =
-	    val & VBLANK_INT_ENABLE ? " VBLANK_INT_ENABLE" : "";
-	const char *_OREG_UPDATE_ENABLE =
-	    val & OREG_UPDATE_ENABLE ? " OREG_UPDATE_ENABLE" : "";
-	const char *_CRC_ERROR_INT_STATUS =
-	    val & CRC_ERROR_INT_STATUS ? " CRC_ERROR_INT_STATUS" : "";
-	const char *_CRC_DONE_INT_STATUS =
-	    val & CRC_DONE_INT_STATUS ? " CRC_DONE_INT_STATUS" : "";
-	const char *_GMBUS_INT_STATUS =
-	    val & GMBUS_INT_STATUS ? " GMBUS_INT_STATUS" : "";
-	const char *_VSYNC_INT_STATUS =
-	    val & VSYNC_INT_STATUS ? " VSYNC_INT_STATUS" : "";
-	const char *_DLINE_COMPARE_STATUS =
-	    val & DLINE_COMPARE_STATUS ? " DLINE_COMPARE_STATUS" : "";
-	const char *_DPST_EVENT_STATUS =
-	    val & DPST_EVENT_STATUS ? " DPST_EVENT_STATUS" : "";
-	const char *_LBLC_EVENT_STATUS =
-	    val & LBLC_EVENT_STATUS ? " LBLC_EVENT_STATUS" : "";
-	const char *_OFIELD_INT_STATUS =
-	    val & OFIELD_INT_STATUS ? " OFIELD_INT_STATUS" : "";
-	const char *_EFIELD_INT_STATUS =
-	    val & EFIELD_INT_STATUS ? " EFIELD_INT_STATUS" : "";
-	const char *_SVBLANK_INT_STATUS =
-	    val & SVBLANK_INT_STATUS ? " SVBLANK_INT_STATUS" : "";
-	const char *_VBLANK_INT_STATUS =
-	    val & VBLANK_INT_STATUS ? " VBLANK_INT_STATUS" : "";
-	const char *_OREG_UPDATE_STATUS =
-	    val & OREG_UPDATE_STATUS ? " OREG_UPDATE_STATUS" : "";
-	snprintf(result, len,
-		 "status:%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s",
-		 _FIFO_UNDERRUN,
-		 _CRC_ERROR_ENABLE,
-		 _CRC_DONE_ENABLE,
-		 _GMBUS_EVENT_ENABLE,
-		 _VSYNC_INT_ENABLE,
-		 _DLINE_COMPARE_ENABLE,
-		 _DPST_EVENT_ENABLE,
-		 _LBLC_EVENT_ENABLE,
-		 _OFIELD_INT_ENABLE,
-		 _EFIELD_INT_ENABLE,
-		 _SVBLANK_INT_ENABLE,
-		 _VBLANK_INT_ENABLE,
-		 _OREG_UPDATE_ENABLE,
-		 _CRC_ERROR_INT_STATUS,
-		 _CRC_DONE_INT_STATUS,
-		 _GMBUS_INT_STATUS,
-		 _VSYNC_INT_STATUS,
-		 _DLINE_COMPARE_STATUS,
-		 _DPST_EVENT_STATUS,
-		 _LBLC_EVENT_STATUS,
-		 _OFIELD_INT_STATUS,
-		 _EFIELD_INT_STATUS,
-		 _SVBLANK_INT_STATUS,
-		 _VBLANK_INT_STATUS,
-		 _OREG_UPDATE_STATUS);
-}
-
 DEBUGSTRING(ivb_debug_port)
 {
 	const char *drrs = NULL;
@@ -334,29 +255,9 @@ DEBUGSTRING(ivb_debug_port)
 			drrs);
 }
 
-DEBUGSTRING(i830_debug_hvtotal)
-{
-	snprintf(result, len, "%d active, %d total",
-		 (val & 0xffff) + 1,
-		 ((val & 0xffff0000) >> 16) + 1);
-}
-
-DEBUGSTRING(i830_debug_hvsyncblank)
-{
-	snprintf(result, len, "%d start, %d end",
-		 (val & 0xffff) + 1,
-		 ((val & 0xffff0000) >> 16) + 1);
-}
-
-DEBUGSTRING(i830_debug_vgacntrl)
-{
-	snprintf(result, len, "%s",
-		 val & VGA_DISP_DISABLE ? "disabled" : "enabled");
-}
-
 DEBUGSTRING(i830_debug_fp)
 {
-	if (IS_IGD(devid)) {
+	if (IS_IGD(ctx->devid)) {
 		snprintf(result, len, "n = %d, m1 = %d, m2 = %d",
 			 ffs((val & FP_N_IGD_DIV_MASK) >>
 			     FP_N_DIV_SHIFT) - 1,
@@ -430,14 +331,14 @@ DEBUGSTRING(i830_debug_dpll)
 	char sdvoextra[20];
 	int p1, p2 = 0;
 
-	if (IS_GEN2(devid)) {
-		char is_lvds = (INREG(LVDS) & LVDS_PORT_EN) && (reg == DPLL_B);
+	if (IS_GEN2(ctx->devid)) {
+		char is_lvds = (dump_read(ctx, LVDS) & LVDS_PORT_EN) && (reg == DPLL_B);
 
 		if (is_lvds) {
 			mode = "LVDS";
 			p1 = ffs((val & DPLL_FPA01_P1_POST_DIV_MASK_I830_LVDS)
 				 >> DPLL_FPA01_P1_POST_DIV_SHIFT);
-			if ((INREG(LVDS) & LVDS_CLKB_POWER_MASK) ==
+			if ((dump_read(ctx, LVDS) & LVDS_CLKB_POWER_MASK) ==
 			    LVDS_CLKB_POWER_UP)
 				p2 = 7;
 			else
@@ -458,7 +359,7 @@ DEBUGSTRING(i830_debug_dpll)
 				p2 = 2;
 		}
 	} else {
-		if (IS_IGD(devid)) {
+		if (IS_IGD(ctx->devid)) {
 			p1 = ffs((val & DPLL_FPA01_P1_POST_DIV_MASK_IGD) >>
 				 DPLL_FPA01_P1_POST_DIV_SHIFT_IGD);
 		} else {
@@ -493,7 +394,7 @@ DEBUGSTRING(i830_debug_dpll)
 		break;
 	}
 
-	if (IS_945(devid)) {
+	if (IS_945(ctx->devid)) {
 		sprintf(sdvoextra, ", SDVO mult %d",
 			(int)((val & SDVO_MULTIPLIER_MASK) >>
 			      SDVO_MULTIPLIER_SHIFT_HIRES) + 1);
@@ -530,10 +431,10 @@ DEBUGSTRING(i830_debug_adpa)
 	char hsync = (val & ADPA_HSYNC_ACTIVE_HIGH) ? '+' : '-';
 	char vsync = (val & ADPA_VSYNC_ACTIVE_HIGH) ? '+' : '-';
 
-	if (HAS_CPT)
+	if (CTX_HAS_CPT(ctx))
 		disp_pipe = val & (1<<29) ? 'B' : 'A';
 
-	if (HAS_PCH_SPLIT(devid))
+	if (HAS_PCH_SPLIT(ctx->devid))
 		snprintf(result, len, "%s, transcoder %c, %chsync, %cvsync",
 				 enable, disp_pipe, hsync, vsync);
 	else
@@ -557,7 +458,7 @@ DEBUGSTRING(i830_debug_lvds)
 	else
 		channels = "1 channel";
 
-	if (HAS_CPT)
+	if (CTX_HAS_CPT(ctx))
 		disp_pipe = val & (1<<29) ? 'B' : 'A';
 
 	snprintf(result, len, "%s, pipe %c, %d bit, %s",
@@ -600,7 +501,7 @@ DEBUGSTRING(i830_debug_sdvo)
 	const char *gang = val & SDVOC_GANG_MODE ? ", gang mode" : "";
 	char sdvoextra[20];
 
-	if (IS_915(devid)) {
+	if (IS_915(ctx->devid)) {
 		sprintf(sdvoextra, ", SDVO mult %d",
 			(int)((val & SDVO_PORT_MULTIPLY_MASK) >>
 			      SDVO_PORT_MULTIPLY_SHIFT) + 1);
@@ -663,7 +564,7 @@ DEBUGSTRING(i810_debug_915_fence)
 	unsigned int offset = val & 0x0ff00000;
 	int size = (1024 * 1024) << ((val & 0x700) >> 8);
 
-	if (IS_965(devid) || (IS_915(devid) && reg >= FENCE_NEW))
+	if (IS_965(ctx->devid) || (IS_915(ctx->devid) && reg >= FENCE_NEW))
 		return;
 
 	if (format == 'X')
@@ -684,7 +585,7 @@ DEBUGSTRING(i810_debug_965_fence_start)
 	int pitch = ((val & 0xffc) >> 2) * 128 + 128;
 	unsigned int offset = val & 0xfffff000;
 
-	if (!IS_965(devid))
+	if (!IS_965(ctx->devid))
 		return;
 
 	snprintf(result, len, "%s, %c tile walk, %4d pitch, 0x%08x start",
@@ -695,7 +596,7 @@ DEBUGSTRING(i810_debug_965_fence_end)
 {
 	unsigned int end = val & 0xfffff000;
 
-	if (!IS_965(devid))
+	if (!IS_965(ctx->devid))
 		return;
 
 	snprintf(result, len, "                                   0x%08x end", end);
@@ -708,10 +609,21 @@ DEBUGSTRING(i810_debug_965_fence_end)
 #define DEFINEREG2(reg, func) \
 	{ reg, #reg, func, 0 }
 
+/*
+ * Registers described by intel_reg_desc.def. Without a decoder they get the
+ * generic decode of their fields, DEFINEDESC2 is for the ones that need more
+ * than their own fields (other registers, the device) to make sense.
+ */
+#define DEFINEDESC(reg) \
+	{ INTEL_REG_OFFSET_##reg, #reg, NULL, 0 }
+#define DEFINEDESC2(reg, func) \
+	{ INTEL_REG_OFFSET_##reg, #reg, func, 0 }
+
 struct reg_debug {
 	int reg;
 	const char *name;
-	void (*debug_output) (char *result, int len, int reg, uint32_t val);
+	void (*debug_output) (const struct dump_context *ctx,
+			      char *result, int len, int reg, uint32_t val);
 	uint32_t val;
 };
 
@@ -733,10 +645,10 @@ static struct reg_debug intel_debug_regs[] = {
 
 	DEFINEREG(PGETBL_CTL),
 
-	DEFINEREG2(VCLK_DIVISOR_VGA0, i830_debug_fp),
-	DEFINEREG2(VCLK_DIVISOR_VGA1, i830_debug_fp),
-	DEFINEREG2(VCLK_POST_DIV, i830_debug_vga_pd),
-	DEFINEREG2(DPLL_TEST, i830_debug_dpll_test),
+	DEFINEDESC2(VCLK_DIVISOR_VGA0, i830_debug_fp),
+	DEFINEDESC2(VCLK_DIVISOR_VGA1, i830_debug_fp),
+	DEFINEDESC2(VCLK_POST_DIV, i830_debug_vga_pd),
+	DEFINEDESC2(DPLL_TEST, i830_debug_dpll_test),
 	DEFINEREG(CACHE_MODE_0),
 	DEFINEREG(D_STATE),
 	DEFINEREG2(DSPCLK_GATE_D, i830_debug_dspclk_gate_d),
@@ -775,72 +687,72 @@ static struct reg_debug intel_debug_regs[] = {
 	DEFINEREG(PORT_HOTPLUG_EN),
 	DEFINEREG(PORT_HOTPLUG_STAT),
 
-	DEFINEREG2(DSPACNTR, i830_debug_dspcntr),
-	DEFINEREG2(DSPASTRIDE, i830_debug_dspstride),
-	DEFINEREG2(DSPAPOS, i830_debug_xy),
-	DEFINEREG2(DSPASIZE, i830_debug_xyminus1),
-	DEFINEREG(DSPABASE),
-	DEFINEREG(DSPASURF),
-	DEFINEREG(DSPATILEOFF),
-	DEFINEREG2(PIPEACONF, i830_debug_pipeconf),
-	DEFINEREG2(PIPEASRC, i830_debug_yxminus1),
-	DEFINEREG2(PIPEASTAT, i830_debug_pipestat),
-	DEFINEREG(PIPEA_GMCH_DATA_M),
-	DEFINEREG(PIPEA_GMCH_DATA_N),
-	DEFINEREG(PIPEA_DP_LINK_M),
-	DEFINEREG(PIPEA_DP_LINK_N),
-	DEFINEREG(CURSOR_A_BASE),
-	DEFINEREG(CURSOR_A_CONTROL),
-	DEFINEREG(CURSOR_A_POSITION),
-
-	DEFINEREG2(FPA0, i830_debug_fp),
-	DEFINEREG2(FPA1, i830_debug_fp),
-	DEFINEREG2(DPLL_A, i830_debug_dpll),
-	DEFINEREG(DPLL_A_MD),
-	DEFINEREG2(HTOTAL_A, i830_debug_hvtotal),
-	DEFINEREG2(HBLANK_A, i830_debug_hvsyncblank),
-	DEFINEREG2(HSYNC_A, i830_debug_hvsyncblank),
-	DEFINEREG2(VTOTAL_A, i830_debug_hvtotal),
-	DEFINEREG2(VBLANK_A, i830_debug_hvsyncblank),
-	DEFINEREG2(VSYNC_A, i830_debug_hvsyncblank),
-	DEFINEREG(BCLRPAT_A),
-	DEFINEREG(VSYNCSHIFT_A),
-
-	DEFINEREG2(DSPBCNTR, i830_debug_dspcntr),
-	DEFINEREG2(DSPBSTRIDE, i830_debug_dspstride),
-	DEFINEREG2(DSPBPOS, i830_debug_xy),
-	DEFINEREG2(DSPBSIZE, i830_debug_xyminus1),
-	DEFINEREG(DSPBBASE),
-	DEFINEREG(DSPBSURF),
-	DEFINEREG(DSPBTILEOFF),
-	DEFINEREG2(PIPEBCONF, i830_debug_pipeconf),
-	DEFINEREG2(PIPEBSRC, i830_debug_yxminus1),
-	DEFINEREG2(PIPEBSTAT, i830_debug_pipestat),
-	DEFINEREG(PIPEB_GMCH_DATA_M),
-	DEFINEREG(PIPEB_GMCH_DATA_N),
-	DEFINEREG(PIPEB_DP_LINK_M),
-	DEFINEREG(PIPEB_DP_LINK_N),
-	DEFINEREG(CURSOR_B_BASE),
-	DEFINEREG(CURSOR_B_CONTROL),
-	DEFINEREG(CURSOR_B_POSITION),
-
-	DEFINEREG2(FPB0, i830_debug_fp),
-	DEFINEREG2(FPB1, i830_debug_fp),
-	DEFINEREG2(DPLL_B, i830_debug_dpll),
-	DEFINEREG(DPLL_B_MD),
-	DEFINEREG2(HTOTAL_B, i830_debug_hvtotal),
-	DEFINEREG2(HBLANK_B, i830_debug_hvsyncblank),
-	DEFINEREG2(HSYNC_B, i830_debug_hvsyncblank),
-	DEFINEREG2(VTOTAL_B, i830_debug_hvtotal),
-	DEFINEREG2(VBLANK_B, i830_debug_hvsyncblank),
-	DEFINEREG2(VSYNC_B, i830_debug_hvsyncblank),
-	DEFINEREG(BCLRPAT_B),
-	DEFINEREG(VSYNCSHIFT_B),
-
-	DEFINEREG(VCLK_DIVISOR_VGA0),
-	DEFINEREG(VCLK_DIVISOR_VGA1),
-	DEFINEREG(VCLK_POST_DIV),
-	DEFINEREG2(VGACNTRL, i830_debug_vgacntrl),
+	DEFINEDESC(DSPACNTR),
+	DEFINEDESC(DSPASTRIDE),
+	DEFINEDESC(DSPAPOS),
+	DEFINEDESC(DSPASIZE),
+	DEFINEDESC(DSPABASE),
+	DEFINEDESC(DSPASURF),
+	DEFINEDESC(DSPATILEOFF),
+	DEFINEDESC2(PIPEACONF, i830_debug_pipeconf),
+	DEFINEDESC(PIPEASRC),
+	DEFINEDESC(PIPEASTAT),
+	DEFINEDESC(PIPEA_GMCH_DATA_M),
+	DEFINEDESC(PIPEA_GMCH_DATA_N),
+	DEFINEDESC(PIPEA_DP_LINK_M),
+	DEFINEDESC(PIPEA_DP_LINK_N),
+	DEFINEDESC(CURSOR_A_BASE),
+	DEFINEDESC(CURSOR_A_CONTROL),
+	DEFINEDESC(CURSOR_A_POSITION),
+
+	DEFINEDESC2(FPA0, i830_debug_fp),
+	DEFINEDESC2(FPA1, i830_debug_fp),
+	DEFINEDESC2(DPLL_A, i830_debug_dpll),
+	DEFINEDESC(DPLL_A_MD),
+	DEFINEDESC(HTOTAL_A),
+	DEFINEDESC(HBLANK_A),
+	DEFINEDESC(HSYNC_A),
+	DEFINEDESC(VTOTAL_A),
+	DEFINEDESC(VBLANK_A),
+	DEFINEDESC(VSYNC_A),
+	DEFINEDESC(BCLRPAT_A),
+	DEFINEDESC(VSYNCSHIFT_A),
+
+	DEFINEDESC(DSPBCNTR),
+	DEFINEDESC(DSPBSTRIDE),
+	DEFINEDESC(DSPBPOS),
+	DEFINEDESC(DSPBSIZE),
+	DEFINEDESC(DSPBBASE),
+	DEFINEDESC(DSPBSURF),
+	DEFINEDESC(DSPBTILEOFF),
+	DEFINEDESC2(PIPEBCONF, i830_debug_pipeconf),
+	DEFINEDESC(PIPEBSRC),
+	DEFINEDESC(PIPEBSTAT),
+	DEFINEDESC(PIPEB_GMCH_DATA_M),
+	DEFINEDESC(PIPEB_GMCH_DATA_N),
+	DEFINEDESC(PIPEB_DP_LINK_M),
+	DEFINEDESC(PIPEB_DP_LINK_N),
+	DEFINEDESC(CURSOR_B_BASE),
+	DEFINEDESC(CURSOR_B_CONTROL),
+	DEFINEDESC(CURSOR_B_POSITION),
+
+	DEFINEDESC2(FPB0, i830_debug_fp),
+	DEFINEDESC2(FPB1, i830_debug_fp),
+	DEFINEDESC2(DPLL_B, i830_debug_dpll),
+	DEFINEDESC(DPLL_B_MD),
+	DEFINEDESC(HTOTAL_B),
+	DEFINEDESC(HBLANK_B),
+	DEFINEDESC(HSYNC_B),
+	DEFINEDESC(VTOTAL_B),
+	DEFINEDESC(VBLANK_B),
+	DEFINEDESC(VSYNC_B),
+	DEFINEDESC(BCLRPAT_B),
+	DEFINEDESC(VSYNCSHIFT_B),
+
+	DEFINEDESC(VCLK_DIVISOR_VGA0),
+	DEFINEDESC(VCLK_DIVISOR_VGA1),
+	DEFINEDESC(VCLK_POST_DIV),
+	DEFINEDESC(VGACNTRL),
 
 	DEFINEREG(TV_CTL),
 	DEFINEREG(TV_DAC),
@@ -981,17 +893,6 @@ DEBUGSTRING(ironlake_debug_rr_hw_ctl)
 		 (val & RR_HW_HIGH_POWER_FRAMES_MASK) >> 8);
 }
 
-DEBUGSTRING(ironlake_debug_m_tu)
-{
-	snprintf(result, len, "TU %d, val 0x%x %d", (val >> 25) + 1, val & 0xffffff,
-		 val & 0xffffff);
-}
-
-DEBUGSTRING(ironlake_debug_n)
-{
-	snprintf(result, len, "val 0x%x %d", val & 0xffffff, val & 0xffffff);
-}
-
 DEBUGSTRING(ironlake_debug_fdi_tx_ctl)
 {
 	const char *train = NULL, *voltage = NULL, *pre_emphasis = NULL, *portw =
@@ -1012,7 +913,7 @@ DEBUGSTRING(ironlake_debug_fdi_tx_ctl)
 		break;
 	}
 
-	if (HAS_CPT) {
+	if (CTX_HAS_CPT(ctx)) {
 		/* SNB B0 */
 		switch (val & (0x3f << 22)) {
 		case FDI_LINK_TRAIN_400MV_0DB_SNB_B:
@@ -1101,7 +1002,7 @@ DEBUGSTRING(ironlake_debug_fdi_rx_ctl)
 {
 	const char *train = NULL, *portw = NULL, *bpc = NULL;
 
-	if (HAS_CPT) {
+	if (CTX_HAS_CPT(ctx)) {
 		switch (val & FDI_LINK_TRAIN_PATTERN_MASK_CPT) {
 		case FDI_LINK_TRAIN_PATTERN_1_CPT:
 			train = "pattern_1";
@@ -1181,11 +1082,6 @@ DEBUGSTRING(ironlake_debug_fdi_rx_ctl)
 		 "disable", val & FDI_SEL_PCDCLK ? "PCDClk" : "RawClk");
 }
 
-DEBUGSTRING(ironlake_debug_dspstride)
-{
-	snprintf(result, len, "%d", val >> 6);
-}
-
 DEBUGSTRING(ironlake_debug_pch_dpll)
 {
 	const char *enable = val & DPLL_VCO_ENABLE ? "enable" : "disable";
@@ -1312,32 +1208,6 @@ DEBUGSTRING(ironlake_debug_fdi_rx_misc)
 	snprintf(result, len, "FDI Delay %d", val & ((1 << 13) - 1));
 }
 
-DEBUGSTRING(ironlake_debug_transconf)
-{
-	const char *enable = val & TRANS_ENABLE ? "enable" : "disable";
-	const char *state = val & TRANS_STATE_ENABLE ? "active" : "inactive";
-	const char *interlace;
-
-	switch ((val >> 21) & 7) {
-	case 0:
-		interlace = "progressive";
-		break;
-	case 2:
-		if (IS_GEN5(devid))
-			interlace = "interlaced sdvo";
-		else
-			interlace = "rsvd";
-		break;
-	case 3:
-		interlace = "interlaced";
-		break;
-	default:
-		interlace = "rsvd";
-	}
-
-	snprintf(result, len, "%s, %s, %s", enable, state, interlace);
-}
-
 DEBUGSTRING(ironlake_debug_panel_fitting)
 {
 	const char *vadapt = NULL, *filter_sel = NULL;
@@ -1408,16 +1278,6 @@ DEBUGSTRING(ironlake_debug_panel_fitting_4)
 		 val / (float) (1<<15));
 }
 
-DEBUGSTRING(ironlake_debug_pf_win)
-{
-	int a, b;
-
-	a = (val >> 16) & 0x1fff;
-	b = val & 0xfff;
-
-	snprintf(result, len, "%d, %d", a, b);
-}
-
 DEBUGSTRING(ironlake_debug_hdmi)
 {
 	int disp_pipe;
@@ -1429,7 +1289,7 @@ DEBUGSTRING(ironlake_debug_hdmi)
 	else
 		enable = "disabled";
 
-	if (HAS_CPT)
+	if (CTX_HAS_CPT(ctx))
 		disp_pipe = (val & (3<<29)) >> 29;
 	else
 		disp_pipe = (val & TRANSCODER_B) >> 29;
@@ -1482,7 +1342,7 @@ DEBUGSTRING(snb_debug_dpll_sel)
 	const char *transa, *transb;
 	const char *dplla = NULL, *dpllb = NULL;
 
-	if (!HAS_CPT)
+	if (!CTX_HAS_CPT(ctx))
 		return;
 
 	if (val & TRANSA_DPLL_ENABLE) {
@@ -1511,7 +1371,7 @@ DEBUGSTRING(snb_debug_trans_dp_ctl)
 {
 	const char *enable, *port = NULL, *bpc = NULL, *vsync, *hsync;
 
-	if (!HAS_CPT)
+	if (!CTX_HAS_CPT(ctx))
 		return;
 
 	if (val & TRANS_DP_OUTPUT_ENABLE)
@@ -1575,7 +1435,7 @@ static struct reg_debug ironlake_debug_regs[] = {
 	DEFINEREG(PGETBL_CTL),
 	DEFINEREG(GEN6_INSTDONE_1),
 	DEFINEREG(GEN6_INSTDONE_2),
-	DEFINEREG2(CPU_VGACNTRL, i830_debug_vgacntrl),
+	DEFINEDESC(CPU_VGACNTRL),
 	DEFINEREG(DIGITAL_PORT_HOTPLUG_CNTRL),
 
 	DEFINEREG2(RR_HW_CTL, ironlake_debug_rr_hw_ctl),
@@ -1592,183 +1452,183 @@ static struct reg_debug ironlake_debug_regs[] = {
 
 	/* pipe B */
 
-	DEFINEREG2(PIPEACONF, i830_debug_pipeconf),
-
-	DEFINEREG2(HTOTAL_A, i830_debug_hvtotal),
-	DEFINEREG2(HBLANK_A, i830_debug_hvsyncblank),
-	DEFINEREG2(HSYNC_A, i830_debug_hvsyncblank),
-	DEFINEREG2(VTOTAL_A, i830_debug_hvtotal),
-	DEFINEREG2(VBLANK_A, i830_debug_hvsyncblank),
-	DEFINEREG2(VSYNC_A, i830_debug_hvsyncblank),
-	DEFINEREG(VSYNCSHIFT_A),
-	DEFINEREG2(PIPEASRC, i830_debug_yxminus1),
-
-	DEFINEREG2(PIPEA_DATA_M1, ironlake_debug_m_tu),
-	DEFINEREG2(PIPEA_DATA_N1, ironlake_debug_n),
-	DEFINEREG2(PIPEA_DATA_M2, ironlake_debug_m_tu),
-	DEFINEREG2(PIPEA_DATA_N2, ironlake_debug_n),
-
-	DEFINEREG2(PIPEA_LINK_M1, ironlake_debug_n),
-	DEFINEREG2(PIPEA_LINK_N1, ironlake_debug_n),
-	DEFINEREG2(PIPEA_LINK_M2, ironlake_debug_n),
-	DEFINEREG2(PIPEA_LINK_N2, ironlake_debug_n),
-
-	DEFINEREG2(DSPACNTR, i830_debug_dspcntr),
-	DEFINEREG(DSPABASE),
-	DEFINEREG2(DSPASTRIDE, ironlake_debug_dspstride),
-	DEFINEREG(DSPASURF),
-	DEFINEREG2(DSPATILEOFF, i830_debug_xy),
+	DEFINEDESC2(PIPEACONF, i830_debug_pipeconf),
+
+	DEFINEDESC(HTOTAL_A),
+	DEFINEDESC(HBLANK_A),
+	DEFINEDESC(HSYNC_A),
+	DEFINEDESC(VTOTAL_A),
+	DEFINEDESC(VBLANK_A),
+	DEFINEDESC(VSYNC_A),
+	DEFINEDESC(VSYNCSHIFT_A),
+	DEFINEDESC(PIPEASRC),
+
+	DEFINEDESC(PIPEA_DATA_M1),
+	DEFINEDESC(PIPEA_DATA_N1),
+	DEFINEDESC(PIPEA_DATA_M2),
+	DEFINEDESC(PIPEA_DATA_N2),
+
+	DEFINEDESC(PIPEA_LINK_M1),
+	DEFINEDESC(PIPEA_LINK_N1),
+	DEFINEDESC(PIPEA_LINK_M2),
+	DEFINEDESC(PIPEA_LINK_N2),
+
+	DEFINEDESC(DSPACNTR),
+	DEFINEDESC(DSPABASE),
+	DEFINEDESC(DSPASTRIDE),
+	DEFINEDESC(DSPASURF),
+	DEFINEDESC(DSPATILEOFF),
 
 	/* pipe B */
 
-	DEFINEREG2(PIPEBCONF, i830_debug_pipeconf),
-
-	DEFINEREG2(HTOTAL_B, i830_debug_hvtotal),
-	DEFINEREG2(HBLANK_B, i830_debug_hvsyncblank),
-	DEFINEREG2(HSYNC_B, i830_debug_hvsyncblank),
-	DEFINEREG2(VTOTAL_B, i830_debug_hvtotal),
-	DEFINEREG2(VBLANK_B, i830_debug_hvsyncblank),
-	DEFINEREG2(VSYNC_B, i830_debug_hvsyncblank),
-	DEFINEREG(VSYNCSHIFT_B),
-	DEFINEREG2(PIPEBSRC, i830_debug_yxminus1),
-
-	DEFINEREG2(PIPEB_DATA_M1, ironlake_debug_m_tu),
-	DEFINEREG2(PIPEB_DATA_N1, ironlake_debug_n),
-	DEFINEREG2(PIPEB_DATA_M2, ironlake_debug_m_tu),
-	DEFINEREG2(PIPEB_DATA_N2, ironlake_debug_n),
-
-	DEFINEREG2(PIPEB_LINK_M1, ironlake_debug_n),
-	DEFINEREG2(PIPEB_LINK_N1, ironlake_debug_n),
-	DEFINEREG2(PIPEB_LINK_M2, ironlake_debug_n),
-	DEFINEREG2(PIPEB_LINK_N2, ironlake_debug_n),
-
-	DEFINEREG2(DSPBCNTR, i830_debug_dspcntr),
-	DEFINEREG(DSPBBASE),
-	DEFINEREG2(DSPBSTRIDE, ironlake_debug_dspstride),
-	DEFINEREG(DSPBSURF),
-	DEFINEREG2(DSPBTILEOFF, i830_debug_xy),
+	DEFINEDESC2(PIPEBCONF, i830_debug_pipeconf),
+
+	DEFINEDESC(HTOTAL_B),
+	DEFINEDESC(HBLANK_B),
+	DEFINEDESC(HSYNC_B),
+	DEFINEDESC(VTOTAL_B),
+	DEFINEDESC(VBLANK_B),
+	DEFINEDESC(VSYNC_B),
+	DEFINEDESC(VSYNCSHIFT_B),
+	DEFINEDESC(PIPEBSRC),
+
+	DEFINEDESC(PIPEB_DATA_M1),
+	DEFINEDESC(PIPEB_DATA_N1),
+	DEFINEDESC(PIPEB_DATA_M2),
+	DEFINEDESC(PIPEB_DATA_N2),
+
+	DEFINEDESC(PIPEB_LINK_M1),
+	DEFINEDESC(PIPEB_LINK_N1),
+	DEFINEDESC(PIPEB_LINK_M2),
+	DEFINEDESC(PIPEB_LINK_N2),
+
+	DEFINEDESC(DSPBCNTR),
+	DEFINEDESC(DSPBBASE),
+	DEFINEDESC(DSPBSTRIDE),
+	DEFINEDESC(DSPBSURF),
+	DEFINEDESC(DSPBTILEOFF),
 
 	/* pipe C */
 
-	DEFINEREG2(PIPECCONF, i830_debug_pipeconf),
-
-	DEFINEREG2(HTOTAL_C, i830_debug_hvtotal),
-	DEFINEREG2(HBLANK_C, i830_debug_hvsyncblank),
-	DEFINEREG2(HSYNC_C, i830_debug_hvsyncblank),
-	DEFINEREG2(VTOTAL_C, i830_debug_hvtotal),
-	DEFINEREG2(VBLANK_C, i830_debug_hvsyncblank),
-	DEFINEREG2(VSYNC_C, i830_debug_hvsyncblank),
-	DEFINEREG(VSYNCSHIFT_C),
-	DEFINEREG2(PIPECSRC, i830_debug_yxminus1),
-
-	DEFINEREG2(PIPEC_DATA_M1, ironlake_debug_m_tu),
-	DEFINEREG2(PIPEC_DATA_N1, ironlake_debug_n),
-	DEFINEREG2(PIPEC_DATA_M2, ironlake_debug_m_tu),
-	DEFINEREG2(PIPEC_DATA_N2, ironlake_debug_n),
-
-	DEFINEREG2(PIPEC_LINK_M1, ironlake_debug_n),
-	DEFINEREG2(PIPEC_LINK_N1, ironlake_debug_n),
-	DEFINEREG2(PIPEC_LINK_M2, ironlake_debug_n),
-	DEFINEREG2(PIPEC_LINK_N2, ironlake_debug_n),
-
-	DEFINEREG2(DSPCCNTR, i830_debug_dspcntr),
-	DEFINEREG(DSPCBASE),
-	DEFINEREG2(DSPCSTRIDE, ironlake_debug_dspstride),
-	DEFINEREG(DSPCSURF),
-	DEFINEREG2(DSPCTILEOFF, i830_debug_xy),
+	DEFINEDESC2(PIPECCONF, i830_debug_pipeconf),
+
+	DEFINEDESC(HTOTAL_C),
+	DEFINEDESC(HBLANK_C),
+	DEFINEDESC(HSYNC_C),
+	DEFINEDESC(VTOTAL_C),
+	DEFINEDESC(VBLANK_C),
+	DEFINEDESC(VSYNC_C),
+	DEFINEDESC(VSYNCSHIFT_C),
+	DEFINEDESC(PIPECSRC),
+
+	DEFINEDESC(PIPEC_DATA_M1),
+	DEFINEDESC(PIPEC_DATA_N1),
+	DEFINEDESC(PIPEC_DATA_M2),
+	DEFINEDESC(PIPEC_DATA_N2),
+
+	DEFINEDESC(PIPEC_LINK_M1),
+	DEFINEDESC(PIPEC_LINK_N1),
+	DEFINEDESC(PIPEC_LINK_M2),
+	DEFINEDESC(PIPEC_LINK_N2),
+
+	DEFINEDESC(DSPCCNTR),
+	DEFINEDESC(DSPCBASE),
+	DEFINEDESC(DSPCSTRIDE),
+	DEFINEDESC(DSPCSURF),
+	DEFINEDESC(DSPCTILEOFF),
 
 	/* Panel fitter */
 
-	DEFINEREG2(PFA_CTL_1, ironlake_debug_panel_fitting),
-	DEFINEREG2(PFA_CTL_2, ironlake_debug_panel_fitting_2),
-	DEFINEREG2(PFA_CTL_3, ironlake_debug_panel_fitting_3),
-	DEFINEREG2(PFA_CTL_4, ironlake_debug_panel_fitting_4),
-	DEFINEREG2(PFA_WIN_POS, ironlake_debug_pf_win),
-	DEFINEREG2(PFA_WIN_SIZE, ironlake_debug_pf_win),
-	DEFINEREG2(PFB_CTL_1, ironlake_debug_panel_fitting),
-	DEFINEREG2(PFB_CTL_2, ironlake_debug_panel_fitting_2),
-	DEFINEREG2(PFB_CTL_3, ironlake_debug_panel_fitting_3),
-	DEFINEREG2(PFB_CTL_4, ironlake_debug_panel_fitting_4),
-	DEFINEREG2(PFB_WIN_POS, ironlake_debug_pf_win),
-	DEFINEREG2(PFB_WIN_SIZE, ironlake_debug_pf_win),
-	DEFINEREG2(PFC_CTL_1, ironlake_debug_panel_fitting),
-	DEFINEREG2(PFC_CTL_2, ironlake_debug_panel_fitting_2),
-	DEFINEREG2(PFC_CTL_3, ironlake_debug_panel_fitting_3),
-	DEFINEREG2(PFC_CTL_4, ironlake_debug_panel_fitting_4),
-	DEFINEREG2(PFC_WIN_POS, ironlake_debug_pf_win),
-	DEFINEREG2(PFC_WIN_SIZE, ironlake_debug_pf_win),
+	DEFINEDESC2(PFA_CTL_1, ironlake_debug_panel_fitting),
+	DEFINEDESC2(PFA_CTL_2, ironlake_debug_panel_fitting_2),
+	DEFINEDESC2(PFA_CTL_3, ironlake_debug_panel_fitting_3),
+	DEFINEDESC2(PFA_CTL_4, ironlake_debug_panel_fitting_4),
+	DEFINEDESC(PFA_WIN_POS),
+	DEFINEDESC(PFA_WIN_SIZE),
+	DEFINEDESC2(PFB_CTL_1, ironlake_debug_panel_fitting),
+	DEFINEDESC2(PFB_CTL_2, ironlake_debug_panel_fitting_2),
+	DEFINEDESC2(PFB_CTL_3, ironlake_debug_panel_fitting_3),
+	DEFINEDESC2(PFB_CTL_4, ironlake_debug_panel_fitting_4),
+	DEFINEDESC(PFB_WIN_POS),
+	DEFINEDESC(PFB_WIN_SIZE),
+	DEFINEDESC2(PFC_CTL_1, ironlake_debug_panel_fitting),
+	DEFINEDESC2(PFC_CTL_2, ironlake_debug_panel_fitting_2),
+	DEFINEDESC2(PFC_CTL_3, ironlake_debug_panel_fitting_3),
+	DEFINEDESC2(PFC_CTL_4, ironlake_debug_panel_fitting_4),
+	DEFINEDESC(PFC_WIN_POS),
+	DEFINEDESC(PFC_WIN_SIZE),
 
 	/* PCH */
 
-	DEFINEREG2(PCH_DREF_CONTROL, ironlake_debug_dref_ctl),
-	DEFINEREG2(PCH_RAWCLK_FREQ, ironlake_debug_rawclk_freq),
-	DEFINEREG(PCH_DPLL_TMR_CFG),
-	DEFINEREG(PCH_SSC4_PARMS),
-	DEFINEREG(PCH_SSC4_AUX_PARMS),
-	DEFINEREG2(PCH_DPLL_SEL, snb_debug_dpll_sel),
-	DEFINEREG(PCH_DPLL_ANALOG_CTL),
-
-	DEFINEREG2(PCH_DPLL_A, ironlake_debug_pch_dpll),
-	DEFINEREG2(PCH_DPLL_B, ironlake_debug_pch_dpll),
-	DEFINEREG2(PCH_FPA0, i830_debug_fp),
-	DEFINEREG2(PCH_FPA1, i830_debug_fp),
-	DEFINEREG2(PCH_FPB0, i830_debug_fp),
-	DEFINEREG2(PCH_FPB1, i830_debug_fp),
-
-	DEFINEREG2(TRANS_HTOTAL_A, i830_debug_hvtotal),
-	DEFINEREG2(TRANS_HBLANK_A, i830_debug_hvsyncblank),
-	DEFINEREG2(TRANS_HSYNC_A, i830_debug_hvsyncblank),
-	DEFINEREG2(TRANS_VTOTAL_A, i830_debug_hvtotal),
-	DEFINEREG2(TRANS_VBLANK_A, i830_debug_hvsyncblank),
-	DEFINEREG2(TRANS_VSYNC_A, i830_debug_hvsyncblank),
-	DEFINEREG(TRANS_VSYNCSHIFT_A),
-
-	DEFINEREG2(TRANSA_DATA_M1, ironlake_debug_m_tu),
-	DEFINEREG2(TRANSA_DATA_N1, ironlake_debug_n),
-	DEFINEREG2(TRANSA_DATA_M2, ironlake_debug_m_tu),
-	DEFINEREG2(TRANSA_DATA_N2, ironlake_debug_n),
-	DEFINEREG2(TRANSA_DP_LINK_M1, ironlake_debug_n),
-	DEFINEREG2(TRANSA_DP_LINK_N1, ironlake_debug_n),
-	DEFINEREG2(TRANSA_DP_LINK_M2, ironlake_debug_n),
-	DEFINEREG2(TRANSA_DP_LINK_N2, ironlake_debug_n),
-
-	DEFINEREG2(TRANS_HTOTAL_B, i830_debug_hvtotal),
-	DEFINEREG2(TRANS_HBLANK_B, i830_debug_hvsyncblank),
-	DEFINEREG2(TRANS_HSYNC_B, i830_debug_hvsyncblank),
-	DEFINEREG2(TRANS_VTOTAL_B, i830_debug_hvtotal),
-	DEFINEREG2(TRANS_VBLANK_B, i830_debug_hvsyncblank),
-	DEFINEREG2(TRANS_VSYNC_B, i830_debug_hvsyncblank),
-	DEFINEREG(TRANS_VSYNCSHIFT_B),
-
-	DEFINEREG2(TRANSB_DATA_M1, ironlake_debug_m_tu),
-	DEFINEREG2(TRANSB_DATA_N1, ironlake_debug_n),
-	DEFINEREG2(TRANSB_DATA_M2, ironlake_debug_m_tu),
-	DEFINEREG2(TRANSB_DATA_N2, ironlake_debug_n),
-	DEFINEREG2(TRANSB_DP_LINK_M1, ironlake_debug_n),
-	DEFINEREG2(TRANSB_DP_LINK_N1, ironlake_debug_n),
-	DEFINEREG2(TRANSB_DP_LINK_M2, ironlake_debug_n),
-	DEFINEREG2(TRANSB_DP_LINK_N2, ironlake_debug_n),
-
-	DEFINEREG2(TRANS_HTOTAL_C, i830_debug_hvtotal),
-	DEFINEREG2(TRANS_HBLANK_C, i830_debug_hvsyncblank),
-	DEFINEREG2(TRANS_HSYNC_C, i830_debug_hvsyncblank),
-	DEFINEREG2(TRANS_VTOTAL_C, i830_debug_hvtotal),
-	DEFINEREG2(TRANS_VBLANK_C, i830_debug_hvsyncblank),
-	DEFINEREG2(TRANS_VSYNC_C, i830_debug_hvsyncblank),
-	DEFINEREG(TRANS_VSYNCSHIFT_C),
-
-	DEFINEREG2(TRANSC_DATA_M1, ironlake_debug_m_tu),
-	DEFINEREG2(TRANSC_DATA_N1, ironlake_debug_n),
-	DEFINEREG2(TRANSC_DATA_M2, ironlake_debug_m_tu),
-	DEFINEREG2(TRANSC_DATA_N2, ironlake_debug_n),
-	DEFINEREG2(TRANSC_DP_LINK_M1, ironlake_debug_n),
-	DEFINEREG2(TRANSC_DP_LINK_N1, ironlake_debug_n),
-	DEFINEREG2(TRANSC_DP_LINK_M2, ironlake_debug_n),
-	DEFINEREG2(TRANSC_DP_LINK_N2, ironlake_debug_n),
-
-	DEFINEREG2(TRANSACONF, ironlake_debug_transconf),
-	DEFINEREG2(TRANSBCONF, ironlake_debug_transconf),
-	DEFINEREG2(TRANSCCONF, ironlake_debug_transconf),
+	DEFINEDESC2(PCH_DREF_CONTROL, ironlake_debug_dref_ctl),
+	DEFINEDESC2(PCH_RAWCLK_FREQ, ironlake_debug_rawclk_freq),
+	DEFINEDESC(PCH_DPLL_TMR_CFG),
+	DEFINEDESC(PCH_SSC4_PARMS),
+	DEFINEDESC(PCH_SSC4_AUX_PARMS),
+	DEFINEDESC2(PCH_DPLL_SEL, snb_debug_dpll_sel),
+	DEFINEDESC(PCH_DPLL_ANALOG_CTL),
+
+	DEFINEDESC2(PCH_DPLL_A, ironlake_debug_pch_dpll),
+	DEFINEDESC2(PCH_DPLL_B, ironlake_debug_pch_dpll),
+	DEFINEDESC2(PCH_FPA0, i830_debug_fp),
+	DEFINEDESC2(PCH_FPA1, i830_debug_fp),
+	DEFINEDESC2(PCH_FPB0, i830_debug_fp),
+	DEFINEDESC2(PCH_FPB1, i830_debug_fp),
+
+	DEFINEDESC(TRANS_HTOTAL_A),
+	DEFINEDESC(TRANS_HBLANK_A),
+	DEFINEDESC(TRANS_HSYNC_A),
+	DEFINEDESC(TRANS_VTOTAL_A),
+	DEFINEDESC(TRANS_VBLANK_A),
+	DEFINEDESC(TRANS_VSYNC_A),
+	DEFINEDESC(TRANS_VSYNCSHIFT_A),
+
+	DEFINEDESC(TRANSA_DATA_M1),
+	DEFINEDESC(TRANSA_DATA_N1),
+	DEFINEDESC(TRANSA_DATA_M2),
+	DEFINEDESC(TRANSA_DATA_N2),
+	DEFINEDESC(TRANSA_DP_LINK_M1),
+	DEFINEDESC(TRANSA_DP_LINK_N1),
+	DEFINEDESC(TRANSA_DP_LINK_M2),
+	DEFINEDESC(TRANSA_DP_LINK_N2),
+
+	DEFINEDESC(TRANS_HTOTAL_B),
+	DEFINEDESC(TRANS_HBLANK_B),
+	DEFINEDESC(TRANS_HSYNC_B),
+	DEFINEDESC(TRANS_VTOTAL_B),
+	DEFINEDESC(TRANS_VBLANK_B),
+	DEFINEDESC(TRANS_VSYNC_B),
+	DEFINEDESC(TRANS_VSYNCSHIFT_B),
+
+	DEFINEDESC(TRANSB_DATA_M1),
+	DEFINEDESC(TRANSB_DATA_N1),
+	DEFINEDESC(TRANSB_DATA_M2),
+	DEFINEDESC(TRANSB_DATA_N2),
+	DEFINEDESC(TRANSB_DP_LINK_M1),
+	DEFINEDESC(TRANSB_DP_LINK_N1),
+	DEFINEDESC(TRANSB_DP_LINK_M2),
+	DEFINEDESC(TRANSB_DP_LINK_N2),
+
+	DEFINEDESC(TRANS_HTOTAL_C),
+	DEFINEDESC(TRANS_HBLANK_C),
+	DEFINEDESC(TRANS_HSYNC_C),
+	DEFINEDESC(TRANS_VTOTAL_C),
+	DEFINEDESC(TRANS_VBLANK_C),
+	DEFINEDESC(TRANS_VSYNC_C),
+	DEFINEDESC(TRANS_VSYNCSHIFT_C),
+
+	DEFINEDESC(TRANSC_DATA_M1),
+	DEFINEDESC(TRANSC_DATA_N1),
+	DEFINEDESC(TRANSC_DATA_M2),
+	DEFINEDESC(TRANSC_DATA_N2),
+	DEFINEDESC(TRANSC_DP_LINK_M1),
+	DEFINEDESC(TRANSC_DP_LINK_N1),
+	DEFINEDESC(TRANSC_DP_LINK_M2),
+	DEFINEDESC(TRANSC_DP_LINK_N2),
+
+	DEFINEDESC(TRANSACONF),
+	DEFINEDESC(TRANSBCONF),
+	DEFINEDESC(TRANSCCONF),
 
 	DEFINEREG2(FDI_TXA_CTL, ironlake_debug_fdi_tx_ctl),
 	DEFINEREG2(FDI_TXB_CTL, ironlake_debug_fdi_tx_ctl),
@@ -1923,31 +1783,57 @@ static struct reg_debug i945gm_mi_regs[] = {
 	DEFINEREG(ECOSKPD),
 };
 
+/*
+ * Decode @val into @result, using the register's own decoder if it has one
+ * and the register description database otherwise. Returns false if
+ * neither knows anything about the register.
+ */
+static bool
+reg_decode(const struct dump_context *ctx, struct reg_debug *reg,
+	   char *result, int len, uint32_t val)
+{
+	int id;
+
+	if (reg->debug_output != NULL) {
+		/* not every decoder writes something for every device */
+		result[0] = '\0';
+		reg->debug_output(ctx, result, len, reg->reg, val);
+		return true;
+	}
+
+	id = intel_reg_lookup(reg->reg, intel_gen(ctx->devid));
+	if (id < 0)
+		return false;
+
+	return intel_reg_decode(id, val, result, len) > 0;
+}
+
 static void
-_intel_dump_reg(struct reg_debug *reg, uint32_t val)
+_intel_dump_reg(const struct dump_context *ctx, struct reg_debug *reg,
+		uint32_t val)
 {
 	char debug[1024];
 
-	if (reg->debug_output != NULL) {
-		reg->debug_output(debug, sizeof(debug), reg->reg, val);
-		printf("%30.30s: 0x%08x (%s)\n",
-		       reg->name, val, debug);
+	if (reg_decode(ctx, reg, debug, sizeof(debug), val)) {
+		fprintf(ctx->out, "%30.30s: 0x%08x (%s)\n",
+			reg->name, val, debug);
 	} else {
-		printf("%30.30s: 0x%08x\n", reg->name, val);
+		fprintf(ctx->out, "%30.30s: 0x%08x\n", reg->name, val);
 	}
 }
 
-#define intel_dump_regs(regs) _intel_dump_regs(regs, ARRAY_SIZE(regs))
+#define intel_dump_regs(ctx, regs) _intel_dump_regs(ctx, regs, ARRAY_SIZE(regs))
 
 static void
-_intel_dump_regs(struct reg_debug *regs, int count)
+_intel_dump_regs(const struct dump_context *ctx, struct reg_debug *regs,
+		 int count)
 {
 	int i;
 
 	for (i = 0; i < count; i++) {
-		uint32_t val = INREG(regs[i].reg);
+		uint32_t val = dump_read(ctx, regs[i].reg);
 
-		_intel_dump_reg(&regs[i], val);
+		_intel_dump_reg(ctx, &regs[i], val);
 	}
 }
 
@@ -1997,17 +1883,17 @@ static struct {
 #undef DECLARE_REGS
 
 static void
-dump_reg(struct reg_debug *reg, uint32_t val, const char *prefix)
+dump_reg(const struct dump_context *ctx, struct reg_debug *reg, uint32_t val,
+	 const char *prefix)
 {
 	char debug[1024];
 
-	if (reg->debug_output != NULL) {
-		reg->debug_output(debug, sizeof(debug), reg->reg, val);
-		printf("%s: %s (0x%x): 0x%08x (%s)\n",
-		       prefix, reg->name, reg->reg, val, debug);
+	if (reg_decode(ctx, reg, debug, sizeof(debug), val)) {
+		fprintf(ctx->out, "%s: %s (0x%x): 0x%08x (%s)\n",
+			prefix, reg->name, reg->reg, val, debug);
 	} else {
-		printf("%s: %s (0x%x): 0x%08x\n",
-		       prefix, reg->name, reg->reg, val);
+		fprintf(ctx->out, "%s: %s (0x%x): 0x%08x\n",
+			prefix, reg->name, reg->reg, val);
 	}
 }
 
@@ -2020,40 +1906,210 @@ str_to_upper(char *str)
 	}
 }
 
+/*
+ * Lookup index over all of known_registers, built on first use: an open
+ * addressed hash keyed on the register offset (entries sharing an offset are
+ * chained in table order) and a name-sorted table for prefix lookups.
+ */
+struct reg_index_entry {
+	struct reg_debug *reg;
+	const char *description;
+	int table;
+	int next;
+};
+
+static struct {
+	struct reg_index_entry *entries;
+	int count;
+	int *by_name;
+	int *hash;
+	uint32_t hash_mask;
+} reg_index;
+
+static uint32_t
+reg_index_hash(uint32_t address)
+{
+	return ((address >> 2) * 0x9e3779b1) & reg_index.hash_mask;
+}
+
+static int
+reg_index_name_cmp(const void *a, const void *b)
+{
+	const struct reg_index_entry *ea = &reg_index.entries[*(const int *)a];
+	const struct reg_index_entry *eb = &reg_index.entries[*(const int *)b];
+	int ret;
+
+	ret = strcmp(ea->reg->name, eb->reg->name);
+	if (ret)
+		return ret;
+
+	/* keep entries with the same name in table order */
+	return *(const int *)a - *(const int *)b;
+}
+
 static void
-decode_register_name(char *name, uint32_t val)
+reg_index_init(void)
 {
-	int i, j;
+	int i, j, n, size;
 
-	str_to_upper(name);
+	if (reg_index.entries)
+		return;
+
+	n = 0;
+	for (i = 0; i < ARRAY_SIZE(known_registers); i++)
+		n += known_registers[i].count;
+
+	reg_index.entries = calloc(n, sizeof(*reg_index.entries));
+	reg_index.by_name = calloc(n, sizeof(*reg_index.by_name));
+	if (!reg_index.entries || !reg_index.by_name)
+		err(1, "failed to allocate register index");
 
 	for (i = 0; i < ARRAY_SIZE(known_registers); i++) {
-		struct reg_debug *regs = known_registers[i].regs;
+		for (j = 0; j < known_registers[i].count; j++) {
+			reg_index.entries[reg_index.count].reg =
+				&known_registers[i].regs[j];
+			reg_index.entries[reg_index.count].description =
+				known_registers[i].description;
+			reg_index.entries[reg_index.count].table = i;
+			reg_index.entries[reg_index.count].next = -1;
+			reg_index.by_name[reg_index.count] = reg_index.count;
+			reg_index.count++;
+		}
+	}
 
-		for (j = 0; j < known_registers[i].count; j++)
-			if (strstr(regs[j].name, name))
-				dump_reg(&regs[j], val,
-					 known_registers[i].description);
+	qsort(reg_index.by_name, reg_index.count, sizeof(int),
+	      reg_index_name_cmp);
+
+	/* keep the load factor at or below 1/4 */
+	for (size = 64; size < 4 * reg_index.count; size <<= 1)
+		;
+	reg_index.hash_mask = size - 1;
+	reg_index.hash = malloc(size * sizeof(*reg_index.hash));
+	if (!reg_index.hash)
+		err(1, "failed to allocate register index");
+	memset(reg_index.hash, -1, size * sizeof(*reg_index.hash));
+
+	/* walk backwards so that each chain ends up in table order */
+	for (i = reg_index.count - 1; i >= 0; i--) {
+		int address = reg_index.entries[i].reg->reg;
+		uint32_t slot = reg_index_hash(address);
+
+		while (reg_index.hash[slot] != -1 &&
+		       reg_index.entries[reg_index.hash[slot]].reg->reg != address)
+			slot = (slot + 1) & reg_index.hash_mask;
+
+		reg_index.entries[i].next = reg_index.hash[slot];
+		reg_index.hash[slot] = i;
 	}
 }
 
-static void
-decode_register_address(int address, uint32_t val)
+/* Returns the first index entry for @address, or -1 if it is unknown. */
+static int
+reg_index_lookup_address(int address)
 {
-	int i, j;
+	uint32_t slot = reg_index_hash(address);
 
-	for (i = 0; i < ARRAY_SIZE(known_registers); i++) {
-		struct reg_debug *regs = known_registers[i].regs;
+	while (reg_index.hash[slot] != -1) {
+		int i = reg_index.hash[slot];
 
-		for (j = 0; j < known_registers[i].count; j++)
-			if (regs[j].reg == address)
-				dump_reg(&regs[j], val,
-					 known_registers[i].description);
+		if (reg_index.entries[i].reg->reg == address)
+			return i;
+
+		slot = (slot + 1) & reg_index.hash_mask;
 	}
+
+	return -1;
 }
 
-static void
-decode_register(char *name, uint32_t val)
+/*
+ * Finds the range [*first, *last) of reg_index.by_name whose names start
+ * with @prefix. Returns the number of matching entries.
+ */
+static int
+reg_index_lookup_prefix(const char *prefix, int *first, int *last)
+{
+	size_t len = strlen(prefix);
+	int lo, hi;
+
+	lo = 0;
+	hi = reg_index.count;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		const char *name = reg_index.entries[reg_index.by_name[mid]].reg->name;
+
+		if (strncmp(name, prefix, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*first = lo;
+
+	hi = reg_index.count;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		const char *name = reg_index.entries[reg_index.by_name[mid]].reg->name;
+
+		if (strncmp(name, prefix, len) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*last = lo;
+
+	return *last - *first;
+}
+
+static int
+decode_register_name(const struct dump_context *ctx, char *name, uint32_t val)
+{
+	int i, first, last, found = 0;
+
+	str_to_upper(name);
+
+	reg_index_init();
+
+	if (reg_index_lookup_prefix(name, &first, &last)) {
+		for (i = first; i < last; i++) {
+			struct reg_index_entry *entry =
+				&reg_index.entries[reg_index.by_name[i]];
+
+			dump_reg(ctx, entry->reg, val, entry->description);
+		}
+		return last - first;
+	}
+
+	/* no register starts with that name, fall back to a substring match */
+	for (i = 0; i < reg_index.count; i++) {
+		if (strstr(reg_index.entries[i].reg->name, name)) {
+			dump_reg(ctx, reg_index.entries[i].reg, val,
+				 reg_index.entries[i].description);
+			found++;
+		}
+	}
+
+	return found;
+}
+
+static int
+decode_register_address(const struct dump_context *ctx, int address,
+			uint32_t val)
+{
+	int i, found = 0;
+
+	reg_index_init();
+
+	for (i = reg_index_lookup_address(address); i != -1;
+	     i = reg_index.entries[i].next) {
+		dump_reg(ctx, reg_index.entries[i].reg, val,
+			 reg_index.entries[i].description);
+		found++;
+	}
+
+	return found;
+}
+
+static int
+decode_register(const struct dump_context *ctx, char *name, uint32_t val)
 {
 	long int address;
 	char *end;
@@ -2062,13 +2118,547 @@ decode_register(char *name, uint32_t val)
 
 	/* found a register address */
 	if (address && *end == '\0')
-		decode_register_address(address, val);
+		return decode_register_address(ctx, address, val);
 	else
-		decode_register_name(name, val);
+		return decode_register_name(ctx, name, val);
+}
+
+/*
+ * Decode a stream of "register value" pairs, one per line, using the same
+ * syntax as the single register mode. Empty lines and lines starting with
+ * '#' are skipped.
+ */
+static int
+decode_register_stream(const struct dump_context *ctx, const char *file)
+{
+	static char outbuf[1 << 16];
+	FILE *in;
+	char *line = NULL;
+	size_t line_size = 0;
+	int lineno = 0, ret = 0;
+
+	if (!strcmp(file, "-"))
+		in = stdin;
+	else
+		in = fopen(file, "r");
+	if (in == NULL) {
+		fprintf(stderr, "Couldn't open %s: %s\n", file,
+			strerror(errno));
+		return 1;
+	}
+
+	/* lines are decoded much faster than a terminal can show them */
+	setvbuf(stdout, outbuf, _IOFBF, sizeof(outbuf));
+
+	while (getline(&line, &line_size, in) != -1) {
+		char *name, *value, *end;
+		uint32_t val;
+
+		lineno++;
+
+		name = line + strspn(line, " \t");
+		if (*name == '#' || *name == '\n' || *name == '\0')
+			continue;
+
+		value = name + strcspn(name, " \t\n");
+		if (*value != '\0')
+			*value++ = '\0';
+		value += strspn(value, " \t");
+
+		val = strtoul(value, &end, 0);
+		if (end == value || (*end != '\0' && !isspace(*end))) {
+			fprintf(stderr, "%s:%d: expected \"register value\"\n",
+				file, lineno);
+			ret = 1;
+			continue;
+		}
+
+		if (!decode_register(ctx, name, val)) {
+			fprintf(stderr, "%s:%d: unknown register %s\n",
+				file, lineno, name);
+			ret = 1;
+		}
+	}
+
+	fflush(stdout);
+	free(line);
+	if (in != stdin)
+		fclose(in);
+
+	return ret;
+}
+
+/* Whether the full dump for the device of @ctx includes known_registers[i]. */
+static bool
+known_registers_in_use(const struct dump_context *ctx, int i)
+{
+	struct reg_debug *regs = known_registers[i].regs;
+
+	if (regs == ironlake_debug_regs)
+		return HAS_PCH_SPLIT(ctx->devid);
+	if (regs == i945gm_mi_regs)
+		return IS_945GM(ctx->devid);
+	if (regs == intel_debug_regs)
+		return !HAS_PCH_SPLIT(ctx->devid);
+	if (regs == gen6_rp_debug_regs)
+		return IS_GEN6(ctx->devid) || IS_GEN7(ctx->devid);
+	if (regs == haswell_debug_regs)
+		return IS_HASWELL(ctx->devid);
+
+	return false;
+}
+
+/*
+ * Collect the offsets of the dwords that differ between @a and @b, @size
+ * bytes each, into @changed. Returns the number of changed dwords.
+ */
+static int
+snapshot_compare(const uint32_t *a, const uint32_t *b, size_t size,
+		 uint32_t *changed)
+{
+	size_t i = 0, n = size / 4;
+	int count = 0;
+
+#ifdef __SSE2__
+	/* compare 32 bytes per step, only look at the dwords of the blocks
+	 * that actually differ */
+	for (; i + 8 <= n; i += 8) {
+		__m128i a0 = _mm_loadu_si128((const __m128i *)(a + i));
+		__m128i a1 = _mm_loadu_si128((const __m128i *)(a + i + 4));
+		__m128i b0 = _mm_loadu_si128((const __m128i *)(b + i));
+		__m128i b1 = _mm_loadu_si128((const __m128i *)(b + i + 4));
+		int mask;
+
+		mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a0, b0)));
+		mask |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a1, b1))) << 4;
+		if (mask == 0xff)
+			continue;
+
+		mask = ~mask & 0xff;
+		while (mask) {
+			int j = ffs(mask) - 1;
+
+			changed[count++] = (i + j) * 4;
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	for (; i < n; i++)
+		if (a[i] != b[i])
+			changed[count++] = i * 4;
+
+	return count;
+}
+
+static void
+diff_reg(const struct dump_context *ctx_a, const struct dump_context *ctx_b,
+	 struct reg_index_entry *entry, uint32_t val_a, uint32_t val_b)
+{
+	struct reg_debug *reg = entry->reg;
+	char debug_a[1024], debug_b[1024];
+	bool decoded;
+
+	/* some decoders peek at other registers of their snapshot */
+	decoded = reg_decode(ctx_a, reg, debug_a, sizeof(debug_a), val_a);
+	decoded |= reg_decode(ctx_b, reg, debug_b, sizeof(debug_b), val_b);
+
+	if (!decoded) {
+		printf("%s: %s (0x%x): 0x%08x -> 0x%08x\n",
+		       entry->description, reg->name, reg->reg, val_a, val_b);
+		return;
+	}
+
+	printf("%s: %s (0x%x):\n"
+	       "\t- 0x%08x (%s)\n"
+	       "\t+ 0x%08x (%s)\n",
+	       entry->description, reg->name, reg->reg,
+	       val_a, debug_a, val_b, debug_b);
+}
+
+/*
+ * Decode only the registers whose value differs between two snapshots, as
+ * written by intel_reg_snapshot on the same kind of device.
+ */
+static int
+diff_snapshots(const struct dump_context *ctx, char *file_a, char *file_b)
+{
+	struct dump_context ctx_a = *ctx, ctx_b = *ctx;
+	uint32_t *map_a, *map_b, *changed;
+	size_t size_a, size_b, size;
+	int i, n, decoded = 0;
+
+	map_a = ctx_a.mmio = intel_mmap_file(file_a, &size_a);
+	map_b = ctx_b.mmio = intel_mmap_file(file_b, &size_b);
+	ctx_a.size = size_a;
+	ctx_b.size = size_b;
+
+	size = size_a < size_b ? size_a : size_b;
+	if (size_a != size_b)
+		fprintf(stderr, "Snapshot sizes differ (%zu vs %zu bytes), "
+			"comparing the first %zu bytes\n",
+			size_a, size_b, size);
+
+	changed = malloc(size / 4 * sizeof(*changed));
+	if (changed == NULL)
+		err(1, "failed to allocate diff buffer");
+
+	n = snapshot_compare(map_a, map_b, size, changed);
+
+	reg_index_init();
+
+	for (i = 0; i < n; i++) {
+		uint32_t offset = changed[i];
+		int j;
+
+		for (j = reg_index_lookup_address(offset); j != -1;
+		     j = reg_index.entries[j].next) {
+			if (!known_registers_in_use(ctx, reg_index.entries[j].table))
+				continue;
+
+			diff_reg(&ctx_a, &ctx_b, &reg_index.entries[j],
+				 map_a[offset / 4], map_b[offset / 4]);
+			decoded++;
+		}
+	}
+
+	printf("%d dwords differ, %d known registers decoded\n", n, decoded);
+
+	free(changed);
+	munmap(map_a, size_a);
+	munmap(map_b, size_b);
+
+	return 0;
+}
+
+/*
+ * Watch mode: a sampler thread reads the watched registers at a fixed rate
+ * and queues an event for every value that changes; the main thread decodes
+ * and prints the events so that slow terminal output doesn't disturb the
+ * sampling.
+ */
+#define WATCH_DEFAULT_RATE	1000
+#define WATCH_QUEUE_SIZE	4096
+
+struct watch_event {
+	struct timespec ts;
+	int reg;
+	uint32_t old_val, new_val;
+};
+
+static struct {
+	const struct dump_context *ctx;
+	struct intel_register_map map;
+	struct reg_debug **regs;
+	const char **descriptions;
+	uint32_t *offsets;
+	int count;
+	int rate;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct watch_event queue[WATCH_QUEUE_SIZE];
+	unsigned int head, tail;
+	unsigned long dropped;
+} watch;
+
+static volatile sig_atomic_t watch_done;
+
+static void
+watch_sighandler(int sig)
+{
+	watch_done = 1;
+}
+
+/*
+ * Only registers in the readable ranges are watched, as the sampler reads
+ * them far too often to risk a hang on a bad offset.
+ */
+static bool
+watch_add(struct reg_debug *reg, const char *description)
+{
+	if (!intel_get_register_range(watch.map, reg->reg, INTEL_RANGE_READ))
+		return false;
+
+	watch.regs = realloc(watch.regs, (watch.count + 1) * sizeof(*watch.regs));
+	watch.descriptions = realloc(watch.descriptions,
+				     (watch.count + 1) * sizeof(*watch.descriptions));
+	watch.offsets = realloc(watch.offsets,
+				(watch.count + 1) * sizeof(*watch.offsets));
+	if (!watch.regs || !watch.descriptions || !watch.offsets)
+		err(1, "failed to allocate watch list");
+
+	watch.regs[watch.count] = reg;
+	watch.descriptions[watch.count] = description;
+	watch.offsets[watch.count] = reg->reg;
+	watch.count++;
+
+	return true;
+}
+
+/*
+ * Add the registers named on the command line to the watch list. Addresses
+ * that aren't in any table are watched without a decoder, as long as they
+ * can be read safely.
+ */
+static int
+watch_add_register(char *name)
+{
+	long int address;
+	char *end;
+	int i, first, last;
+
+	address = strtoul(name, &end, 0);
+	if (address && *end == '\0') {
+		struct reg_debug *reg;
+
+		if (!intel_get_register_range(watch.map, address,
+					      INTEL_RANGE_READ)) {
+			fprintf(stderr, "register %s can't be read safely\n",
+				name);
+			return -1;
+		}
+
+		for (i = reg_index_lookup_address(address); i != -1;
+		     i = reg_index.entries[i].next) {
+			if (known_registers_in_use(watch.ctx,
+						   reg_index.entries[i].table)) {
+				watch_add(reg_index.entries[i].reg,
+					  reg_index.entries[i].description);
+				return 0;
+			}
+		}
+
+		reg = calloc(1, sizeof(*reg));
+		if (reg == NULL)
+			err(1, "failed to allocate watch list");
+		reg->reg = address;
+		reg->name = strdup(name);
+		watch_add(reg, "raw");
+		return 0;
+	}
+
+	str_to_upper(name);
+	if (!reg_index_lookup_prefix(name, &first, &last)) {
+		fprintf(stderr, "unknown register %s\n", name);
+		return -1;
+	}
+
+	for (i = first; i < last; i++) {
+		struct reg_index_entry *entry =
+			&reg_index.entries[reg_index.by_name[i]];
+
+		if (known_registers_in_use(watch.ctx, entry->table) &&
+		    !watch_add(entry->reg, entry->description))
+			fprintf(stderr, "not watching %s, it can't be read "
+				"safely\n", entry->reg->name);
+	}
+
+	return 0;
+}
+
+static void
+timespec_add_ns(struct timespec *ts, long ns)
+{
+	ts->tv_nsec += ns;
+	while (ts->tv_nsec >= 1000000000) {
+		ts->tv_nsec -= 1000000000;
+		ts->tv_sec++;
+	}
+}
+
+static void *
+watch_sampler(void *arg)
+{
+	uint32_t *prev, *cur, *tmp;
+	long period = 1000000000L / watch.rate;
+	struct timespec next, now;
+	int i;
+
+	prev = calloc(watch.count, sizeof(*prev));
+	cur = calloc(watch.count, sizeof(*cur));
+	if (prev == NULL || cur == NULL)
+		err(1, "failed to allocate sample buffers");
+
+	intel_register_read_batch(watch.offsets, prev, watch.count);
+	clock_gettime(CLOCK_MONOTONIC, &next);
+
+	while (!watch_done) {
+		timespec_add_ns(&next, period);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+		intel_register_read_batch(watch.offsets, cur, watch.count);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		/* don't try to catch up after falling behind */
+		if (now.tv_sec > next.tv_sec ||
+		    (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec))
+			next = now;
+
+		if (!memcmp(prev, cur, watch.count * sizeof(*cur)))
+			goto swap;
+
+		pthread_mutex_lock(&watch.lock);
+		for (i = 0; i < watch.count; i++) {
+			struct watch_event *ev;
+
+			if (prev[i] == cur[i])
+				continue;
+
+			if (watch.head - watch.tail == WATCH_QUEUE_SIZE) {
+				watch.dropped++;
+				continue;
+			}
+
+			ev = &watch.queue[watch.head++ % WATCH_QUEUE_SIZE];
+			ev->ts = now;
+			ev->reg = i;
+			ev->old_val = prev[i];
+			ev->new_val = cur[i];
+		}
+		pthread_cond_signal(&watch.cond);
+		pthread_mutex_unlock(&watch.lock);
+
+swap:
+		tmp = prev;
+		prev = cur;
+		cur = tmp;
+	}
+
+	pthread_mutex_lock(&watch.lock);
+	pthread_cond_signal(&watch.cond);
+	pthread_mutex_unlock(&watch.lock);
+
+	free(prev);
+	free(cur);
+	return NULL;
+}
+
+static void
+watch_print(struct watch_event *ev, const struct timespec *start)
+{
+	struct reg_debug *reg = watch.regs[ev->reg];
+	char debug_old[1024], debug_new[1024];
+	struct timespec ts;
+	bool decoded;
+
+	ts.tv_sec = ev->ts.tv_sec - start->tv_sec;
+	ts.tv_nsec = ev->ts.tv_nsec - start->tv_nsec;
+	if (ts.tv_nsec < 0) {
+		ts.tv_nsec += 1000000000;
+		ts.tv_sec--;
+	}
+
+	decoded = reg_decode(watch.ctx, reg, debug_old, sizeof(debug_old),
+			     ev->old_val);
+	decoded |= reg_decode(watch.ctx, reg, debug_new, sizeof(debug_new),
+			      ev->new_val);
+	if (!decoded) {
+		printf("[%5ld.%06ld] %s: %s (0x%x): 0x%08x -> 0x%08x\n",
+		       (long)ts.tv_sec, ts.tv_nsec / 1000,
+		       watch.descriptions[ev->reg], reg->name, reg->reg,
+		       ev->old_val, ev->new_val);
+		return;
+	}
+	printf("[%5ld.%06ld] %s: %s (0x%x): 0x%08x (%s) -> 0x%08x (%s)\n",
+	       (long)ts.tv_sec, ts.tv_nsec / 1000,
+	       watch.descriptions[ev->reg], reg->name, reg->reg,
+	       ev->old_val, debug_old, ev->new_val, debug_new);
+}
+
+/*
+ * Sample the registers named in @names (or all the registers the full dump
+ * would show, if there are none) until interrupted, printing a decoded line
+ * for every change.
+ */
+static int
+watch_registers(const struct dump_context *ctx, char **names, int n_names,
+		int rate)
+{
+	struct timespec start;
+	pthread_t sampler;
+	unsigned long dropped = 0;
+	int i, j;
+
+	watch.ctx = ctx;
+	watch.map = intel_get_register_map(ctx->devid);
+	reg_index_init();
+
+	if (n_names) {
+		for (i = 0; i < n_names; i++)
+			if (watch_add_register(names[i]))
+				return 1;
+	} else {
+		for (i = 0; i < ARRAY_SIZE(known_registers); i++) {
+			if (!known_registers_in_use(ctx, i))
+				continue;
+
+			for (j = 0; j < known_registers[i].count; j++)
+				watch_add(&known_registers[i].regs[j],
+					  known_registers[i].description);
+		}
+	}
+
+	if (watch.count == 0) {
+		fprintf(stderr, "no registers to watch\n");
+		return 1;
+	}
+
+	watch.rate = rate;
+	pthread_mutex_init(&watch.lock, NULL);
+	pthread_cond_init(&watch.cond, NULL);
+
+	signal(SIGINT, watch_sighandler);
+	signal(SIGTERM, watch_sighandler);
+
+	fprintf(stderr, "Watching %d registers at %d Hz, ^C to stop\n",
+		watch.count, watch.rate);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (pthread_create(&sampler, NULL, watch_sampler, NULL))
+		errx(1, "failed to create sampler thread");
+
+	pthread_mutex_lock(&watch.lock);
+	while (!watch_done || watch.head != watch.tail) {
+		struct watch_event ev;
+
+		if (watch.head == watch.tail) {
+			struct timespec timeout;
+
+			/* wake up now and then to notice ^C */
+			clock_gettime(CLOCK_REALTIME, &timeout);
+			timespec_add_ns(&timeout, 100000000);
+			pthread_cond_timedwait(&watch.cond, &watch.lock,
+					       &timeout);
+			continue;
+		}
+
+		ev = watch.queue[watch.tail++ % WATCH_QUEUE_SIZE];
+		if (watch.dropped) {
+			dropped += watch.dropped;
+			watch.dropped = 0;
+		}
+		pthread_mutex_unlock(&watch.lock);
+
+		watch_print(&ev, &start);
+		fflush(stdout);
+
+		pthread_mutex_lock(&watch.lock);
+	}
+	dropped += watch.dropped;
+	pthread_mutex_unlock(&watch.lock);
+
+	pthread_join(sampler, NULL);
+
+	if (dropped)
+		fprintf(stderr, "%lu changes dropped, output too slow\n",
+			dropped);
+
+	return 0;
 }
 
 static void
-intel_dump_other_regs(void)
+intel_dump_other_regs(const struct dump_context *ctx)
 {
 	int i;
 	int fp, dpll;
@@ -2096,11 +2686,11 @@ intel_dump_other_regs(void)
 	i830DumpIndexed(pScrn, "CR", crt + 4, crt + 5, 0, 0x24);
 #endif
 	for (disp_pipe = 0; disp_pipe <= 1; disp_pipe++) {
-		fp = INREG(disp_pipe == 0 ? FPA0 : FPB0);
-		dpll = INREG(disp_pipe == 0 ? DPLL_A : DPLL_B);
-		if (IS_GEN2(devid)) {
-			uint32_t lvds = INREG(LVDS);
-			if (devid == PCI_CHIP_I855_GM &&
+		fp = dump_read(ctx, disp_pipe == 0 ? FPA0 : FPB0);
+		dpll = dump_read(ctx, disp_pipe == 0 ? DPLL_A : DPLL_B);
+		if (IS_GEN2(ctx->devid)) {
+			uint32_t lvds = dump_read(ctx, LVDS);
+			if (ctx->devid == PCI_CHIP_I855_GM &&
 			    (lvds & LVDS_PORT_EN) &&
 			    (lvds & LVDS_PIPEB_SELECT) == (disp_pipe << 30)) {
 				if ((lvds & LVDS_CLKB_POWER_MASK) ==
@@ -2129,8 +2719,9 @@ intel_dump_other_regs(void)
 					break;
 				default:
 					p1 = 1;
-					printf("LVDS P1 0x%x invalid encoding\n",
-					       (dpll >> 16) & 0x3f);
+					fprintf(ctx->out,
+						"LVDS P1 0x%x invalid encoding\n",
+						(dpll >> 16) & 0x3f);
 					break;
 				}
 			} else {
@@ -2153,11 +2744,11 @@ intel_dump_other_regs(void)
 				break;
 			default:
 				ref = 0;
-				printf("ref out of range\n");
+				fprintf(ctx->out, "ref out of range\n");
 				break;
 			}
 		} else {
-			uint32_t lvds = INREG(LVDS);
+			uint32_t lvds = dump_read(ctx, LVDS);
 			if ((lvds & LVDS_PORT_EN) &&
 			    (lvds & LVDS_PIPEB_SELECT) == (disp_pipe << 30)) {
 				if ((lvds & LVDS_CLKB_POWER_MASK) ==
@@ -2175,11 +2766,11 @@ intel_dump_other_regs(void)
 					break;
 				default:
 					p2 = 1;
-					printf("p2 out of range\n");
+					fprintf(ctx->out, "p2 out of range\n");
 					break;
 				}
 			}
-			if (IS_IGD(devid))
+			if (IS_IGD(ctx->devid))
 				i = (dpll >> DPLL_FPA01_P1_POST_DIV_SHIFT_IGD) &
 				    0x1ff;
 			else
@@ -2211,13 +2802,13 @@ intel_dump_other_regs(void)
 				p1 = 8;
 				break;
 			case 256:
-				if (IS_IGD(devid)) {
+				if (IS_IGD(ctx->devid)) {
 					p1 = 9;
 					break;
 				}	/* fallback */
 			default:
 				p1 = 1;
-				printf("p1 out of range\n");
+				fprintf(ctx->out, "p1 out of range\n");
 				break;
 			}
 
@@ -2230,18 +2821,18 @@ intel_dump_other_regs(void)
 				break;
 			default:
 				ref = 0;
-				printf("ref out of range\n");
+				fprintf(ctx->out, "ref out of range\n");
 				break;
 			}
 		}
-		if (IS_965(devid)) {
+		if (IS_965(ctx->devid)) {
 			phase = (dpll >> 9) & 0xf;
 			switch (phase) {
 			case 6:
 				break;
 			default:
-				printf("SDVO phase shift %d out of range -- probobly not "
-				       "an issue.\n", phase);
+				fprintf(ctx->out, "SDVO phase shift %d out of range "
+					"-- probobly not an issue.\n", phase);
 				break;
 			}
 		}
@@ -2249,11 +2840,11 @@ intel_dump_other_regs(void)
 		case 0:
 			break;
 		default:
-			printf("fp select out of range\n");
+			fprintf(ctx->out, "fp select out of range\n");
 			break;
 		}
 		m1 = ((fp >> 8) & 0x3f);
-		if (IS_IGD(devid)) {
+		if (IS_IGD(ctx->devid)) {
 			n = ffs((fp & FP_N_IGD_DIV_MASK) >> FP_N_DIV_SHIFT) - 1;
 			m2 = (fp & FP_M2_IGD_DIV_MASK) >> FP_M2_DIV_SHIFT;
 			m = m2 + 2;
@@ -2267,32 +2858,312 @@ intel_dump_other_regs(void)
 									   p2);
 		}
 
-		printf("pipe %s dot %d n %d m1 %d m2 %d p1 %d p2 %d\n",
-		       disp_pipe == 0 ? "A" : "B", dot, n, m1, m2, p1, p2);
+		fprintf(ctx->out, "pipe %s dot %d n %d m1 %d m2 %d p1 %d p2 %d\n",
+			disp_pipe == 0 ? "A" : "B", dot, n, m1, m2, p1, p2);
 	}
 }
 
+/*
+ * Dump files don't record which device they came from, so pick the PCH from
+ * the -d device id or assume Ironlake. Returns false if we had to guess.
+ */
+static bool
+set_file_devid(struct dump_context *ctx)
+{
+	if (ctx->devid) {
+		if (IS_GEN5(ctx->devid))
+			ctx->pch = PCH_IBX;
+		else
+			ctx->pch = PCH_CPT;
+		return true;
+	}
+
+	ctx->devid = 0x0042;
+	ctx->pch = PCH_IBX;
+	return false;
+}
+
+/* The full dump of all the registers we know about for the device of @ctx. */
+static void
+dump_snapshot(const struct dump_context *ctx)
+{
+	if (HAS_PCH_SPLIT(ctx->devid)) {
+		intel_dump_regs(ctx, ironlake_debug_regs);
+	} else if (IS_945GM(ctx->devid)) {
+		intel_dump_regs(ctx, i945gm_mi_regs);
+		intel_dump_regs(ctx, intel_debug_regs);
+		intel_dump_other_regs(ctx);
+	} else {
+		intel_dump_regs(ctx, intel_debug_regs);
+		intel_dump_other_regs(ctx);
+	}
+
+	if (IS_GEN6(ctx->devid) || IS_GEN7(ctx->devid))
+		intel_dump_regs(ctx, gen6_rp_debug_regs);
+
+	if (IS_HASWELL(ctx->devid))
+		intel_dump_regs(ctx, haswell_debug_regs);
+}
+
+/*
+ * Multi-snapshot mode: decode many dump files in one go, each with its own
+ * dump_context, on a pool of worker threads. Workers render into memory and
+ * the main thread prints the results in command line order as soon as they
+ * are ready, either as one report per file or as a table with a row per file
+ * and a column per register.
+ */
+struct snapshot_job {
+	char *file;
+	struct dump_context ctx;
+	char *report;
+	size_t report_size;
+	uint32_t *values;
+	bool done;
+};
+
+static struct {
+	struct snapshot_job *jobs;
+	int count;
+	int next;
+	bool table;
+	struct reg_debug **columns;
+	int n_columns;
+
+	pthread_mutex_t lock;
+	pthread_cond_t done;
+} batch;
+
+static void
+snapshot_decode(struct snapshot_job *job)
+{
+	int i;
+
+	job->ctx.mmio = intel_mmap_file(job->file, &job->ctx.size);
+
+	if (batch.table) {
+		for (i = 0; i < batch.n_columns; i++)
+			job->values[i] = dump_read(&job->ctx,
+						   batch.columns[i]->reg);
+	} else {
+		job->ctx.out = open_memstream(&job->report, &job->report_size);
+		if (job->ctx.out == NULL)
+			err(1, "failed to allocate report for %s", job->file);
+		dump_snapshot(&job->ctx);
+		fclose(job->ctx.out);
+	}
+
+	munmap(job->ctx.mmio, job->ctx.size);
+}
+
+static void *
+snapshot_worker(void *arg)
+{
+	for (;;) {
+		struct snapshot_job *job;
+
+		pthread_mutex_lock(&batch.lock);
+		if (batch.next == batch.count) {
+			pthread_mutex_unlock(&batch.lock);
+			return NULL;
+		}
+		job = &batch.jobs[batch.next++];
+		pthread_mutex_unlock(&batch.lock);
+
+		snapshot_decode(job);
+
+		pthread_mutex_lock(&batch.lock);
+		job->done = true;
+		pthread_cond_broadcast(&batch.done);
+		pthread_mutex_unlock(&batch.lock);
+	}
+}
+
+static void
+snapshot_print(struct snapshot_job *job)
+{
+	int i;
+
+	if (!batch.table) {
+		printf("==> %s <==\n", job->file);
+		fwrite(job->report, 1, job->report_size, stdout);
+		printf("\n");
+		free(job->report);
+		return;
+	}
+
+	printf("%s", job->file);
+	for (i = 0; i < batch.n_columns; i++) {
+		/* the register lies beyond the end of a truncated dump */
+		if (batch.columns[i]->reg + 4 > job->ctx.size)
+			printf("\t-");
+		else
+			printf("\t0x%08x", job->values[i]);
+	}
+	printf("\n");
+	free(job->values);
+}
+
+static int
+decode_snapshots(const struct dump_context *ctx, char **files, int n_files,
+		 bool table, int n_threads)
+{
+	pthread_t *threads;
+	int i, j;
+
+	batch.count = n_files;
+	batch.table = table;
+	batch.jobs = calloc(n_files, sizeof(*batch.jobs));
+	if (batch.jobs == NULL)
+		err(1, "failed to allocate snapshot list");
+
+	if (table) {
+		for (i = 0; i < ARRAY_SIZE(known_registers); i++) {
+			if (!known_registers_in_use(ctx, i))
+				continue;
+
+			batch.columns = realloc(batch.columns,
+						(batch.n_columns + known_registers[i].count) *
+						sizeof(*batch.columns));
+			if (batch.columns == NULL)
+				err(1, "failed to allocate register list");
+			for (j = 0; j < known_registers[i].count; j++)
+				batch.columns[batch.n_columns++] =
+					&known_registers[i].regs[j];
+		}
+	}
+
+	for (i = 0; i < n_files; i++) {
+		batch.jobs[i].file = files[i];
+		batch.jobs[i].ctx = *ctx;
+		if (table) {
+			batch.jobs[i].values = calloc(batch.n_columns,
+						      sizeof(uint32_t));
+			if (batch.jobs[i].values == NULL)
+				err(1, "failed to allocate register values");
+		}
+	}
+
+	if (n_threads > n_files)
+		n_threads = n_files;
+	threads = calloc(n_threads, sizeof(*threads));
+	if (threads == NULL)
+		err(1, "failed to allocate thread pool");
+
+	pthread_mutex_init(&batch.lock, NULL);
+	pthread_cond_init(&batch.done, NULL);
+
+	for (i = 0; i < n_threads; i++)
+		if (pthread_create(&threads[i], NULL, snapshot_worker, NULL))
+			errx(1, "failed to create worker thread");
+
+	if (table) {
+		printf("file");
+		for (i = 0; i < batch.n_columns; i++)
+			printf("\t%s", batch.columns[i]->name);
+		printf("\n");
+	}
+
+	for (i = 0; i < n_files; i++) {
+		pthread_mutex_lock(&batch.lock);
+		while (!batch.jobs[i].done)
+			pthread_cond_wait(&batch.done, &batch.lock);
+		pthread_mutex_unlock(&batch.lock);
+
+		snapshot_print(&batch.jobs[i]);
+	}
+
+	for (i = 0; i < n_threads; i++)
+		pthread_join(threads[i], NULL);
+
+	free(threads);
+	free(batch.columns);
+	free(batch.jobs);
+
+	return 0;
+}
+
 static void print_usage(void)
 {
 	printf("Usage: intel_reg_dumper [options] [file]\n"
 	       "       intel_reg_dumper [options] register value\n"
+	       "       intel_reg_dumper [options] -i file\n"
+	       "       intel_reg_dumper [options] --diff file1 file2\n"
+	       "       intel_reg_dumper [options] --watch [register...]\n"
+	       "       intel_reg_dumper [options] --multi file...\n"
 	       "Options:\n"
 	       "  -d id   when a dump file is used, use 'id' as device id (in "
 	       "hex)\n"
-	       "  -h      prints this help\n");
+	       "  -i file decode 'register value' pairs read from file, one "
+	       "per line ('-' for stdin)\n"
+	       "  --diff  decode only the registers that differ between two "
+	       "dump files\n"
+	       "  --watch sample the given registers (default: all known "
+	       "registers) and print every change\n"
+	       "  -r hz   sampling rate for --watch (default %d)\n"
+	       "  --multi decode several dump files in parallel, one report "
+	       "per file\n"
+	       "  --table with --multi, print a table with one row per file "
+	       "and one column per register\n"
+	       "  -j n    number of threads for --multi (default: one per "
+	       "CPU)\n"
+	       "  -h      prints this help\n", WATCH_DEFAULT_RATE);
 }
 
 int main(int argc, char** argv)
 {
 	struct pci_device *pci_dev;
+	struct dump_context ctx = { .out = stdout };
 	int opt, n_args;
-	char *file = NULL, *reg_name = NULL;
+	char *file = NULL, *reg_name = NULL, *stream = NULL;
 	uint32_t reg_val;
-
-	while ((opt = getopt(argc, argv, "d:h")) != -1) {
+	bool diff = false, watch_mode = false, multi = false, table = false;
+	int rate = WATCH_DEFAULT_RATE;
+	int n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	struct option long_opts[] = {
+		{ "diff",	no_argument,		NULL, 'D' },
+		{ "watch",	no_argument,		NULL, 'W' },
+		{ "rate",	required_argument,	NULL, 'r' },
+		{ "multi",	no_argument,		NULL, 'M' },
+		{ "table",	no_argument,		NULL, 'T' },
+		{ "jobs",	required_argument,	NULL, 'j' },
+		{ "help",	no_argument,		NULL, 'h' },
+		{ 0, 0, 0, 0 }
+	};
+
+	while ((opt = getopt_long(argc, argv, "d:hi:j:r:", long_opts, NULL)) != -1) {
 		switch (opt) {
+		case 'D':
+			diff = true;
+			break;
+		case 'W':
+			watch_mode = true;
+			break;
+		case 'r':
+			rate = atoi(optarg);
+			if (rate < 1) {
+				fprintf(stderr, "sampling rate must be >= 1\n");
+				return 1;
+			}
+			break;
+		case 'M':
+			multi = true;
+			break;
+		case 'T':
+			multi = true;
+			table = true;
+			break;
+		case 'j':
+			n_threads = atoi(optarg);
+			if (n_threads < 1) {
+				fprintf(stderr, "number of threads must be >= 1\n");
+				return 1;
+			}
+			break;
 		case 'd':
-			devid = strtol(optarg, NULL, 16);
+			ctx.devid = strtol(optarg, NULL, 16);
+			break;
+		case 'i':
+			stream = optarg;
 			break;
 		case 'h':
 			print_usage();
@@ -2304,6 +3175,41 @@ int main(int argc, char** argv)
 	}
 
 	n_args = argc - optind;
+
+	if (watch_mode) {
+		int ret;
+
+		pci_dev = intel_get_pci_device();
+		ctx.devid = pci_dev->device_id;
+
+		if (intel_register_access_init(pci_dev, 1))
+			return 1;
+
+		if (HAS_PCH_SPLIT(ctx.devid))
+			intel_check_pch();
+		ctx.pch = pch;
+		ctx.mmio = mmio;
+
+		ret = watch_registers(&ctx, argv + optind, n_args, rate);
+
+		intel_register_access_fini();
+		return ret;
+	}
+
+	if (multi) {
+		if (n_args < 1) {
+			print_usage();
+			return 1;
+		}
+		if (!set_file_devid(&ctx))
+			fprintf(stderr, "Decoding files without -d argument. "
+				"Assuming Ironlake machine.\n");
+		if (n_threads < 1)
+			n_threads = 1;
+		return decode_snapshots(&ctx, argv + optind, n_args, table,
+					n_threads);
+	}
+
 	if (n_args == 1) {
 		file = argv[optind];
 	} else if (n_args == 2) {
@@ -2314,53 +3220,50 @@ int main(int argc, char** argv)
 		return 1;
 	}
 
+	if (stream) {
+		if (n_args) {
+			print_usage();
+			return 1;
+		}
+		return decode_register_stream(&ctx, stream);
+	}
+
+	if (diff) {
+		if (n_args != 2) {
+			print_usage();
+			return 1;
+		}
+		if (!set_file_devid(&ctx))
+			printf("Comparing files without -d argument. "
+			       "Assuming Ironlake machine.\n");
+		return diff_snapshots(&ctx, argv[optind], argv[optind + 1]);
+	}
+
 	/* the tool operates in "single" mode, decode a single register given
 	 * on the command line: intel_reg_dumper PCH_PP_CONTROL 0xabcd0002 */
 	if (reg_name) {
-		decode_register(reg_name, reg_val);
+		decode_register(&ctx, reg_name, reg_val);
 		return 0;
 	}
 
 	if (file) {
-		intel_map_file(file);
-		if (devid) {
-			if (IS_GEN5(devid))
-				pch = PCH_IBX;
-			else
-				pch = PCH_CPT;
-		} else {
+		ctx.mmio = intel_mmap_file(file, &ctx.size);
+		if (!set_file_devid(&ctx))
 			printf("Dumping from file without -d argument. "
 			       "Assuming Ironlake machine.\n");
-			devid = 0x0042;
-			pch = PCH_IBX;
-		}
 	} else {
 		pci_dev = intel_get_pci_device();
-		devid = pci_dev->device_id;
+		ctx.devid = pci_dev->device_id;
 
 		intel_register_access_init(pci_dev, 1);
 
-		if (HAS_PCH_SPLIT(devid))
+		if (HAS_PCH_SPLIT(ctx.devid))
 			intel_check_pch();
+		ctx.pch = pch;
+		ctx.mmio = mmio;
 	}
 
-	if (HAS_PCH_SPLIT(devid)) {
-		intel_dump_regs(ironlake_debug_regs);
-	} else if (IS_945GM(devid)) {
-		intel_dump_regs(i945gm_mi_regs);
-		intel_dump_regs(intel_debug_regs);
-		intel_dump_other_regs();
-	} else {
-		intel_dump_regs(intel_debug_regs);
-		intel_dump_other_regs();
-	}
-
-	if (IS_GEN6(devid) || IS_GEN7(devid))
-		intel_dump_regs(gen6_rp_debug_regs);
-
-	if (IS_HASWELL(devid))
-		intel_dump_regs(haswell_debug_regs);
-
+	dump_snapshot(&ctx);
 
 	intel_register_access_fini();
 	return 0;
@@ -29,10 +29,25 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <err.h>
+#include <errno.h>
 #include <string.h>
+#include <ctype.h>
 #include "intel_gpu_tools.h"
 #include "intel_vlv.h"
 
+/*
+ * Everything to read, collected up front so that the registers can be
+ * fetched with a single batched read after mapping the device once.
+ */
+struct read_list {
+	uint32_t *regs;		/* register address as given by the user */
+	uint32_t *offsets;	/* offset into the mmio mapping */
+	const char **labels;
+	int count, size;
+};
+
+static uint32_t devid;
+
 static void bit_decode(uint32_t reg)
 {
 	int i;
@@ -46,50 +61,172 @@ static void bit_decode(uint32_t reg)
 	printf("\n");
 }
 
-static void dump_range(uint32_t start, uint32_t end)
+static void read_list_add(struct read_list *list, uint32_t start, int dwords,
+			  const char *label)
 {
+	uint32_t offset = 0;
 	int i;
-	struct pci_device *pci_dev;
-	pci_dev = intel_get_pci_device();
 
-	uint32_t offset = 0;
-	
-	
-	for (i = start; i < end; i = 4){
-		if (IS_VALLEYVIEW(pci_dev->device_id)) {
-	                if (IS_DISPLAYREG(start))
-	                        offset = 0x180000;
-	                else
-	                        offset=0x0;
-	        }
-
-		printf("0x%X : 0x%X\n", i,
-		       *(volatile uint32_t *)((volatile char*)mmio + offset));
+	if (IS_VALLEYVIEW(devid) && IS_DISPLAYREG(start))
+		offset = 0x180000;
+
+	if (list->count + dwords > list->size) {
+		list->size = list->size * 2 + dwords;
+		list->regs = realloc(list->regs,
+				     list->size * sizeof(*list->regs));
+		list->offsets = realloc(list->offsets,
+					list->size * sizeof(*list->offsets));
+		list->labels = realloc(list->labels,
+				       list->size * sizeof(*list->labels));
+		if (!list->regs || !list->offsets || !list->labels)
+			err(1, "failed to allocate register list");
+	}
+
+	for (i = 0; i < dwords; i++) {
+		list->regs[list->count] = start + i * 4;
+		list->offsets[list->count] = start + i * 4 + offset;
+		list->labels[list->count] = i == 0 ? label : NULL;
+		list->count++;
+	}
+}
+
+static void dump_range(struct read_list *list, uint32_t start, uint32_t end)
+{
+	read_list_add(list, start, (end - start + 1) / 4, NULL);
+}
+
+/*
+ * Parse a register script: one "address [-c dwords] [label]" per line.
+ * Empty lines and lines starting with '#' are skipped.
+ */
+static int parse_script(struct read_list *list, const char *file)
+{
+	FILE *in;
+	char *line = NULL;
+	size_t line_size = 0;
+	int lineno = 0, ret = 0;
+
+	if (!strcmp(file, "-"))
+		in = stdin;
+	else
+		in = fopen(file, "r");
+	if (in == NULL) {
+		fprintf(stderr, "Couldn't open %s: %s\n", file,
+			strerror(errno));
+		return 1;
+	}
+
+	while (getline(&line, &line_size, in) != -1) {
+		char *p, *end, *label = NULL;
+		uint32_t reg;
+		long dwords = 1;
+
+		lineno++;
+
+		p = line + strspn(line, " \t");
+		if (*p == '#' || *p == '\n' || *p == '\0')
+			continue;
+
+		reg = strtoul(p, &end, 0);
+		if (end == p || (*end && !isspace(*end))) {
+			fprintf(stderr, "%s:%d: expected a register address\n",
+				file, lineno);
+			ret = 1;
+			continue;
+		}
+		p = end + strspn(end, " \t");
+
+		if (!strncmp(p, "-c", 2) && isspace(p[2])) {
+			p += 2;
+			p += strspn(p, " \t");
+			dwords = strtol(p, &end, 0);
+			if (end == p || dwords < 1 ||
+			    (*end && !isspace(*end))) {
+				fprintf(stderr, "%s:%d: bad dword count\n",
+					file, lineno);
+				ret = 1;
+				continue;
+			}
+			p = end + strspn(end, " \t");
+		}
+
+		/* whatever is left on the line labels the register */
+		end = p + strlen(p);
+		while (end > p && isspace(end[-1]))
+			*--end = '\0';
+		if (*p)
+			label = strdup(p);
+
+		read_list_add(list, reg, dwords, label);
+	}
+
+	free(line);
+	if (in != stdin)
+		fclose(in);
+
+	return ret;
+}
+
+static void print_list(struct read_list *list, uint32_t *vals,
+		       int binary, int decode_bits)
+{
+	int i;
+
+	if (binary) {
+		/* (address, value) pairs of native endian dwords */
+		for (i = 0; i < list->count; i++) {
+			uint32_t pair[2] = { list->regs[i], vals[i] };
+
+			fwrite(pair, sizeof(pair), 1, stdout);
 		}
+		return;
+	}
+
+	for (i = 0; i < list->count; i++) {
+		if (list->labels[i])
+			printf("0x%X : 0x%X\t%s\n", list->regs[i], vals[i],
+			       list->labels[i]);
+		else
+			printf("0x%X : 0x%X\n", list->regs[i], vals[i]);
+
+		if (decode_bits)
+			bit_decode(vals[i]);
+	}
 }
 
 static void usage(char *cmdname)
 {
-	printf("Usage: %s [-f|-d] [addr1] [addr2] .. [addrN]\n", cmdname);
+	printf("Usage: %s [-f|-d] [-b] [addr1] [addr2] .. [addrN]\n", cmdname);
+	printf("       %s [-d] [-b] -s script\n", cmdname);
 	printf("\t -f : read back full range of registers.\n");
 	printf("\t      WARNING! This option may result in a machine hang!\n");
 	printf("\t -d : decode register bits.\n");
 	printf("\t -c : number of dwords to dump (can't be used with -f/-d).\n");
+	printf("\t -s : read the registers listed in script ('-' for stdin),\n");
+	printf("\t      one 'addr [-c dwords] [label]' per line.\n");
+	printf("\t -b : write binary (address, value) dword pairs.\n");
 	printf("\t addr : in 0xXXXX format\n");
 }
 
 int main(int argc, char** argv)
 {
 	int ret = 0;
-	uint32_t reg;
+	uint32_t reg, *vals;
 	int i, ch;
 	char *cmdname = strdup(argv[0]);
+	char *script = NULL;
 	int full_dump = 0;
 	int decode_bits = 0;
+	int binary = 0;
 	int dwords = 1;
+	struct pci_device *pci_dev;
+	struct read_list list = { 0 };
 
-	while ((ch = getopt(argc, argv, "dfhc:")) != -1) {
+	while ((ch = getopt(argc, argv, "bdfhc:s:")) != -1) {
 		switch(ch) {
+		case 'b':
+			binary = 1;
+			break;
 		case 'd':
 			decode_bits = 1;
 			break;
@@ -103,12 +240,15 @@ int main(int argc, char** argv)
 		case 'c':
 			dwords = strtol(optarg, NULL, 0);
 			break;
+		case 's':
+			script = optarg;
+			break;
 		}
 	}
 	argc -= optind;
-	argv = optind;
+	argv += optind;
 
-	if (argc < 1) {
+	if (argc < 1 && !full_dump && !script) {
 		usage(cmdname);
 		ret = 1;
 		goto out;
@@ -120,37 +260,57 @@ int main(int argc, char** argv)
 		goto out;
 	}
 
-	intel_register_access_init(intel_get_pci_device(), 0);
-
-	if (full_dump) {
-		dump_range(0x00000, 0x00fff);   /* VGA registers */
-		dump_range(0x02000, 0x02fff);   /* instruction, memory, interrupt control registers */
-		dump_range(0x03000, 0x031ff);   /* FENCE and PPGTT control registers */
-		dump_range(0x03200, 0x03fff);   /* frame buffer compression registers */
-		dump_range(0x05000, 0x05fff);   /* I/O control registers */
-		dump_range(0x06000, 0x06fff);   /* clock control registers */
-		dump_range(0x07000, 0x07fff);   /* 3D internal debug registers */
-		dump_range(0x07400, 0x088ff);   /* GPE debug registers */
-		dump_range(0x0a000, 0x0afff);   /* display palette registers */
-		dump_range(0x10000, 0x13fff);   /* MMIO MCHBAR */
-		dump_range(0x30000, 0x3ffff);   /* overlay registers */
-		dump_range(0x60000, 0x6ffff);   /* display engine pipeline registers */
-		dump_range(0x70000, 0x72fff);   /* display and cursor registers */
-		dump_range(0x73000, 0x73fff);   /* performance counters */
+	if (script && (argc || full_dump)) {
+		usage(cmdname);
+		ret = 1;
+		goto out;
+	}
+
+	pci_dev = intel_get_pci_device();
+	devid = pci_dev->device_id;
+
+	if (script) {
+		/* check the whole script before touching the hardware */
+		ret = parse_script(&list, script);
+		if (ret)
+			goto out;
+	} else if (full_dump) {
+		dump_range(&list, 0x00000, 0x00fff);   /* VGA registers */
+		dump_range(&list, 0x02000, 0x02fff);   /* instruction, memory, interrupt control registers */
+		dump_range(&list, 0x03000, 0x031ff);   /* FENCE and PPGTT control registers */
+		dump_range(&list, 0x03200, 0x03fff);   /* frame buffer compression registers */
+		dump_range(&list, 0x05000, 0x05fff);   /* I/O control registers */
+		dump_range(&list, 0x06000, 0x06fff);   /* clock control registers */
+		dump_range(&list, 0x07000, 0x07fff);   /* 3D internal debug registers */
+		dump_range(&list, 0x07400, 0x088ff);   /* GPE debug registers */
+		dump_range(&list, 0x0a000, 0x0afff);   /* display palette registers */
+		dump_range(&list, 0x10000, 0x13fff);   /* MMIO MCHBAR */
+		dump_range(&list, 0x30000, 0x3ffff);   /* overlay registers */
+		dump_range(&list, 0x60000, 0x6ffff);   /* display engine pipeline registers */
+		dump_range(&list, 0x70000, 0x72fff);   /* display and cursor registers */
+		dump_range(&list, 0x73000, 0x73fff);   /* performance counters */
 	} else {
-		for (i=0; i < argc; i) {
+		for (i=0; i < argc; i++) {
 			sscanf(argv[i], "0x%x", &reg);
-			dump_range(reg, reg  (dwords * 4));
-
-			if (decode_bits)
-				bit_decode(*(volatile uint32_t *)((volatile char*)mmio  reg));
+			read_list_add(&list, reg, dwords, NULL);
 		}
 	}
 
+	vals = malloc(list.count * sizeof(*vals));
+	if (vals == NULL)
+		err(1, "failed to allocate register values");
+
+	if (intel_register_access_init(pci_dev, 0)) {
+		ret = 1;
+		goto out;
+	}
+	intel_register_read_batch(list.offsets, vals, list.count);
 	intel_register_access_fini();
 
+	print_list(&list, vals, binary, decode_bits);
+
+	free(vals);
 out:
 	free(cmdname);
 	return ret;
 }
-